@@ -0,0 +1,19 @@
+#version 410
+
+layout (location = 0) in vec3 vertex;
+layout (location = 2) in vec3 texcoord;
+layout (location = 5) in mat4 instance_model_to_world; // Uses locations 5 to 8.
+
+uniform mat4 vertex_world_to_clip;
+
+out VS_OUT {
+	vec2 texcoord;
+} vs_out;
+
+
+void main()
+{
+	vs_out.texcoord = texcoord.xy;
+
+	gl_Position = vertex_world_to_clip * instance_model_to_world * vec4(vertex, 1.0);
+}
@@ -1,20 +1,8 @@
 #version 410
 
-struct ViewProjTransforms
-{
-	mat4 view_projection;
-	mat4 view_projection_inverse;
-};
-
-layout (std140) uniform CameraViewProjTransforms
-{
-	ViewProjTransforms camera;
-};
-
-layout (std140) uniform LightViewProjTransforms
-{
-	ViewProjTransforms lights[4];
-};
+#include "camera_view_proj_transforms.glsl"
+#include "gbuffer_encoding.glsl"
+#include "light_view_proj_transforms.glsl"
 
 uniform int light_index;
 
@@ -22,6 +10,15 @@ uniform sampler2D depth_texture;
 uniform sampler2D normal_texture;
 uniform sampler2D shadow_texture;
 
+// The shadow map of this light only covers part of shadow_texture, which
+// is shared by all lights: xy holds the offset of that region and zw its
+// size, both in texture coordinates. Coordinates computed for a
+// standalone shadow map should be remapped as
+// `shadow_atlas_region.xy + shadowmap_coord * shadow_atlas_region.zw`,
+// without bleeding into the neighbouring regions. A size of zero means
+// the light did not get any shadow map this frame.
+uniform vec4 shadow_atlas_region;
+
 uniform vec2 inverse_screen_resolution;
 
 uniform vec3 camera_position;
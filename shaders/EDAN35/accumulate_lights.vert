@@ -1,15 +1,6 @@
 #version 410
 
-struct ViewProjTransforms
-{
-	mat4 view_projection;
-	mat4 view_projection_inverse;
-};
-
-layout (std140) uniform CameraViewProjTransforms
-{
-	ViewProjTransforms camera;
-};
+#include "camera_view_proj_transforms.glsl"
 
 uniform mat4 vertex_model_to_world;
 
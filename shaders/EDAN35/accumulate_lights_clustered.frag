@@ -0,0 +1,85 @@
+#version 410
+
+#include "camera_view_proj_transforms.glsl"
+#include "gbuffer_encoding.glsl"
+
+uniform sampler2D depth_texture;
+uniform sampler2D normal_texture;
+
+// See LightClusters.hpp for the layout of those buffers.
+uniform usamplerBuffer cluster_grid;
+uniform usamplerBuffer cluster_light_indices;
+uniform samplerBuffer cluster_lights;
+uniform uvec3 cluster_dimensions;
+uniform vec2 cluster_depth_range;
+
+uniform vec2 inverse_screen_resolution;
+
+uniform vec3 camera_position;
+
+uniform float shininess;
+
+layout (pixel_center_integer) in vec4 gl_FragCoord;
+
+layout (location = 0) out vec4 light_diffuse_contribution;
+layout (location = 1) out vec4 light_specular_contribution;
+
+
+void main()
+{
+	ivec2 pixel_coord = ivec2(gl_FragCoord.xy);
+
+	light_diffuse_contribution  = vec4(0.0, 0.0, 0.0, 1.0);
+	light_specular_contribution = vec4(0.0, 0.0, 0.0, 1.0);
+
+	float depth = texelFetch(depth_texture, pixel_coord, 0).r;
+	if (depth == 1.0)
+		return;
+
+	vec2 screen_coord = (vec2(pixel_coord) + 0.5) * inverse_screen_resolution;
+	vec4 world_position = camera.view_projection_inverse * vec4(screen_coord * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	world_position /= world_position.w;
+
+	vec3 normal = decode_normal(texelFetch(normal_texture, pixel_coord, 0));
+	vec3 view_direction = normalize(camera_position - world_position.xyz);
+
+	// Find the cluster of the fragment; the depth slices must match
+	// LightClusters::get_slice().
+	float near = cluster_depth_range.x;
+	float far = cluster_depth_range.y;
+	float view_depth = 2.0 * near * far / (far + near - (depth * 2.0 - 1.0) * (far - near));
+	float slice = floor(log(view_depth / near) / log(far / near) * float(cluster_dimensions.z));
+	uvec3 cluster_coord = min(uvec3(uvec2(screen_coord * vec2(cluster_dimensions.xy)), uint(max(slice, 0.0))),
+	                          cluster_dimensions - uvec3(1u));
+	int cluster = int(cluster_coord.x + cluster_dimensions.x * (cluster_coord.y + cluster_dimensions.y * cluster_coord.z));
+
+	uvec2 cluster_lights_range = texelFetch(cluster_grid, cluster).rg;
+
+	vec3 diffuse = vec3(0.0);
+	vec3 specular = vec3(0.0);
+	for (uint i = 0u; i < cluster_lights_range.y; ++i) {
+		int light = int(texelFetch(cluster_light_indices, int(cluster_lights_range.x + i)).r);
+		vec4 position_radius = texelFetch(cluster_lights, 2 * light);
+		vec3 color = texelFetch(cluster_lights, 2 * light + 1).rgb;
+
+		vec3 light_vector = position_radius.xyz - world_position.xyz;
+		float distance_squared = dot(light_vector, light_vector);
+		float radius_squared = position_radius.w * position_radius.w;
+		if (distance_squared >= radius_squared)
+			continue;
+
+		// Inverse-square falloff, smoothly windowed to reach zero at the
+		// light's radius.
+		float window = clamp(1.0 - (distance_squared * distance_squared) / (radius_squared * radius_squared), 0.0, 1.0);
+		float attenuation = window * window / max(distance_squared, 1.0);
+
+		vec3 light_direction = light_vector * inversesqrt(distance_squared);
+		vec3 halfway = normalize(light_direction + view_direction);
+
+		diffuse  += color * attenuation * max(dot(normal, light_direction), 0.0);
+		specular += color * attenuation * pow(max(dot(normal, halfway), 0.0), shininess);
+	}
+
+	light_diffuse_contribution.rgb  = diffuse;
+	light_specular_contribution.rgb = specular;
+}
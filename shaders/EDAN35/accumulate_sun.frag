@@ -0,0 +1,94 @@
+#version 410
+
+#include "camera_view_proj_transforms.glsl"
+#include "gbuffer_encoding.glsl"
+
+uniform sampler2D depth_texture;
+uniform sampler2D normal_texture;
+
+// One layer per cascade, from the closest to the furthest; see
+// ShadowCascades.hpp for how they are laid out.
+uniform sampler2DArrayShadow sun_shadow_cascades;
+uniform mat4 sun_cascade_world_to_clip[4];
+uniform vec4 sun_cascade_far_distances;
+// Fraction of each cascade, at its far end, over which it gets blended
+// with the next one.
+uniform float sun_cascade_blend_ratio;
+
+uniform vec2 inverse_screen_resolution;
+uniform vec2 camera_depth_range;
+
+uniform vec3 camera_position;
+
+uniform vec3 sun_direction;
+uniform vec3 sun_color;
+uniform float sun_intensity;
+uniform float shininess;
+
+layout (pixel_center_integer) in vec4 gl_FragCoord;
+
+layout (location = 0) out vec4 light_diffuse_contribution;
+layout (location = 1) out vec4 light_specular_contribution;
+
+
+float sample_cascade(int cascade, vec3 world_position)
+{
+	vec4 shadow_position = sun_cascade_world_to_clip[cascade] * vec4(world_position, 1.0);
+	vec3 shadow_coord = shadow_position.xyz / shadow_position.w * 0.5 + 0.5;
+	return texture(sun_shadow_cascades, vec4(shadow_coord.xy, float(cascade), shadow_coord.z));
+}
+
+void main()
+{
+	ivec2 pixel_coord = ivec2(gl_FragCoord.xy);
+
+	light_diffuse_contribution  = vec4(0.0, 0.0, 0.0, 1.0);
+	light_specular_contribution = vec4(0.0, 0.0, 0.0, 1.0);
+
+	float depth = texelFetch(depth_texture, pixel_coord, 0).r;
+	if (depth == 1.0)
+		return;
+
+	vec2 screen_coord = (vec2(pixel_coord) + 0.5) * inverse_screen_resolution;
+	vec4 world_position = camera.view_projection_inverse * vec4(screen_coord * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	world_position /= world_position.w;
+
+	vec3 normal = decode_normal(texelFetch(normal_texture, pixel_coord, 0));
+	vec3 view_direction = normalize(camera_position - world_position.xyz);
+	vec3 light_direction = -sun_direction;
+
+	float n_dot_l = max(dot(normal, light_direction), 0.0);
+	if (n_dot_l == 0.0)
+		return;
+
+	// Pick the closest cascade containing the fragment, and blend it with
+	// the next one when getting close to its far end; past the last
+	// cascade, shadows fade out.
+	float near = camera_depth_range.x;
+	float far = camera_depth_range.y;
+	float view_depth = 2.0 * near * far / (far + near - (depth * 2.0 - 1.0) * (far - near));
+
+	float visibility = 1.0;
+	for (int cascade = 0; cascade < 4; ++cascade) {
+		float cascade_far = sun_cascade_far_distances[cascade];
+		if (view_depth >= cascade_far)
+			continue;
+
+		float cascade_near = cascade == 0 ? near : sun_cascade_far_distances[cascade - 1];
+		float blend_length = (cascade_far - cascade_near) * sun_cascade_blend_ratio;
+		float blend = clamp((cascade_far - view_depth) / blend_length, 0.0, 1.0);
+
+		visibility = sample_cascade(cascade, world_position.xyz);
+		if (blend < 1.0) {
+			float next_visibility = cascade < 3 ? sample_cascade(cascade + 1, world_position.xyz) : 1.0;
+			visibility = mix(next_visibility, visibility, blend);
+		}
+		break;
+	}
+
+	vec3 radiance = sun_color * sun_intensity * visibility;
+	vec3 halfway = normalize(light_direction + view_direction);
+
+	light_diffuse_contribution.rgb  = radiance * n_dot_l;
+	light_specular_contribution.rgb = radiance * pow(max(dot(normal, halfway), 0.0), shininess);
+}
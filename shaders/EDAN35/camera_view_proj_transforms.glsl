@@ -0,0 +1,6 @@
+#include "view_proj_transforms.glsl"
+
+layout (std140) uniform CameraViewProjTransforms
+{
+	ViewProjTransforms camera;
+};
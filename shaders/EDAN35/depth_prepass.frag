@@ -0,0 +1,7 @@
+#version 410
+
+// Only depth gets written, and nothing is discarded, so that early depth
+// testing stays enabled.
+void main()
+{
+}
@@ -0,0 +1,23 @@
+#version 410
+
+#include "camera_view_proj_transforms.glsl"
+
+uniform mat4 vertex_model_to_world;
+
+layout (location = 0) in vec3 vertex;
+layout (location = 2) in vec3 texcoord;
+
+out VS_OUT {
+	vec2 texcoord;
+} vs_out;
+
+// The G-buffer pass tests against this depth with GL_EQUAL, so both must
+// compute exactly the same positions; see fill_gbuffer.vert.
+invariant gl_Position;
+
+void main()
+{
+	vs_out.texcoord = texcoord.xy;
+
+	gl_Position = camera.view_projection * vertex_model_to_world * vec4(vertex, 1.0);
+}
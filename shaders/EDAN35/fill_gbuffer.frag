@@ -1,9 +1,10 @@
 #version 410
 
-uniform bool has_diffuse_texture;
-uniform bool has_specular_texture;
-uniform bool has_normals_texture;
-uniform bool has_opacity_texture;
+#include "gbuffer_encoding.glsl"
+
+// Textures are only sampled when the corresponding keyword, such as
+// HAS_DIFFUSE_TEXTURE, is defined; each combination of keywords is built
+// as a separate variant of this shader.
 uniform sampler2D diffuse_texture;
 uniform sampler2D specular_texture;
 uniform sampler2D normals_texture;
@@ -24,19 +25,28 @@ layout (location = 2) out vec4 geometry_normal;
 
 void main()
 {
-	if (has_opacity_texture && texture(opacity_texture, fs_in.texcoord).r < 1.0)
+#ifdef HAS_OPACITY_TEXTURE
+	if (texture(opacity_texture, fs_in.texcoord).r < 1.0)
 		discard;
+#endif
 
 	// Diffuse color
 	geometry_diffuse = vec4(0.0f);
-	if (has_diffuse_texture)
-		geometry_diffuse = texture(diffuse_texture, fs_in.texcoord);
+#ifdef HAS_DIFFUSE_TEXTURE
+	geometry_diffuse = texture(diffuse_texture, fs_in.texcoord);
+#endif
 
 	// Specular color
 	geometry_specular = vec4(0.0f);
-	if (has_specular_texture)
-		geometry_specular = texture(specular_texture, fs_in.texcoord);
+#ifdef HAS_SPECULAR_TEXTURE
+	geometry_specular = texture(specular_texture, fs_in.texcoord);
+#endif
 
 	// Worldspace normal
 	geometry_normal.xyz = vec3(0.0);
+
+	if (use_compact_gbuffer) {
+		geometry_diffuse.a = dot(geometry_specular.rgb, vec3(0.2126, 0.7152, 0.0722));
+		geometry_normal = vec4(encode_normal_octahedral(geometry_normal.xyz * 2.0 - 1.0), 0.0, 0.0);
+	}
 }
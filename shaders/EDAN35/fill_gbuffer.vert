@@ -1,15 +1,6 @@
 #version 410
 
-struct ViewProjTransforms
-{
-	mat4 view_projection;
-	mat4 view_projection_inverse;
-};
-
-layout (std140) uniform CameraViewProjTransforms
-{
-	ViewProjTransforms camera;
-};
+#include "camera_view_proj_transforms.glsl"
 
 uniform mat4 vertex_model_to_world;
 
@@ -26,6 +17,10 @@ out VS_OUT {
 	vec3 binormal;
 } vs_out;
 
+// Must match the positions computed in depth_prepass.vert, which the
+// depth buffer may have been filled with.
+invariant gl_Position;
+
 
 void main() {
 	vs_out.normal   = normalize(normal);
@@ -1,15 +1,6 @@
 #version 410
 
-struct ViewProjTransforms
-{
-	mat4 view_projection;
-	mat4 view_projection_inverse;
-};
-
-layout (std140) uniform LightViewProjTransforms
-{
-	ViewProjTransforms lights[4];
-};
+#include "light_view_proj_transforms.glsl"
 
 uniform int light_index;
 uniform mat4 vertex_model_to_world;
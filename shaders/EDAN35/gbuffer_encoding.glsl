@@ -0,0 +1,25 @@
+// With the compact G-buffer layout, the specular intensity is stored in
+// the alpha channel of the diffuse target, and normals are stored with an
+// octahedral encoding in two 16-bit channels; otherwise normals are stored
+// as is, in the [0, 1] range, and specular has its own target.
+uniform bool use_compact_gbuffer;
+
+vec2 encode_normal_octahedral(vec3 normal)
+{
+	normal /= max(abs(normal.x) + abs(normal.y) + abs(normal.z), 1e-6);
+	vec2 encoded = normal.z >= 0.0 ? normal.xy
+	                               : (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	return encoded * 0.5 + 0.5;
+}
+
+vec3 decode_normal(vec4 stored_normal)
+{
+	if (!use_compact_gbuffer)
+		return normalize(stored_normal.xyz * 2.0 - 1.0);
+
+	vec2 encoded = stored_normal.xy * 2.0 - 1.0;
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (normal.z < 0.0)
+		normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(normal);
+}
@@ -1,5 +1,7 @@
 #version 410
 
+#include "gbuffer_encoding.glsl"
+
 uniform sampler2D diffuse_texture;
 uniform sampler2D specular_texture;
 uniform sampler2D light_d_texture;
@@ -13,8 +15,10 @@ void main()
 {
 	ivec2 pixel_coord = ivec2(gl_FragCoord.xy);
 
-	vec3 diffuse  = texelFetch(diffuse_texture,  pixel_coord, 0).rgb;
-	vec3 specular = texelFetch(specular_texture, pixel_coord, 0).rgb;
+	vec4 diffuse_and_specular = texelFetch(diffuse_texture, pixel_coord, 0);
+	vec3 diffuse  = diffuse_and_specular.rgb;
+	vec3 specular = use_compact_gbuffer ? vec3(diffuse_and_specular.a)
+	                                    : texelFetch(specular_texture, pixel_coord, 0).rgb;
 
 	vec3 light_d  = texelFetch(light_d_texture,  pixel_coord, 0).rgb;
 	vec3 light_s  = texelFetch(light_s_texture,  pixel_coord, 0).rgb;
@@ -0,0 +1,7 @@
+// Matches the ViewProjTransforms struct of EDAN35/assignment2.cpp, laid out
+// following std140.
+struct ViewProjTransforms
+{
+	mat4 view_projection;
+	mat4 view_projection_inverse;
+};
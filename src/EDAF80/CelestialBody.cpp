@@ -1,11 +1,20 @@
 #include "CelestialBody.hpp"
 
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/trigonometric.hpp>
 
 #include "core/helpers.hpp"
 #include "core/Log.h"
 
+#include <cmath>
+
+float evaluate_rotation_angle(float speed, std::chrono::duration<double> time)
+{
+	auto const angle = std::fmod(static_cast<double>(speed) * time.count(), glm::two_pi<double>());
+	return static_cast<float>(angle < 0.0 ? angle + glm::two_pi<double>() : angle);
+}
+
 CelestialBody::CelestialBody(bonobo::mesh_data const& shape,
                              GLuint const* program,
                              GLuint diffuse_texture_id)
@@ -46,6 +55,15 @@ glm::mat4 CelestialBody::render(std::chrono::microseconds elapsed_time,
 	return parent_transform;
 }
 
+void CelestialBody::set_time(std::chrono::duration<double> time)
+{
+	_body.orbit.rotation_angle = evaluate_rotation_angle(_body.orbit.speed, time);
+	_body.spin.rotation_angle = evaluate_rotation_angle(_body.spin.speed, time);
+
+	for (auto child : _children)
+		child->set_time(time);
+}
+
 void CelestialBody::add_child(CelestialBody* child)
 {
 	_children.push_back(child);
@@ -6,6 +6,8 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
+#include <chrono>
+
 struct SpinConfiguration
 {
 	float axial_tilt{0.0f}; //!< Angle in radians between the body's rotational and orbital axis.
@@ -19,6 +21,18 @@ struct OrbitConfiguration
 	float speed{0.0f};       //!< Rotation speed in radians per second.
 };
 
+//! \brief Compute how much a body rotating at a constant speed has rotated
+//!        after a given amount of time.
+//!
+//! The angle is computed and reduced to [0, 2π[ in double precision before
+//! being converted to single precision, so that it stays accurate even
+//! for very large times.
+//!
+//! @param [in] speed Rotation speed in radians per second
+//! @param [in] time Time elapsed since the angle was zero
+//! @return the rotation angle, in radians
+float evaluate_rotation_angle(float speed, std::chrono::duration<double> time);
+
 //! \brief Represents a celestial body
 class CelestialBody
 {
@@ -51,6 +65,15 @@ public:
 	                 glm::mat4 const& parent_transform = glm::mat4(1.0f),
 	                 bool show_basis = false);
 
+	//! \brief Set the animation of this celestial body, and of all its
+	//!        children, to an absolute time.
+	//!
+	//! The orbit and spin angles are evaluated in closed form rather than
+	//! by accumulating the elapsed times of all previous frames.
+	//!
+	//! @param [in] time Time since the start of the animation
+	void set_time(std::chrono::duration<double> time);
+
 	//! \brief Mark another celestial body as being “attached” to the current one.
 	void add_child(CelestialBody* child);
 
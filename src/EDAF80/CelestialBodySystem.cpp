@@ -0,0 +1,288 @@
+#include "CelestialBodySystem.hpp"
+
+#include "core/Log.h"
+#include "core/opengl.hpp"
+#include "core/various.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+constexpr std::uint32_t CelestialBodySystem::no_parent;
+constexpr GLuint CelestialBodySystem::instance_transform_location;
+
+CelestialBodySystem::~CelestialBodySystem()
+{
+	glDeleteBuffers(1, &_instance_buffer);
+	_instance_buffer = 0u;
+}
+
+std::uint32_t CelestialBodySystem::add_group(bonobo::mesh_data const& shape, GLuint diffuse_texture_id)
+{
+	if (_instance_buffer == 0u) {
+		glGenBuffers(1, &_instance_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, _instance_buffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+		utils::opengl::debug::nameObject(GL_BUFFER, _instance_buffer, "Celestial bodies instance transforms");
+		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	}
+
+	// The per-instance attributes are added to the VAO of the shape; other
+	// programs using that VAO will simply ignore them.
+	glBindVertexArray(shape.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, _instance_buffer);
+	for (GLuint column = 0u; column < 4u; ++column) {
+		glEnableVertexAttribArray(instance_transform_location + column);
+		glVertexAttribPointer(instance_transform_location + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+		                      reinterpret_cast<GLvoid const*>(column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(instance_transform_location + column, 1u);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	glBindVertexArray(0u);
+
+	Group group;
+	group.vao = shape.vao;
+	group.vertices_nb = shape.vertices_nb;
+	group.indices_nb = shape.indices_nb;
+	group.drawing_mode = shape.drawing_mode;
+	group.has_indices = shape.ibo != 0u;
+	group.diffuse_texture_id = diffuse_texture_id;
+	_groups.emplace_back(std::move(group));
+
+	return static_cast<std::uint32_t>(_groups.size() - 1u);
+}
+
+std::uint32_t CelestialBodySystem::add_body(std::uint32_t group, glm::vec3 const& scale,
+                                            SpinConfiguration const& spin,
+                                            OrbitConfiguration const& orbit,
+                                            std::uint32_t parent)
+{
+	if (group >= _groups.size()) {
+		LogError("Invalid group index %u: only %zu groups are registered.", group, _groups.size());
+		return no_parent;
+	}
+	if (parent != no_parent && parent >= _parents.size()) {
+		LogError("Invalid parent index %u: a parent has to be added before its children.", parent);
+		return no_parent;
+	}
+
+	auto const index = static_cast<std::uint32_t>(_parents.size());
+
+	_parents.push_back(parent);
+	_orbit_radii.push_back(orbit.radius);
+	_orbit_inclinations.push_back(orbit.inclination);
+	_orbit_speeds.push_back(orbit.speed);
+	_orbit_angles.push_back(0.0f);
+	_spin_axial_tilts.push_back(spin.axial_tilt);
+	_spin_speeds.push_back(spin.speed);
+	_spin_angles.push_back(0.0f);
+	_scales.push_back(scale);
+	_orbit_frames.emplace_back(1.0f);
+	_world_transforms.emplace_back(1.0f);
+	_depths.push_back(parent != no_parent ? _depths[parent] + 1u : 0u);
+
+	_groups[group].bodies.push_back(index);
+	_are_levels_dirty = true;
+
+	return index;
+}
+
+void CelestialBodySystem::update(std::chrono::microseconds elapsed_time)
+{
+	seek(_time + elapsed_time);
+}
+
+void CelestialBodySystem::seek(std::chrono::duration<double> time)
+{
+	_time = time;
+
+	utils::parallel_for(_parents.size(), [this](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i) {
+			_orbit_angles[i] = evaluate_rotation_angle(_orbit_speeds[i], _time);
+			_spin_angles[i] = evaluate_rotation_angle(_spin_speeds[i], _time);
+		}
+	});
+
+	compute_world_transforms();
+}
+
+std::chrono::duration<double> CelestialBodySystem::get_time() const
+{
+	return _time;
+}
+
+void CelestialBodySystem::compute_world_transforms()
+{
+	if (_are_levels_dirty)
+		update_levels();
+
+	if (_is_camera_relative) {
+		_orbit_frames_d.resize(_parents.size());
+		_world_transforms_d.resize(_parents.size());
+		compute_world_transforms(_orbit_frames_d, _world_transforms_d);
+	} else {
+		compute_world_transforms(_orbit_frames, _world_transforms);
+	}
+}
+
+template<typename T>
+void CelestialBodySystem::compute_world_transforms(std::vector<glm::tmat4x4<T, glm::defaultp>>& orbit_frames,
+                                                   std::vector<glm::tmat4x4<T, glm::defaultp>>& world_transforms)
+{
+	using mat4 = glm::tmat4x4<T, glm::defaultp>;
+	using vec3 = glm::tvec3<T, glm::defaultp>;
+
+	// Compute the world matrices one level at a time, so that the parents'
+	// matrices are always ready.
+	for (auto const& level : _levels) {
+		utils::parallel_for(level.size(), [this, &level, &orbit_frames, &world_transforms](std::size_t begin, std::size_t end) {
+			for (std::size_t j = begin; j < end; ++j) {
+				auto const i = level[j];
+				auto const parent = _parents[i];
+				auto const& parent_frame = parent != no_parent ? orbit_frames[parent] : mat4(T(1));
+
+				auto orbit_frame = glm::rotate(parent_frame, static_cast<T>(_orbit_inclinations[i]), vec3(0, 0, 1));
+				orbit_frame = glm::rotate(orbit_frame, static_cast<T>(_orbit_angles[i]), vec3(0, 1, 0));
+				orbit_frame = glm::translate(orbit_frame, vec3(_orbit_radii[i], 0, 0));
+				orbit_frames[i] = orbit_frame;
+
+				auto world = glm::rotate(orbit_frame, static_cast<T>(_spin_axial_tilts[i]), vec3(0, 0, 1));
+				world = glm::rotate(world, static_cast<T>(_spin_angles[i]), vec3(0, 1, 0));
+				world_transforms[i] = glm::scale(world, vec3(_scales[i]));
+			}
+		});
+	}
+}
+
+void CelestialBodySystem::render(glm::mat4 const& view_projection, GLuint program)
+{
+	if (program == 0u || _parents.empty())
+		return;
+
+	// Gather the world matrices so that the bodies of each group are
+	// contiguous in the instance buffer.
+	_instance_data.resize(_parents.size());
+	std::size_t offset = 0u;
+	for (auto const& group : _groups) {
+		for (auto const body : group.bodies)
+			_instance_data[offset++] = get_world_transform(body);
+	}
+
+	draw(view_projection, program);
+}
+
+void CelestialBodySystem::render(glm::dvec3 const& camera_position,
+                                 glm::mat4 const& camera_relative_view_projection,
+                                 GLuint program)
+{
+	if (program == 0u || _parents.empty())
+		return;
+
+	// Same as above, but moving the bodies relative to the camera; this is
+	// done in double precision, before rounding to single precision, when
+	// the world matrices are available in double precision.
+	_instance_data.resize(_parents.size());
+	std::size_t offset = 0u;
+	for (auto const& group : _groups) {
+		for (auto const body : group.bodies) {
+			if (_is_camera_relative) {
+				auto world = _world_transforms_d[body];
+				world[3] -= glm::dvec4(camera_position, 0.0);
+				_instance_data[offset++] = glm::mat4(world);
+			} else {
+				auto world = _world_transforms[body];
+				world[3] -= glm::vec4(glm::vec3(camera_position), 0.0f);
+				_instance_data[offset++] = world;
+			}
+		}
+	}
+
+	draw(camera_relative_view_projection, program);
+}
+
+void CelestialBodySystem::draw(glm::mat4 const& view_projection, GLuint program)
+{
+	utils::opengl::debug::beginDebugGroup("Render celestial body system");
+
+	glBindBuffer(GL_ARRAY_BUFFER, _instance_buffer);
+	// Orphan the previous storage, to avoid waiting on draws still using it.
+	glBufferData(GL_ARRAY_BUFFER, _instance_data.size() * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, _instance_data.size() * sizeof(glm::mat4), _instance_data.data());
+
+	glUseProgram(program);
+	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_world_to_clip"), 1, GL_FALSE, glm::value_ptr(view_projection));
+	glUniform1i(glGetUniformLocation(program, "diffuse_texture"), 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	std::size_t offset = 0u;
+	for (auto const& group : _groups) {
+		if (group.bodies.empty())
+			continue;
+
+		glUniform1i(glGetUniformLocation(program, "has_diffuse_texture"), group.diffuse_texture_id != 0u ? 1 : 0);
+		glBindTexture(GL_TEXTURE_2D, group.diffuse_texture_id);
+
+		// OpenGL 4.1 has no base instance, so move the start of the
+		// per-instance attributes to the first body of the group instead.
+		glBindVertexArray(group.vao);
+		for (GLuint column = 0u; column < 4u; ++column) {
+			glVertexAttribPointer(instance_transform_location + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+			                      reinterpret_cast<GLvoid const*>(offset * sizeof(glm::mat4) + column * sizeof(glm::vec4)));
+		}
+
+		auto const instances_nb = static_cast<GLsizei>(group.bodies.size());
+		if (group.has_indices)
+			glDrawElementsInstanced(group.drawing_mode, group.indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0), instances_nb);
+		else
+			glDrawArraysInstanced(group.drawing_mode, 0, group.vertices_nb, instances_nb);
+
+		offset += group.bodies.size();
+	}
+
+	glBindVertexArray(0u);
+	glBindTexture(GL_TEXTURE_2D, 0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	glUseProgram(0u);
+
+	utils::opengl::debug::endDebugGroup();
+}
+
+std::size_t CelestialBodySystem::get_bodies_nb() const
+{
+	return _parents.size();
+}
+
+glm::mat4 CelestialBodySystem::get_world_transform(std::uint32_t body) const
+{
+	return _is_camera_relative ? glm::mat4(_world_transforms_d[body]) : _world_transforms[body];
+}
+
+void CelestialBodySystem::set_camera_relative(bool is_camera_relative)
+{
+	if (is_camera_relative == _is_camera_relative)
+		return;
+
+	_is_camera_relative = is_camera_relative;
+	if (!_is_camera_relative) {
+		_orbit_frames_d.clear();
+		_orbit_frames_d.shrink_to_fit();
+		_world_transforms_d.clear();
+		_world_transforms_d.shrink_to_fit();
+	}
+	compute_world_transforms();
+}
+
+bool CelestialBodySystem::is_camera_relative() const
+{
+	return _is_camera_relative;
+}
+
+void CelestialBodySystem::update_levels()
+{
+	_levels.clear();
+	for (std::uint32_t i = 0u; i < _depths.size(); ++i) {
+		if (_depths[i] >= _levels.size())
+			_levels.resize(_depths[i] + 1u);
+		_levels[_depths[i]].push_back(i);
+	}
+	_are_levels_dirty = false;
+}
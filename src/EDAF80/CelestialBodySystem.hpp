@@ -0,0 +1,184 @@
+#pragma once
+
+#include "CelestialBody.hpp"
+
+#include "core/helpers.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+//! \brief Data-oriented simulation of a large amount of celestial bodies.
+//!
+//! Contrary to `CelestialBody`, which updates its animation state while
+//! being rendered and references its children through pointers, all bodies
+//! are stored here in a table with one array per attribute. The simulation
+//! is updated for all bodies at once, spread over all CPU cores, and the
+//! bodies are then rendered with one instanced draw call per group of bodies
+//! sharing the same geometry and texture.
+//!
+//! A body can only be attached to a body which was added before it, so
+//! iterating over the bodies by increasing index always visits parents before
+//! their children.
+class CelestialBodySystem
+{
+public:
+	//! \brief Value used as parent index for bodies without a parent.
+	static constexpr std::uint32_t no_parent = ~0u;
+
+	CelestialBodySystem() = default;
+	~CelestialBodySystem();
+	CelestialBodySystem(CelestialBodySystem const&) = delete;
+	CelestialBodySystem& operator=(CelestialBodySystem const&) = delete;
+
+	//! \brief Register a geometry and texture pair, which can then be
+	//!        shared by many bodies.
+	//!
+	//! @param [in] shape Geometry used by all bodies of that group; its VAO
+	//!             will be extended with the per-instance attributes.
+	//! @param [in] diffuse_texture_id Identifier of the diffuse texture
+	//!             used by all bodies of that group
+	//! @return the index of the newly created group
+	std::uint32_t add_group(bonobo::mesh_data const& shape, GLuint diffuse_texture_id);
+
+	//! \brief Add a new body to the system.
+	//!
+	//! @param [in] group Index of the group, as returned by `add_group()`
+	//! @param [in] scale Scale of the body
+	//! @param [in] spin Spin parameters of the body
+	//! @param [in] orbit Orbit parameters of the body, relative to its
+	//!             parent
+	//! @param [in] parent Index of the body it orbits around, which must
+	//!             have been added before, or `no_parent`
+	//! @return the index of the newly added body, or `no_parent` if the
+	//!         body could not be added
+	std::uint32_t add_body(std::uint32_t group, glm::vec3 const& scale,
+	                       SpinConfiguration const& spin,
+	                       OrbitConfiguration const& orbit,
+	                       std::uint32_t parent = no_parent);
+
+	//! \brief Advance the animation of all bodies and compute their world
+	//!        matrices.
+	//!
+	//! This is equivalent to calling `seek()` with the current animation
+	//! time plus |elapsed_time|: angles are never integrated frame after
+	//! frame, so they do not drift.
+	//!
+	//! @param [in] elapsed_time Amount of time (in microseconds) between
+	//!             two frames
+	void update(std::chrono::microseconds elapsed_time);
+
+	//! \brief Set the animation of all bodies to an absolute time, and
+	//!        compute their world matrices.
+	//!
+	//! All angles are evaluated in closed form, as speed multiplied by
+	//! time and reduced to [0, 2π[ using double precision, so the cost
+	//! does not depend on how far the animation jumps.
+	//!
+	//! @param [in] time Time since the start of the animation, which can
+	//!             also be negative
+	void seek(std::chrono::duration<double> time);
+
+	//! \brief Return the current animation time.
+	std::chrono::duration<double> get_time() const;
+
+	//! \brief Render all bodies using the world matrices computed by the
+	//!        last call to `update()`.
+	//!
+	//! @param [in] view_projection Matrix transforming from world space to
+	//!             clip space
+	//! @param [in] program Shader program reading the model-to-world
+	//!             matrix from the per-instance attribute at location
+	//!             `instance_transform_location`
+	void render(glm::mat4 const& view_projection, GLuint program);
+
+	//! \brief Render all bodies relative to the camera.
+	//!
+	//! The camera position is subtracted from the world matrices on the
+	//! CPU, in double precision if camera-relative mode is enabled, so the
+	//! GPU only ever sees small offsets and far away bodies do not jitter.
+	//!
+	//! @param [in] camera_position Position of the camera in world space
+	//! @param [in] camera_relative_view_projection Matrix transforming
+	//!             from world space, translated so that the camera is at
+	//!             its origin, to clip space; see
+	//!             `FPSCamera::GetCameraRelativeWorldToClipMatrix()`.
+	//! @param [in] program Shader program reading the model-to-world
+	//!             matrix from the per-instance attribute at location
+	//!             `instance_transform_location`
+	void render(glm::dvec3 const& camera_position,
+	            glm::mat4 const& camera_relative_view_projection,
+	            GLuint program);
+
+	//! \brief Select whether world matrices are computed and kept in
+	//!        double precision, for use with camera-relative rendering.
+	void set_camera_relative(bool is_camera_relative);
+
+	//! \brief Return whether world matrices are kept in double precision.
+	bool is_camera_relative() const;
+
+	//! \brief Return how many bodies are part of the system.
+	std::size_t get_bodies_nb() const;
+
+	//! \brief Return the world matrix of a body, as computed by the last
+	//!        call to `update()`.
+	glm::mat4 get_world_transform(std::uint32_t body) const;
+
+	//! \brief First attribute location used by the per-instance
+	//!        model-to-world matrix; it occupies four consecutive
+	//!        locations, right after those of `bonobo::shader_bindings`.
+	static constexpr GLuint instance_transform_location = 5u;
+
+private:
+	void update_levels();
+	void compute_world_transforms();
+	template<typename T>
+	void compute_world_transforms(std::vector<glm::tmat4x4<T, glm::defaultp>>& orbit_frames,
+	                              std::vector<glm::tmat4x4<T, glm::defaultp>>& world_transforms);
+	void draw(glm::mat4 const& view_projection, GLuint program);
+
+	struct Group {
+		GLuint vao{0u};
+		GLsizei vertices_nb{0};
+		GLsizei indices_nb{0};
+		GLenum drawing_mode{GL_TRIANGLES};
+		bool has_indices{false};
+		GLuint diffuse_texture_id{0u};
+		std::vector<std::uint32_t> bodies;
+	};
+	std::vector<Group> _groups;
+
+	// Per-body attributes
+	std::vector<std::uint32_t> _parents;
+	std::vector<float> _orbit_radii;
+	std::vector<float> _orbit_inclinations;
+	std::vector<float> _orbit_speeds;
+	std::vector<float> _orbit_angles;
+	std::vector<float> _spin_axial_tilts;
+	std::vector<float> _spin_speeds;
+	std::vector<float> _spin_angles;
+	std::vector<glm::vec3> _scales;
+
+	// Per-body results of the update
+	std::vector<glm::mat4> _orbit_frames; //!< Transform inherited by the children, i.e. without spin nor scale.
+	std::vector<glm::mat4> _world_transforms;
+	// Only filled in camera-relative mode, instead of the two above.
+	std::vector<glm::dmat4> _orbit_frames_d;
+	std::vector<glm::dmat4> _world_transforms_d;
+	bool _is_camera_relative{false};
+
+	// Bodies sorted by depth in the hierarchy: all bodies of a given level
+	// only depend on bodies from previous levels and can be processed
+	// concurrently.
+	std::vector<std::uint32_t> _depths;
+	std::vector<std::vector<std::uint32_t>> _levels;
+	bool _are_levels_dirty{false};
+
+	std::chrono::duration<double> _time{0.0};
+
+	GLuint _instance_buffer{0u};
+	std::vector<glm::mat4> _instance_data;
+};
@@ -1,4 +1,5 @@
 #include "CelestialBody.hpp"
+#include "CelestialBodySystem.hpp"
 #include "config.hpp"
 #include "parametric_shapes.hpp"
 #include "core/Bonobo.h"
@@ -10,7 +11,9 @@
 #include <imgui.h>
 
 #include <clocale>
+#include <cmath>
 #include <cstdlib>
+#include <random>
 
 
 int main()
@@ -95,6 +98,20 @@ int main()
 	}
 
 
+	GLuint celestial_body_instanced_shader = 0u;
+	program_manager.CreateAndRegisterProgram("Celestial Body (instanced)",
+	                                         { { ShaderType::vertex, "EDAF80/celestial_body_instanced.vert" },
+	                                           { ShaderType::fragment, "EDAF80/default.frag" } },
+	                                         celestial_body_instanced_shader);
+	if (celestial_body_instanced_shader == 0u) {
+		LogError("Failed to generate the “Celestial Body (instanced)” shader program: exiting.");
+
+		bonobo::deinit();
+
+		return EXIT_FAILURE;
+	}
+
+
 	//
 	// Define all the celestial bodies constants.
 	//
@@ -169,6 +186,44 @@ int main()
 	earth.add_child(&moon);
 
 
+	//
+	// Set up a large asteroid belt, simulated and rendered using the
+	// data-oriented celestial body system rather than `CelestialBody`.
+	//
+	constexpr std::size_t asteroids_nb = 100000u;
+	constexpr std::size_t asteroids_per_moon = 10u;
+
+	// Asteroids are tiny, so use a coarse sphere if one is available.
+	auto const asteroid_shape = parametric_shapes::createSphere(1.0f, 8u, 6u);
+	bonobo::mesh_data const& asteroid_geometry = asteroid_shape.vao != 0u ? asteroid_shape : sphere;
+
+	CelestialBodySystem asteroid_belt;
+	auto const asteroid_belt_sun_group = asteroid_belt.add_group(sphere, sun_texture);
+	auto const asteroid_group = asteroid_belt.add_group(asteroid_geometry, moon_texture);
+	auto const asteroid_belt_sun = asteroid_belt.add_body(asteroid_belt_sun_group, sun_scale, sun_spin, OrbitConfiguration{});
+
+	std::mt19937 random_engine(42u);
+	std::uniform_real_distribution<float> radius_distribution(6.0f, 11.0f);
+	std::uniform_real_distribution<float> inclination_distribution(glm::radians(-3.0f), glm::radians(3.0f));
+	std::uniform_real_distribution<float> scale_distribution(0.005f, 0.02f);
+	std::uniform_real_distribution<float> spin_speed_distribution(-glm::two_pi<float>(), glm::two_pi<float>());
+	for (std::size_t i = 0; i < asteroids_nb; ++i) {
+		auto const radius = radius_distribution(random_engine);
+		// Follow Kepler's third law, relative to the Earth's orbit.
+		auto const orbit_speed = earth_orbit.speed * std::pow(earth_orbit.radius / radius, 1.5f);
+		auto const asteroid = asteroid_belt.add_body(asteroid_group,
+		                                             glm::vec3(scale_distribution(random_engine)),
+		                                             { inclination_distribution(random_engine), spin_speed_distribution(random_engine) },
+		                                             { radius, inclination_distribution(random_engine), orbit_speed },
+		                                             asteroid_belt_sun);
+		if (i % asteroids_per_moon == 0u) {
+			asteroid_belt.add_body(asteroid_group, glm::vec3(0.004f), moon_spin,
+			                       { 0.05f, inclination_distribution(random_engine), moon_orbit.speed },
+			                       asteroid);
+		}
+	}
+
+
 	//
 	// Define the colour and depth used for clearing.
 	//
@@ -178,13 +233,18 @@ int main()
 
 
 	auto last_time = std::chrono::high_resolution_clock::now();
+	std::chrono::high_resolution_clock::duration asteroid_belt_update_time{ 0 };
+	std::chrono::high_resolution_clock::duration asteroid_belt_render_time{ 0 };
 
 
 	bool pause_animation = false;
 	bool show_logs = true;
 	bool show_gui = true;
 	bool show_basis = false;
+	bool show_asteroid_belt = false;
+	bool use_camera_relative_rendering = false;
 	float time_scale = 1.0f;
+	double seek_time_s = 0.0;
 
 	while (!glfwWindowShouldClose(window)) {
 		//
@@ -252,6 +312,23 @@ int main()
 		earth.render(animation_delta_time_us, camera.GetWorldToClipMatrix(), glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, 0.0f)), show_basis);
 		//moon.render(animation_delta_time_us, camera.GetWorldToClipMatrix(), glm::mat4(1.0f), show_basis);
 
+		if (show_asteroid_belt) {
+			auto const update_start_time = std::chrono::high_resolution_clock::now();
+			asteroid_belt.update(animation_delta_time_us);
+			asteroid_belt_update_time = std::chrono::high_resolution_clock::now() - update_start_time;
+
+			// Only the CPU side of the rendering is measured: it is where
+			// the extra cost of camera-relative rendering lies.
+			auto const render_start_time = std::chrono::high_resolution_clock::now();
+			if (use_camera_relative_rendering)
+				asteroid_belt.render(glm::dvec3(camera.mWorld.GetTranslation()),
+				                     camera.GetCameraRelativeWorldToClipMatrix(),
+				                     celestial_body_instanced_shader);
+			else
+				asteroid_belt.render(camera.GetWorldToClipMatrix(), celestial_body_instanced_shader);
+			asteroid_belt_render_time = std::chrono::high_resolution_clock::now() - render_start_time;
+		}
+
 
 		//
 		// Add controls to the scene.
@@ -261,8 +338,24 @@ int main()
 		{
 			ImGui::Checkbox("Pause the animation", &pause_animation);
 			ImGui::SliderFloat("Time scale", &time_scale, 1e-1f, 10.0f);
+			ImGui::InputDouble("Animation time (s)", &seek_time_s);
+			if (ImGui::Button("Seek")) {
+				auto const seek_time = std::chrono::duration<double>(seek_time_s);
+				earth.set_time(seek_time);
+				asteroid_belt.seek(seek_time);
+			}
 			ImGui::Separator();
 			ImGui::Checkbox("Show basis", &show_basis);
+			ImGui::Separator();
+			ImGui::Checkbox("Show asteroid belt", &show_asteroid_belt);
+			if (show_asteroid_belt) {
+				if (ImGui::Checkbox("Camera-relative rendering (double precision)", &use_camera_relative_rendering))
+					asteroid_belt.set_camera_relative(use_camera_relative_rendering);
+				ImGui::Text("%zu bodies updated in %.3f ms", asteroid_belt.get_bodies_nb(),
+				            std::chrono::duration<float, std::milli>(asteroid_belt_update_time).count());
+				ImGui::Text("Instance data prepared and submitted in %.3f ms",
+				            std::chrono::duration<float, std::milli>(asteroid_belt_render_time).count());
+			}
 		}
 		ImGui::End();
 
@@ -0,0 +1,169 @@
+#include "interpolation_batch.hpp"
+
+#if defined(__AVX__)
+#	include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	include <arm_neon.h>
+#endif
+
+namespace
+{
+	// Minimal set of operations needed by the batch kernels; the scalar
+	// overloads are used for the fallback path and for the remaining
+	// elements which do not fill a whole vector.
+	inline void vstore(float* p, float v) { *p = v; }
+	inline float vadd(float a, float b) { return a + b; }
+	inline float vsub(float a, float b) { return a - b; }
+	inline float vmul(float a, float b) { return a * b; }
+
+#if defined(__AVX__)
+	using vfloat = __m256;
+	constexpr std::size_t lane_count = 8u;
+	inline vfloat vset1_v(float v) { return _mm256_set1_ps(v); }
+	inline vfloat vload_v(float const* p) { return _mm256_loadu_ps(p); }
+	inline void vstore(float* p, vfloat v) { _mm256_storeu_ps(p, v); }
+	inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+	inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+	inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	using vfloat = __m128;
+	constexpr std::size_t lane_count = 4u;
+	inline vfloat vset1_v(float v) { return _mm_set1_ps(v); }
+	inline vfloat vload_v(float const* p) { return _mm_loadu_ps(p); }
+	inline void vstore(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+	inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+	inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+	inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	using vfloat = float32x4_t;
+	constexpr std::size_t lane_count = 4u;
+	inline vfloat vset1_v(float v) { return vdupq_n_f32(v); }
+	inline vfloat vload_v(float const* p) { return vld1q_f32(p); }
+	inline void vstore(float* p, vfloat v) { vst1q_f32(p, v); }
+	inline vfloat vadd(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+	inline vfloat vsub(vfloat a, vfloat b) { return vsubq_f32(a, b); }
+	inline vfloat vmul(vfloat a, vfloat b) { return vmulq_f32(a, b); }
+#else
+	using vfloat = float;
+	constexpr std::size_t lane_count = 1u;
+	inline vfloat vset1_v(float v) { return v; }
+	inline vfloat vload_v(float const* p) { return *p; }
+#endif
+
+	template<typename V>
+	V lerp_kernel(V const& p0, V const& p1, V const& x)
+	{
+		return vadd(p0, vmul(x, vsub(p1, p0)));
+	}
+
+	// Evaluate the Catmull-Rom basis functions, i.e. the row vector
+	// [1 x x² x³] multiplied by the tension-dependent matrix, using Horner's
+	// scheme, and apply the resulting weights to the four control points.
+	template<typename V>
+	V catmull_rom_kernel(V const& p0, V const& p1, V const& p2, V const& p3,
+	              V const& x, V const& t, V const& one, V const& two, V const& three)
+	{
+		auto const x2 = vmul(x, x);
+		auto const two_t = vadd(t, t);
+
+		auto const w0 = vmul(x, vsub(vmul(x, vsub(two_t, vmul(t, x))), t));
+		auto const w1 = vadd(one, vmul(x2, vadd(vsub(t, three), vmul(vsub(two, t), x))));
+		auto const w2 = vmul(x, vadd(t, vmul(x, vadd(vsub(three, two_t), vmul(vsub(t, two), x)))));
+		auto const w3 = vmul(vmul(t, x2), vsub(x, one));
+
+		return vadd(vadd(vmul(w0, p0), vmul(w1, p1)),
+		            vadd(vmul(w2, p2), vmul(w3, p3)));
+	}
+
+	std::size_t wrap(std::int64_t index, std::size_t count)
+	{
+		auto const n = static_cast<std::int64_t>(count);
+		return static_cast<std::size_t>(((index % n) + n) % n);
+	}
+}
+
+void
+interpolation::evalLERPBatch(ControlPointsSoA const& points,
+                             std::uint32_t const* segments, float const* xs,
+                             std::size_t count, PositionsSoA const& positions)
+{
+	if (points.count < 2u || count == 0u)
+		return;
+
+	std::size_t i = 0u;
+	if (lane_count > 1u) {
+		// Gather the control points of each lane into contiguous
+		// storage, so they can be loaded as a single vector.
+		float p0[3][lane_count], p1[3][lane_count];
+		for (; i + lane_count <= count; i += lane_count) {
+			for (std::size_t lane = 0u; lane < lane_count; ++lane) {
+				auto const i0 = wrap(segments[i + lane], points.count);
+				auto const i1 = wrap(static_cast<std::int64_t>(segments[i + lane]) + 1, points.count);
+				p0[0][lane] = points.x[i0]; p1[0][lane] = points.x[i1];
+				p0[1][lane] = points.y[i0]; p1[1][lane] = points.y[i1];
+				p0[2][lane] = points.z[i0]; p1[2][lane] = points.z[i1];
+			}
+
+			auto const x = vload_v(xs + i);
+			vstore(positions.x + i, lerp_kernel(vload_v(p0[0]), vload_v(p1[0]), x));
+			vstore(positions.y + i, lerp_kernel(vload_v(p0[1]), vload_v(p1[1]), x));
+			vstore(positions.z + i, lerp_kernel(vload_v(p0[2]), vload_v(p1[2]), x));
+		}
+	}
+
+	for (; i < count; ++i) {
+		auto const i0 = wrap(segments[i], points.count);
+		auto const i1 = wrap(static_cast<std::int64_t>(segments[i]) + 1, points.count);
+		positions.x[i] = lerp_kernel(points.x[i0], points.x[i1], xs[i]);
+		positions.y[i] = lerp_kernel(points.y[i0], points.y[i1], xs[i]);
+		positions.z[i] = lerp_kernel(points.z[i0], points.z[i1], xs[i]);
+	}
+}
+
+void
+interpolation::evalCatmullRomBatch(ControlPointsSoA const& points, float const t,
+                                   std::uint32_t const* segments, float const* xs,
+                                   std::size_t count, PositionsSoA const& positions)
+{
+	if (points.count < 2u || count == 0u)
+		return;
+
+	std::size_t i = 0u;
+	if (lane_count > 1u) {
+		auto const vt = vset1_v(t);
+		auto const one = vset1_v(1.0f);
+		auto const two = vset1_v(2.0f);
+		auto const three = vset1_v(3.0f);
+
+		float p[4][3][lane_count];
+		for (; i + lane_count <= count; i += lane_count) {
+			for (std::size_t lane = 0u; lane < lane_count; ++lane) {
+				auto const segment = static_cast<std::int64_t>(segments[i + lane]);
+				for (std::int64_t k = 0; k < 4; ++k) {
+					auto const index = wrap(segment + k - 1, points.count);
+					p[k][0][lane] = points.x[index];
+					p[k][1][lane] = points.y[index];
+					p[k][2][lane] = points.z[index];
+				}
+			}
+
+			auto const x = vload_v(xs + i);
+			vstore(positions.x + i, catmull_rom_kernel(vload_v(p[0][0]), vload_v(p[1][0]), vload_v(p[2][0]), vload_v(p[3][0]), x, vt, one, two, three));
+			vstore(positions.y + i, catmull_rom_kernel(vload_v(p[0][1]), vload_v(p[1][1]), vload_v(p[2][1]), vload_v(p[3][1]), x, vt, one, two, three));
+			vstore(positions.z + i, catmull_rom_kernel(vload_v(p[0][2]), vload_v(p[1][2]), vload_v(p[2][2]), vload_v(p[3][2]), x, vt, one, two, three));
+		}
+	}
+
+	for (; i < count; ++i) {
+		auto const segment = static_cast<std::int64_t>(segments[i]);
+		auto const i0 = wrap(segment - 1, points.count);
+		auto const i1 = wrap(segment, points.count);
+		auto const i2 = wrap(segment + 1, points.count);
+		auto const i3 = wrap(segment + 2, points.count);
+		positions.x[i] = catmull_rom_kernel(points.x[i0], points.x[i1], points.x[i2], points.x[i3], xs[i], t, 1.0f, 2.0f, 3.0f);
+		positions.y[i] = catmull_rom_kernel(points.y[i0], points.y[i1], points.y[i2], points.y[i3], xs[i], t, 1.0f, 2.0f, 3.0f);
+		positions.z[i] = catmull_rom_kernel(points.z[i0], points.z[i1], points.z[i2], points.z[i3], xs[i], t, 1.0f, 2.0f, 3.0f);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Batch versions of the functions from interpolation.hpp; they are not
+// part of the assignment, and are therefore kept out of interpolation.cpp.
+
+namespace interpolation
+{
+	//! \brief Read-only view over control points stored as a structure
+	//!        of arrays, i.e. all x-coordinates followed by all
+	//!        y-coordinates and so on.
+	struct ControlPointsSoA {
+		float const* x{nullptr};  //!< x-coordinates of the control points
+		float const* y{nullptr};  //!< y-coordinates of the control points
+		float const* z{nullptr};  //!< z-coordinates of the control points
+		std::size_t count{0u};    //!< number of control points
+	};
+
+	//! \brief Writable view over positions stored as a structure of
+	//!        arrays; each array should be able to hold as many elements
+	//!        as positions are being evaluated.
+	struct PositionsSoA {
+		float* x{nullptr};
+		float* y{nullptr};
+		float* z{nullptr};
+	};
+
+	//! \brief Evaluate many linear interpolations at once.
+	//!
+	//! The control points are considered to form a closed path: the
+	//! segment i goes from point i to point (i + 1) modulo the amount of
+	//! control points.
+	//!
+	//! The work is done using SSE, AVX or NEON instructions when the
+	//! compiler targets them, and using a scalar loop otherwise; the
+	//! results match those of `evalLERP()` up to floating-point rounding.
+	//!
+	//! @param [in] points control points to interpolate between; there
+	//!             should be at least two of them
+	//! @param [in] segments for each evaluation, the index of the segment
+	//!             to use
+	//! @param [in] xs for each evaluation, the distance ratio along the
+	//!             segment (see `evalLERP()`)
+	//! @param [in] count number of evaluations to perform
+	//! @param [out] positions where to write the interpolated positions
+	void evalLERPBatch(ControlPointsSoA const& points,
+	                   std::uint32_t const* segments, float const* xs,
+	                   std::size_t count, PositionsSoA const& positions);
+
+	//! \brief Evaluate many Catmull-Rom spline interpolations at once.
+	//!
+	//! The control points are considered to form a closed path: the
+	//! segment i goes from point i to point (i + 1), using points (i - 1)
+	//! and (i + 2) as outer control points, all indices being taken modulo
+	//! the amount of control points.
+	//!
+	//! The work is done using SSE, AVX or NEON instructions when the
+	//! compiler targets them, and using a scalar loop otherwise; the
+	//! results match those of `evalCatmullRom()` up to floating-point
+	//! rounding.
+	//!
+	//! @param [in] points control points defining the spline; there
+	//!             should be at least two of them
+	//! @param [in] t tension
+	//! @param [in] segments for each evaluation, the index of the segment
+	//!             to use
+	//! @param [in] xs for each evaluation, the distance ratio along the
+	//!             segment (see `evalCatmullRom()`)
+	//! @param [in] count number of evaluations to perform
+	//! @param [out] positions where to write the interpolated positions
+	void evalCatmullRomBatch(ControlPointsSoA const& points, float const t,
+	                         std::uint32_t const* segments, float const* xs,
+	                         std::size_t count, PositionsSoA const& positions);
+}
@@ -0,0 +1,221 @@
+#include "interpolation_batch.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// Checks the batch interpolation functions against a reference written
+// independently from them, and measures their throughput.
+//
+// This program contains a solution to the interpolation part of EDAF80
+// assignment 2, and is therefore only built when the
+// LUGGCGL_BUILD_INTERPOLATION_BATCH option is enabled.
+
+namespace
+{
+	using Point = std::array<double, 3>;
+
+	//! \brief Reference linear interpolation, in double precision.
+	Point referenceLERP(Point const& p0, Point const& p1, double const x)
+	{
+		Point result;
+		for (std::size_t c = 0; c < 3; ++c)
+			result[c] = (1.0 - x) * p0[c] + x * p1[c];
+		return result;
+	}
+
+	//! \brief Reference Catmull-Rom interpolation, in double precision,
+	//!        computed as the product [1 x x² x³] · M(t) · [p0 p1 p2 p3]ᵀ
+	//!        rather than through the Horner form used by the batch kernels.
+	Point referenceCatmullRom(Point const& p0, Point const& p1,
+	                          Point const& p2, Point const& p3,
+	                          double const t, double const x)
+	{
+		double const powers[4] = { 1.0, x, x * x, x * x * x };
+		double const basis[4][4] = {
+			{ 0.0,       1.0,       0.0,             0.0 },
+			{  -t,       0.0,         t,             0.0 },
+			{ 2.0 * t,   t - 3.0,   3.0 - 2.0 * t,    -t },
+			{  -t,       2.0 - t,   t - 2.0,           t }
+		};
+
+		double weights[4] = { 0.0, 0.0, 0.0, 0.0 };
+		for (std::size_t row = 0; row < 4; ++row)
+			for (std::size_t column = 0; column < 4; ++column)
+				weights[column] += powers[row] * basis[row][column];
+
+		Point result;
+		for (std::size_t c = 0; c < 3; ++c)
+			result[c] = weights[0] * p0[c] + weights[1] * p1[c]
+			          + weights[2] * p2[c] + weights[3] * p3[c];
+		return result;
+	}
+
+	struct ControlPoints {
+		std::vector<Point> locations;
+		std::vector<float> x, y, z;
+
+		explicit ControlPoints(std::vector<Point> const& points) : locations(points)
+		{
+			for (auto const& point : points) {
+				x.push_back(static_cast<float>(point[0]));
+				y.push_back(static_cast<float>(point[1]));
+				z.push_back(static_cast<float>(point[2]));
+			}
+		}
+
+		interpolation::ControlPointsSoA view() const
+		{
+			return { x.data(), y.data(), z.data(), locations.size() };
+		}
+	};
+
+	//! \brief Run random segments and distance ratios through the batch
+	//!        interpolation functions and the reference ones, and print the
+	//!        largest absolute difference between their results.
+	//!
+	//! @return Whether that difference stays within tolerance
+	bool checkBatchInterpolation(ControlPoints const& control_points, float const catmull_rom_tension)
+	{
+		// Not a multiple of any vector width, so that the remaining
+		// elements go through the scalar loop of the batch functions.
+		constexpr std::size_t points_nb = 4099u;
+		constexpr double tolerance = 1.0e-4;
+
+		auto const& locations = control_points.locations;
+		auto const n = locations.size();
+
+		// Segment indices past the last control point check the wrapping
+		// around the closed path.
+		std::mt19937 generator(26u);
+		std::uniform_int_distribution<std::uint32_t> segment_distribution(0u, static_cast<std::uint32_t>(4u * n - 1u));
+		std::uniform_real_distribution<float> x_distribution(0.0f, 1.0f);
+		std::vector<std::uint32_t> segments(points_nb);
+		std::vector<float> xs(points_nb);
+		for (std::size_t i = 0; i < points_nb; ++i) {
+			segments[i] = segment_distribution(generator);
+			xs[i] = x_distribution(generator);
+		}
+		std::vector<float> positions_x(points_nb), positions_y(points_nb), positions_z(points_nb);
+		interpolation::PositionsSoA const positions{ positions_x.data(), positions_y.data(), positions_z.data() };
+
+		auto const max_error = [&](auto const& reference_evaluation) {
+			double error = 0.0;
+			for (std::size_t i = 0; i < points_nb; ++i) {
+				auto const expected = reference_evaluation(segments[i] % n, static_cast<double>(xs[i]));
+				error = std::max({ error,
+				                   std::abs(positions_x[i] - expected[0]),
+				                   std::abs(positions_y[i] - expected[1]),
+				                   std::abs(positions_z[i] - expected[2]) });
+			}
+			return error;
+		};
+
+		interpolation::evalLERPBatch(control_points.view(), segments.data(), xs.data(), points_nb, positions);
+		auto const lerp_error = max_error([&locations, n](std::size_t segment, double x) {
+			return referenceLERP(locations[segment], locations[(segment + 1u) % n], x);
+		});
+
+		interpolation::evalCatmullRomBatch(control_points.view(), catmull_rom_tension, segments.data(), xs.data(), points_nb, positions);
+		auto const catmull_rom_error = max_error([&locations, n, catmull_rom_tension](std::size_t segment, double x) {
+			return referenceCatmullRom(locations[(segment + n - 1u) % n],
+			                           locations[segment],
+			                           locations[(segment + 1u) % n],
+			                           locations[(segment + 2u) % n],
+			                           catmull_rom_tension, x);
+		});
+
+		bool const passed = lerp_error <= tolerance && catmull_rom_error <= tolerance;
+		std::printf("%s: %zu control points, tension %.2f, %zu points; largest absolute error of %.3e for linear and %.3e for Catmull-Rom.\n",
+		            passed ? "PASS" : "FAIL", n, catmull_rom_tension, points_nb, lerp_error, catmull_rom_error);
+		return passed;
+	}
+
+	//! \brief Compare the throughput of the reference and batch
+	//!        interpolation functions, and print the amount of points
+	//!        evaluated per second.
+	void benchmarkBatchInterpolation(ControlPoints const& control_points, float const catmull_rom_tension)
+	{
+		constexpr std::size_t points_nb = 1u << 20;
+
+		auto const& locations = control_points.locations;
+		auto const n = locations.size();
+
+		std::vector<std::uint32_t> segments(points_nb);
+		std::vector<float> xs(points_nb);
+		for (std::size_t i = 0; i < points_nb; ++i) {
+			segments[i] = static_cast<std::uint32_t>(i % n);
+			xs[i] = static_cast<float>(i % 1024u) / 1024.0f;
+		}
+		std::vector<float> positions_x(points_nb), positions_y(points_nb), positions_z(points_nb);
+		interpolation::PositionsSoA const positions{ positions_x.data(), positions_y.data(), positions_z.data() };
+
+		auto const points_per_second = [](std::chrono::high_resolution_clock::duration const& duration) {
+			return static_cast<double>(points_nb) / std::chrono::duration<double>(duration).count();
+		};
+
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (std::size_t i = 0; i < points_nb; ++i) {
+			auto const segment = segments[i];
+			auto const position = referenceCatmullRom(locations[(segment + n - 1u) % n],
+			                                          locations[segment],
+			                                          locations[(segment + 1u) % n],
+			                                          locations[(segment + 2u) % n],
+			                                          catmull_rom_tension, xs[i]);
+			positions_x[i] = static_cast<float>(position[0]);
+			positions_y[i] = static_cast<float>(position[1]);
+			positions_z[i] = static_cast<float>(position[2]);
+		}
+		auto const reference_catmull_rom_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+		start_time = std::chrono::high_resolution_clock::now();
+		interpolation::evalCatmullRomBatch(control_points.view(), catmull_rom_tension, segments.data(), xs.data(), points_nb, positions);
+		auto const batch_catmull_rom_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+		start_time = std::chrono::high_resolution_clock::now();
+		interpolation::evalLERPBatch(control_points.view(), segments.data(), xs.data(), points_nb, positions);
+		auto const batch_lerp_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+		std::printf("Interpolation throughput over %zu points:\n"
+		            "\treference Catmull-Rom: %.3e points/s\n"
+		            "\tbatch Catmull-Rom: %.3e points/s\n"
+		            "\tbatch linear: %.3e points/s\n",
+		            points_nb,
+		            points_per_second(reference_catmull_rom_duration),
+		            points_per_second(batch_catmull_rom_duration),
+		            points_per_second(batch_lerp_duration));
+	}
+}
+
+//! \brief Check the batch interpolation functions and, when given the
+//!        `--benchmark` argument, measure their throughput as well.
+//!
+//! @return EXIT_FAILURE if any check failed, EXIT_SUCCESS otherwise
+int main(int argc, char* argv[])
+{
+	// Same control points as in EDAF80 assignment 2.
+	ControlPoints const control_points({
+		{ { 0.0,  0.0,  0.0} }, { { 1.0,  1.8,  1.0} }, { { 2.0,  1.2,  2.0} },
+		{ { 3.0,  3.0,  3.0} }, { { 3.0,  0.0,  3.0} }, { {-2.0, -1.0,  3.0} },
+		{ {-3.0, -3.0, -3.0} }, { {-2.0, -1.2, -2.0} }, { {-1.0, -1.8, -1.0} }
+	});
+	// Smallest closed path the batch functions accept.
+	ControlPoints const two_control_points({ { { 0.0, 0.0, 0.0} }, { { 1.0, -2.0, 0.5} } });
+
+	bool passed = true;
+	for (auto const tension : { 0.0f, 0.5f, 1.0f }) {
+		passed = checkBatchInterpolation(control_points, tension) && passed;
+		passed = checkBatchInterpolation(two_control_points, tension) && passed;
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+		benchmarkBatchInterpolation(control_points, 0.5f);
+
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
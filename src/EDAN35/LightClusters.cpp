@@ -0,0 +1,209 @@
+#include "LightClusters.hpp"
+
+#include "core/helpers.hpp"
+#include "core/Log.h"
+#include "core/various.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+LightClusters::LightClusters(glm::uvec3 const& dimensions) : _dimensions(dimensions)
+{
+	GLint max_texels_nb = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels_nb);
+	_max_light_indices_nb = static_cast<std::size_t>(max_texels_nb);
+
+	std::array<GLenum, Count> const formats = { GL_RG32UI, GL_R32UI, GL_RGBA32F };
+	std::array<char const*, Count> const names = { "Light clusters grid", "Light clusters light indices", "Light clusters lights" };
+
+	auto& registry = bonobo::getResourceRegistry();
+	ResourceRegistry::OwnerScope const owner_scope(registry, "Light clusters");
+	glGenBuffers(static_cast<GLsizei>(_buffers.size()), _buffers.data());
+	glGenTextures(static_cast<GLsizei>(_textures.size()), _textures.data());
+	for (std::size_t i = 0; i < Count; ++i) {
+		glBindBuffer(GL_TEXTURE_BUFFER, _buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+		_buffer_handles[i] = registry.Register(ResourceType::buffer, _buffers[i], names[i]);
+
+		glBindTexture(GL_TEXTURE_BUFFER, _textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], _buffers[i]);
+		registry.Register(ResourceType::texture, _textures[i], names[i], ResourceCategory::automatic, GL_TEXTURE_BUFFER);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0u);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0u);
+
+	_grid.resize(2u * _dimensions.x * _dimensions.y * _dimensions.z);
+}
+
+LightClusters::~LightClusters()
+{
+	auto& registry = bonobo::getResourceRegistry();
+	for (auto& texture : _textures)
+		registry.Release(ResourceType::texture, texture);
+	for (auto& buffer : _buffers)
+		registry.Release(ResourceType::buffer, buffer);
+}
+
+void LightClusters::update(std::vector<Light> const& lights, std::size_t lights_nb,
+                           glm::mat4 const& world_to_view, glm::mat4 const& view_to_clip,
+                           float near, float far)
+{
+	lights_nb = std::min(lights_nb, lights.size());
+	_near = near;
+	_far = far;
+
+	//
+	// Find the range of clusters overlapped by the bounding box of each
+	// light; this is independent for each light.
+	//
+	_light_bounds.resize(lights_nb);
+	utils::parallel_for(lights_nb, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i) {
+			auto const& light = lights[i];
+			auto& bounds = _light_bounds[i];
+
+			auto const center = glm::vec3(world_to_view * glm::vec4(light.position, 1.0f));
+			auto const depth = -center.z;
+			bounds.is_visible = depth + light.radius > near && depth - light.radius < far;
+			if (!bounds.is_visible)
+				continue;
+
+			bounds.min.z = get_slice(std::max(depth - light.radius, near));
+			bounds.max.z = get_slice(std::min(depth + light.radius, far));
+
+			// When the light reaches the camera, its projection might wrap
+			// around, so just consider the whole screen.
+			if (depth - light.radius <= near) {
+				bounds.min.x = 0u;
+				bounds.min.y = 0u;
+				bounds.max.x = _dimensions.x - 1u;
+				bounds.max.y = _dimensions.y - 1u;
+				continue;
+			}
+
+			auto ndc_min = glm::vec2(std::numeric_limits<float>::max());
+			auto ndc_max = glm::vec2(std::numeric_limits<float>::lowest());
+			for (unsigned int corner = 0u; corner < 8u; ++corner) {
+				auto const offset = glm::vec3((corner & 1u) ? light.radius : -light.radius,
+				                              (corner & 2u) ? light.radius : -light.radius,
+				                              (corner & 4u) ? light.radius : -light.radius);
+				auto const clip = view_to_clip * glm::vec4(center + offset, 1.0f);
+				auto const ndc = glm::vec2(clip.x, clip.y) / clip.w;
+				ndc_min = glm::min(ndc_min, ndc);
+				ndc_max = glm::max(ndc_max, ndc);
+			}
+			bounds.is_visible = ndc_max.x >= -1.0f && ndc_min.x <= 1.0f && ndc_max.y >= -1.0f && ndc_min.y <= 1.0f;
+
+			auto const to_tile = [](float ndc, std::uint32_t tiles_nb) {
+				auto const tile = static_cast<int>(std::floor((ndc * 0.5f + 0.5f) * static_cast<float>(tiles_nb)));
+				return static_cast<std::uint32_t>(glm::clamp(tile, 0, static_cast<int>(tiles_nb) - 1));
+			};
+			bounds.min.x = to_tile(ndc_min.x, _dimensions.x);
+			bounds.min.y = to_tile(ndc_min.y, _dimensions.y);
+			bounds.max.x = to_tile(ndc_max.x, _dimensions.x);
+			bounds.max.y = to_tile(ndc_max.y, _dimensions.y);
+		}
+	});
+
+	//
+	// Count the lights of each cluster, and turn those counts into offsets
+	// in the light indices list.
+	//
+	auto const cluster_index = [this](std::uint32_t x, std::uint32_t y, std::uint32_t z) {
+		return x + _dimensions.x * (y + _dimensions.y * z);
+	};
+
+	std::fill(_grid.begin(), _grid.end(), 0u);
+	for (std::size_t i = 0; i < lights_nb; ++i) {
+		auto const& bounds = _light_bounds[i];
+		if (!bounds.is_visible)
+			continue;
+		for (std::uint32_t z = bounds.min.z; z <= bounds.max.z; ++z)
+			for (std::uint32_t y = bounds.min.y; y <= bounds.max.y; ++y)
+				for (std::uint32_t x = bounds.min.x; x <= bounds.max.x; ++x)
+					++_grid[2u * cluster_index(x, y, z) + 1u];
+	}
+
+	std::uint32_t light_indices_nb = 0u;
+	for (std::size_t cluster = 0; cluster < _grid.size() / 2u; ++cluster) {
+		_grid[2u * cluster] = light_indices_nb;
+		light_indices_nb += _grid[2u * cluster + 1u];
+		_grid[2u * cluster + 1u] = 0u;
+	}
+	if (light_indices_nb > _max_light_indices_nb) {
+		LogWarning("Light clusters need %u light indices but at most %zu are supported: some lights will be missing.",
+		           light_indices_nb, _max_light_indices_nb);
+	}
+
+	//
+	// Fill in the light indices of each cluster.
+	//
+	_light_indices.resize(std::min<std::size_t>(light_indices_nb, _max_light_indices_nb));
+	for (std::size_t i = 0; i < lights_nb; ++i) {
+		auto const& bounds = _light_bounds[i];
+		if (!bounds.is_visible)
+			continue;
+		for (std::uint32_t z = bounds.min.z; z <= bounds.max.z; ++z)
+			for (std::uint32_t y = bounds.min.y; y <= bounds.max.y; ++y)
+				for (std::uint32_t x = bounds.min.x; x <= bounds.max.x; ++x) {
+					auto const cluster = cluster_index(x, y, z);
+					auto const index = _grid[2u * cluster] + _grid[2u * cluster + 1u];
+					if (index >= _light_indices.size())
+						continue;
+					_light_indices[index] = static_cast<std::uint32_t>(i);
+					++_grid[2u * cluster + 1u];
+				}
+	}
+
+	_lights_data.resize(2u * lights_nb);
+	for (std::size_t i = 0; i < lights_nb; ++i) {
+		_lights_data[2u * i] = glm::vec4(lights[i].position, lights[i].radius);
+		_lights_data[2u * i + 1u] = glm::vec4(lights[i].color * lights[i].intensity, 0.0f);
+	}
+
+	//
+	// Upload everything, orphaning the previous storage to avoid waiting on
+	// the previous frame.
+	//
+	auto const upload = [this](std::size_t buffer, std::size_t size, void const* data) {
+		// Buffer textures can not be empty, so always allocate something.
+		glBindBuffer(GL_TEXTURE_BUFFER, _buffers[buffer]);
+		glBufferData(GL_TEXTURE_BUFFER, std::max<std::size_t>(size, 16u), nullptr, GL_STREAM_DRAW);
+		bonobo::getResourceRegistry().SetSize(_buffer_handles[buffer], std::max<std::size_t>(size, 16u));
+		if (size > 0u)
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+	};
+	upload(Grid, _grid.size() * sizeof(std::uint32_t), _grid.data());
+	upload(LightIndices, _light_indices.size() * sizeof(std::uint32_t), _light_indices.data());
+	upload(LightsData, _lights_data.size() * sizeof(glm::vec4), _lights_data.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0u);
+}
+
+void LightClusters::bind(ShaderProgramManager const& program_manager, GLuint program, GLuint first_texture_unit) const
+{
+	std::array<char const*, Count> const names = { "cluster_grid", "cluster_light_indices", "cluster_lights" };
+	for (std::size_t i = 0; i < Count; ++i) {
+		auto const unit = first_texture_unit + static_cast<GLuint>(i);
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_BUFFER, _textures[i]);
+		glUniform1i(program_manager.GetUniformLocation(program, names[i]), static_cast<GLint>(unit));
+	}
+
+	glUniform3ui(program_manager.GetUniformLocation(program, "cluster_dimensions"), _dimensions.x, _dimensions.y, _dimensions.z);
+	glUniform2f(program_manager.GetUniformLocation(program, "cluster_depth_range"), _near, _far);
+}
+
+std::size_t LightClusters::get_light_indices_nb() const
+{
+	return _light_indices.size();
+}
+
+std::uint32_t LightClusters::get_slice(float depth) const
+{
+	// Must match the slice computation in accumulate_lights_clustered.frag.
+	auto const slice = std::floor(std::log(depth / _near) / std::log(_far / _near) * static_cast<float>(_dimensions.z));
+	return static_cast<std::uint32_t>(glm::clamp(slice, 0.0f, static_cast<float>(_dimensions.z - 1u)));
+}
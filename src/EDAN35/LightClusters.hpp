@@ -0,0 +1,106 @@
+#pragma once
+
+#include "core/opengl.hpp"
+#include "core/ResourceRegistry.hpp"
+#include "core/ShaderProgramManager.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! \brief Bins point lights into a grid of view-frustum clusters, so that
+//!        a single full-screen pass can shade each pixel against only the
+//!        lights which can reach it.
+//!
+//! The grid is made of screen-space tiles along x and y, and of depth
+//! slices along z which are distributed exponentially between the near
+//! and far planes. The binning is done on the CPU, as OpenGL 4.1 has no
+//! compute shaders, and its results are uploaded to three buffer textures:
+//! * `cluster_grid` (RG32UI): for each cluster, the offset of its first
+//!   light index and its amount of lights;
+//! * `cluster_light_indices` (R32UI): the light indices of all clusters,
+//!   one cluster after the other;
+//! * `cluster_lights` (RGBA32F): two texels per light, the first one with
+//!   the world space position and radius, the second one with the colour
+//!   already multiplied by the intensity.
+class LightClusters
+{
+public:
+	struct Light
+	{
+		glm::vec3 position{0.0f};
+		float radius{1.0f};       //!< Distance beyond which the light has no contribution.
+		glm::vec3 color{1.0f};
+		float intensity{1.0f};
+	};
+
+	//! \brief Create the GPU buffers used to store the clusters.
+	//!
+	//! @param [in] dimensions Number of clusters along x, y and z
+	LightClusters(glm::uvec3 const& dimensions);
+	~LightClusters();
+	LightClusters(LightClusters const&) = delete;
+	LightClusters& operator=(LightClusters const&) = delete;
+
+	//! \brief Bin all lights into the clusters of the given camera, and
+	//!        upload the result to the GPU.
+	//!
+	//! @param [in] lights Lights to bin
+	//! @param [in] lights_nb How many lights, from the start of |lights|,
+	//!             should be considered
+	//! @param [in] world_to_view Matrix transforming from world space to
+	//!             the camera's view space
+	//! @param [in] view_to_clip Projection matrix of the camera
+	//! @param [in] near Distance to the camera's near plane
+	//! @param [in] far Distance to the camera's far plane
+	void update(std::vector<Light> const& lights, std::size_t lights_nb,
+	            glm::mat4 const& world_to_view, glm::mat4 const& view_to_clip,
+	            float near, float far);
+
+	//! \brief Bind the cluster buffer textures and set all the uniforms
+	//!        describing the clusters.
+	//!
+	//! @param [in] program_manager Manager of |program|, to look up the
+	//!             uniform locations from its reflection data
+	//! @param [in] program Program currently in use
+	//! @param [in] first_texture_unit First of the three consecutive
+	//!             texture units which will be used
+	void bind(ShaderProgramManager const& program_manager, GLuint program, GLuint first_texture_unit) const;
+
+	//! \brief Return how many light indices were written by the last
+	//!        update, i.e. the sum over all clusters of their light count.
+	std::size_t get_light_indices_nb() const;
+
+private:
+	std::uint32_t get_slice(float depth) const;
+
+	glm::uvec3 _dimensions;
+	float _near{1.0f};
+	float _far{2.0f};
+
+	struct LightBounds
+	{
+		glm::uvec3 min;
+		glm::uvec3 max;
+		bool is_visible;
+	};
+	std::vector<LightBounds> _light_bounds;
+	std::vector<std::uint32_t> _grid;          //!< Offset and count per cluster.
+	std::vector<std::uint32_t> _light_indices;
+	std::vector<glm::vec4> _lights_data;
+	std::size_t _max_light_indices_nb{0u};
+
+	enum : std::size_t {
+		Grid = 0u,
+		LightIndices,
+		LightsData,
+		Count
+	};
+	std::array<GLuint, Count> _buffers;
+	std::array<GLuint, Count> _textures;
+	std::array<ResourceHandle, Count> _buffer_handles;
+};
@@ -0,0 +1,104 @@
+#include "ShadowAtlas.hpp"
+
+#include "core/Log.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+	std::uint32_t floor_power_of_two(std::uint32_t value)
+	{
+		std::uint32_t power = 1u;
+		while (power <= value / 2u)
+			power *= 2u;
+		return value == 0u ? 0u : power;
+	}
+
+	std::size_t get_level(std::uint32_t resolution, std::uint32_t size)
+	{
+		std::size_t level = 0u;
+		while ((resolution >> level) > size)
+			++level;
+		return level;
+	}
+}
+
+ShadowAtlas::ShadowAtlas(std::uint32_t resolution, std::uint32_t min_region_resolution) :
+	_resolution(floor_power_of_two(resolution)),
+	_min_region_resolution(std::min(floor_power_of_two(std::max(min_region_resolution, 1u)), _resolution))
+{
+	if (_resolution != resolution)
+		LogWarning("Shadow atlas resolution %u is not a power of two; using %u instead.", resolution, _resolution);
+
+	_free_nodes.resize(get_level(_resolution, _min_region_resolution) + 1u);
+}
+
+void ShadowAtlas::allocate(std::vector<std::uint32_t> const& requested_resolutions)
+{
+	_regions.assign(requested_resolutions.size(), Region());
+	for (auto& nodes : _free_nodes)
+		nodes.clear();
+	_free_nodes[0].emplace_back(0u, 0u);
+
+	_sorted_requests.resize(requested_resolutions.size());
+	std::iota(_sorted_requests.begin(), _sorted_requests.end(), 0u);
+	std::stable_sort(_sorted_requests.begin(), _sorted_requests.end(),
+	                 [&requested_resolutions](std::size_t lhs, std::size_t rhs) {
+	                     return requested_resolutions[lhs] > requested_resolutions[rhs];
+	                 });
+
+	for (auto const request : _sorted_requests) {
+		if (requested_resolutions[request] == 0u)
+			continue;
+
+		auto const size = std::max(std::min(floor_power_of_two(requested_resolutions[request]), _resolution), _min_region_resolution);
+		auto level = get_level(_resolution, size);
+
+		// Look for the smallest free node which is at least as big as
+		// requested; if there is none, try again with a smaller size.
+		auto const find_source_level = [this](std::size_t level) {
+			for (auto l = level + 1u; l-- > 0u;)
+				if (!_free_nodes[l].empty())
+					return l;
+			return _free_nodes.size();
+		};
+		auto source_level = find_source_level(level);
+		while (source_level == _free_nodes.size() && level + 1u < _free_nodes.size())
+			source_level = find_source_level(++level);
+		if (source_level == _free_nodes.size())
+			continue;
+
+		// Split the node until it has the right size, keeping the other
+		// quadrants around for later requests.
+		auto node = _free_nodes[source_level].back();
+		_free_nodes[source_level].pop_back();
+		for (auto l = source_level + 1u; l <= level; ++l) {
+			auto const half = _resolution >> l;
+			_free_nodes[l].emplace_back(node.x + half, node.y);
+			_free_nodes[l].emplace_back(node.x, node.y + half);
+			_free_nodes[l].emplace_back(node.x + half, node.y + half);
+		}
+
+		_regions[request].offset = node;
+		_regions[request].size = _resolution >> level;
+	}
+}
+
+ShadowAtlas::Region const& ShadowAtlas::get_region(std::size_t i) const
+{
+	return _regions[i];
+}
+
+glm::vec4 ShadowAtlas::get_region_uv(std::size_t i) const
+{
+	auto const& region = _regions[i];
+	auto const inverse_resolution = 1.0f / static_cast<float>(_resolution);
+	return glm::vec4(glm::vec2(region.offset) * inverse_resolution,
+	                 glm::vec2(static_cast<float>(region.size) * inverse_resolution));
+}
+
+std::uint32_t ShadowAtlas::get_resolution() const
+{
+	return _resolution;
+}
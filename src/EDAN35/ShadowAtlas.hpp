@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! \brief Splits a single square depth texture into square regions, one per
+//!        shadow-casting light, so that all shadow maps can be rendered
+//!        before any light gets accumulated.
+//!
+//! Regions have power-of-two sizes and are allocated as in a quadtree: a
+//! free node which is too big is split into four quadrants until one of
+//! them has the requested size. Requests are served from the largest to the
+//! smallest; a request which does not fit anymore is halved until it does,
+//! or until it goes below the minimal resolution, in which case the light
+//! gets no region at all.
+class ShadowAtlas
+{
+public:
+	struct Region
+	{
+		glm::uvec2 offset{0u};   //!< Lower-left corner, in texels.
+		std::uint32_t size{0u};  //!< Width and height, in texels; 0 if no region was allocated.
+	};
+
+	//! \brief Create an empty atlas.
+	//!
+	//! @param [in] resolution Width and height of the atlas texture, in
+	//!             texels; must be a power of two
+	//! @param [in] min_region_resolution Smallest region which can be
+	//!             allocated; must be a power of two
+	ShadowAtlas(std::uint32_t resolution, std::uint32_t min_region_resolution);
+
+	//! \brief Discard all previous regions and allocate new ones.
+	//!
+	//! @param [in] requested_resolutions Resolution wished for by each
+	//!             light; it is rounded down to a power of two, and a
+	//!             value of 0 means the light needs no region.
+	void allocate(std::vector<std::uint32_t> const& requested_resolutions);
+
+	//! \brief Return the region allocated to the i-th request of the last
+	//!        call to allocate().
+	Region const& get_region(std::size_t i) const;
+
+	//! \brief Return the region allocated to the i-th request, expressed
+	//!        in texture coordinates of the atlas: the offset is stored in
+	//!        xy and the scale in zw.
+	glm::vec4 get_region_uv(std::size_t i) const;
+
+	std::uint32_t get_resolution() const;
+
+private:
+	std::uint32_t _resolution;
+	std::uint32_t _min_region_resolution;
+	std::vector<Region> _regions;
+
+	//! Free nodes of the quadtree, sorted by level: the nodes stored at
+	//! level l have a size of `_resolution >> l`.
+	std::vector<std::vector<glm::uvec2>> _free_nodes;
+	std::vector<std::size_t> _sorted_requests;
+};
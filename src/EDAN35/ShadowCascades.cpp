@@ -0,0 +1,73 @@
+#include "ShadowCascades.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+#include <cmath>
+
+void compute_shadow_cascades(glm::mat4 const& camera_view_to_world,
+                             float fov, float aspect, float near, float far,
+                             glm::vec3 const& light_direction,
+                             std::uint32_t resolution, float split_lambda,
+                             float caster_extension,
+                             std::vector<ShadowCascade>& cascades)
+{
+	if (cascades.empty())
+		return;
+
+	// The light's view space is centred on the world origin; it only
+	// matters that it does not move with the camera, for the snapping to
+	// be stable.
+	auto const up = std::abs(light_direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	auto const world_to_light = glm::lookAt(glm::vec3(0.0f), light_direction, up);
+
+	auto const tan_half_fov_y = std::tan(0.5f * fov);
+	auto const tan_half_fov_x = tan_half_fov_y * aspect;
+	auto const cascades_nb = static_cast<float>(cascades.size());
+
+	auto slice_near = near;
+	for (std::size_t i = 0; i < cascades.size(); ++i) {
+		auto const ratio = static_cast<float>(i + 1u) / cascades_nb;
+		auto const log_split = near * std::pow(far / near, ratio);
+		auto const uniform_split = near + (far - near) * ratio;
+		auto const slice_far = split_lambda * log_split + (1.0f - split_lambda) * uniform_split;
+
+		// Corners of the slice, in world space.
+		std::array<glm::vec3, 8> corners;
+		for (unsigned int corner = 0u; corner < 8u; ++corner) {
+			auto const distance = (corner & 4u) ? slice_far : slice_near;
+			auto const view_corner = glm::vec4((corner & 1u) ? distance * tan_half_fov_x : -distance * tan_half_fov_x,
+			                                   (corner & 2u) ? distance * tan_half_fov_y : -distance * tan_half_fov_y,
+			                                   -distance, 1.0f);
+			corners[corner] = glm::vec3(camera_view_to_world * view_corner);
+		}
+
+		auto center = glm::vec3(0.0f);
+		for (auto const& corner : corners)
+			center += corner;
+		center /= static_cast<float>(corners.size());
+
+		auto radius = 0.0f;
+		for (auto const& corner : corners)
+			radius = glm::max(radius, glm::length(corner - center));
+		// Rounding the radius up keeps the texel size constant under
+		// floating-point noise.
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		auto const texel_size = 2.0f * radius / static_cast<float>(resolution);
+		auto light_center = glm::vec3(world_to_light * glm::vec4(center, 1.0f));
+		light_center.x = std::floor(light_center.x / texel_size) * texel_size;
+		light_center.y = std::floor(light_center.y / texel_size) * texel_size;
+
+		auto const light_to_clip = glm::ortho(light_center.x - radius, light_center.x + radius,
+		                                      light_center.y - radius, light_center.y + radius,
+		                                      -light_center.z - radius - caster_extension,
+		                                      -light_center.z + radius);
+
+		cascades[i].world_to_clip = light_to_clip * world_to_light;
+		cascades[i].far_distance = slice_far;
+
+		slice_near = slice_far;
+	}
+}
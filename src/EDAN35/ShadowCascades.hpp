@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <vector>
+
+//! \brief Shadow map covering one slice of the camera frustum, as seen by a
+//!        directional light.
+struct ShadowCascade
+{
+	glm::mat4 world_to_clip{1.0f};
+	float far_distance{0.0f}; //!< Distance to the camera at which this cascade ends.
+};
+
+//! \brief Split the view frustum of a camera into as many slices as there
+//!        are elements in |cascades|, and fit an orthographic projection
+//!        around each of them.
+//!
+//! Split distances follow the practical split scheme, i.e. a blend between
+//! logarithmic and uniform splits. Each slice is enclosed in a bounding
+//! sphere, so that the size of a cascade does not change when the camera
+//! rotates, and the centre of that sphere is snapped to whole shadow map
+//! texels, so that shadows do not shimmer when the camera moves.
+//!
+//! @param [in] camera_view_to_world Matrix transforming from the camera's
+//!             view space to world space
+//! @param [in] fov Vertical field of view of the camera, in radians
+//! @param [in] aspect Width over height ratio of the camera
+//! @param [in] near Distance to the camera's near plane
+//! @param [in] far Distance up to which shadows should be cast
+//! @param [in] light_direction Direction in which the light travels
+//! @param [in] resolution Width and height of each cascade's shadow map
+//! @param [in] split_lambda Weight of the logarithmic splits against the
+//!             uniform ones, between 0 and 1
+//! @param [in] caster_extension Distance, towards the light, by which the
+//!             cascades are extended to catch casters lying outside of the
+//!             camera frustum
+//! @param [out] cascades Cascades to compute, from the closest to the
+//!              furthest
+void compute_shadow_cascades(glm::mat4 const& camera_view_to_world,
+                             float fov, float aspect, float near, float far,
+                             glm::vec3 const& light_direction,
+                             std::uint32_t resolution, float split_lambda,
+                             float caster_extension,
+                             std::vector<ShadowCascade>& cascades);
@@ -3,13 +3,23 @@
 #define GLM_FORCE_PURE 1
 
 #include "assignment2.hpp"
+#include "LightClusters.hpp"
+#include "ShadowAtlas.hpp"
+#include "ShadowCascades.hpp"
 
 #include "config.hpp"
+#include "core/BenchmarkRecorder.hpp"
 #include "core/Bonobo.h"
+#include "core/CameraPath.hpp"
 #include "core/FPSCamera.h"
+#include "core/GpuTimer.hpp"
 #include "core/helpers.hpp"
+#include "core/MemoryBudget.hpp"
 #include "core/node.hpp"
 #include "core/opengl.hpp"
+#include "core/Profiler.h"
+#include "core/RenderGraph.hpp"
+#include "core/RenderTargetPool.hpp"
 #include "core/ShaderProgramManager.hpp"
 
 #include <imgui.h>
@@ -18,21 +28,40 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <tinyfiledialogs.h>
 
+#include <algorithm>
 #include <array>
 #include <clocale>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <stdexcept>
+#include <vector>
 
 namespace constant
 {
-	constexpr uint32_t shadowmap_res_x = 1024;
-	constexpr uint32_t shadowmap_res_y = 1024;
+	constexpr uint32_t shadow_atlas_res   = 4096;
+	constexpr uint32_t shadowmap_max_res  = 2048;
+	constexpr uint32_t shadowmap_min_res  = 256;
 
 	constexpr float  scale_lengths       = 100.0f; // The scene is expressed in centimetres rather than metres, hence the x100.
 
 	constexpr size_t lights_nb           = 4;
 	constexpr float  light_intensity     = 72.0f * (scale_lengths * scale_lengths);
 	constexpr float  light_angle_falloff = glm::radians(37.0f);
+
+	constexpr size_t clustered_lights_nb        = 4096;
+	constexpr float  clustered_light_intensity  = 8.0f * (scale_lengths * scale_lengths);
+	constexpr float  clustered_light_radius     = 2.5f * scale_lengths;
+	constexpr uint32_t light_clusters_x         = 16;
+	constexpr uint32_t light_clusters_y         = 9;
+	constexpr uint32_t light_clusters_z         = 24;
+
+	constexpr size_t   sun_cascades_nb            = 4; // Must match the arrays in accumulate_sun.frag.
+	constexpr uint32_t sun_shadowmap_res          = 2048;
+	constexpr float    sun_shadow_distance        = 40.0f * scale_lengths;
+	constexpr float    sun_shadow_caster_extension = 30.0f * scale_lengths;
+	constexpr float    sun_cascade_split_lambda   = 0.75f;
+	constexpr float    sun_cascade_blend_ratio    = 0.1f;
 }
 
 namespace
@@ -44,7 +73,9 @@ namespace
 
 	enum class Texture : uint32_t {
 		DepthBuffer = 0u,
-		ShadowMap,
+		ShadowAtlas,
+		ShadowAtlasStaticCache,
+		SunShadowCascades,
 		GBufferDiffuse,
 		GBufferSpecular,
 		GBufferWorldSpaceNormal,
@@ -54,40 +85,71 @@ namespace
 		Count
 	};
 	using Textures = std::array<GLuint, toU(Texture::Count)>;
-	Textures createTextures(GLsizei framebuffer_width, GLsizei framebuffer_height);
+	std::array<char const*, toU(Texture::Count)> const texture_names = {
+		"Depth buffer", "Shadow atlas", "Shadow atlas static cache", "Sun shadow cascades", "GBuffer diffuse",
+		"GBuffer specular", "GBuffer normals", "Light diffuse contribution", "Light specular contribution", "Final result"
+	};
+
+	//! The standard layout stores diffuse, specular and normals in three
+	//! RGBA8 targets, and the light contributions in RGBA8 as well. The
+	//! compact one stores the specular intensity in the alpha channel of
+	//! the diffuse target, normals octahedral-encoded in RG16, and the
+	//! light contributions in R11F_G11F_B10F to keep their high range.
+	enum class GBufferLayout : uint32_t {
+		Standard = 0u,
+		Compact,
+		Count
+	};
+	std::array<char const*, toU(GBufferLayout::Count)> const gbuffer_layout_names = { "Standard", "Compact" };
+	//! Bytes per pixel written to the G-buffer, depth included.
+	size_t getGBufferPixelSize(GBufferLayout layout);
+
+	//! Shadow maps have a fixed size and keep their content across frames,
+	//! so they are created once and for all; the other textures are left
+	//! to 0, as they are screen-sized targets declared every frame in the
+	//! render graph, and described by getRenderTargetDesc().
+	Textures createTextures();
+	RenderTargetDesc getRenderTargetDesc(Texture texture, GBufferLayout gbuffer_layout);
+
+	//! Screen-sized targets of a frame, as declared in its render graph;
+	//! the passes replace each of them by the versions they write.
+	struct SceneTargets
+	{
+		RenderGraph::Resource depth;
+		RenderGraph::Resource gbuffer_diffuse;
+		RenderGraph::Resource gbuffer_specular;  //!< Invalid with the compact layout
+		RenderGraph::Resource gbuffer_normals;
+		RenderGraph::Resource light_diffuse;
+		RenderGraph::Resource light_specular;
+		RenderGraph::Resource result;
+	};
+	SceneTargets createSceneTargets(RenderGraph& graph, GBufferLayout gbuffer_layout);
 
 	enum class Sampler : uint32_t {
 		Nearest = 0u,
 		Linear,
 		Mipmaps,
+		ShadowComparison,
 		Count
 	};
 	using Samplers = std::array<GLuint, toU(Sampler::Count)>;
 	Samplers createSamplers();
 
+	//! Framebuffers of the shadow maps; the render graph gets the others
+	//! from the pool, along with the screen-sized targets.
 	enum class FBO : uint32_t {
-		GBuffer = 0u,
-		ShadowMap,
-		LightAccumulation,
-		Resolve,
-		FinalWithDepth,
+		ShadowAtlas = 0u,
+		ShadowAtlasStaticCache,
+		SunShadowCascades,
 		Count
 	};
 	using FBOs = std::array<GLuint, toU(FBO::Count)>;
 	FBOs createFramebufferObjects(Textures const& textures);
-
-	enum class ElapsedTimeQuery : uint32_t {
-		GbufferGeneration = 0u,
-		ShadowMap0Generation,
-		Light0Accumulation = ShadowMap0Generation + static_cast<uint32_t>(constant::lights_nb),
-		Resolve = Light0Accumulation + static_cast<uint32_t>(constant::lights_nb),
-		ConeWireframe,
-		GUI,
-		CopyToFramebuffer,
-		Count
-	};
-	using ElapsedTimeQueries = std::array<GLuint, toU(ElapsedTimeQuery::Count)>;
-	ElapsedTimeQueries createElapsedTimeQueries();
+	//! Execute render graphs using the targets of both G-buffer layouts at
+	//! many sizes, checking that every framebuffer is complete and that no
+	//! object is left behind once back to the original size; nothing must
+	//! be acquired meanwhile.
+	bool checkRenderTargetResizing(RenderTargetPool& pool);
 
 	enum class UBO : uint32_t {
 		CameraViewProjTransforms = 0u,
@@ -111,65 +173,25 @@ namespace
 		GLuint opacity_texture_id{ 0u };
 	};
 
-	struct GBufferShaderLocations
-	{
-		GLuint ubo_CameraViewProjTransforms{ 0u };
-		GLuint vertex_model_to_world{ 0u };
-		GLuint normal_model_to_world{ 0u };
-		GLuint diffuse_texture{ 0u };
-		GLuint specular_texture{ 0u };
-		GLuint normals_texture{ 0u };
-		GLuint opacity_texture{ 0u };
-		GLuint has_diffuse_texture{ 0u };
-		GLuint has_specular_texture{ 0u };
-		GLuint has_normals_texture{ 0u };
-		GLuint has_opacity_texture{ 0u };
-	};
-	void fillGBufferShaderLocations(GLuint gbuffer_shader, GBufferShaderLocations& locations);
-
-	struct FillShadowmapShaderLocations
-	{
-		GLuint ubo_LightViewProjTransforms{ 0u };
-		GLuint light_index{ 0u };
-		GLuint vertex_model_to_world{ 0u };
-		GLuint opacity_texture{ 0u };
-		GLuint has_opacity_texture{ 0u };
-	};
-	void fillShadowmapShaderLocations(GLuint shadowmap_shader, FillShadowmapShaderLocations& locations);
-
-	struct AccumulateLightsShaderLocations
-	{
-		GLuint ubo_CameraViewProjTransforms{ 0u };
-		GLuint ubo_LightViewProjTransforms{ 0u };
-		GLuint light_index{ 0u };
-		GLuint vertex_model_to_world{ 0u };
-		GLuint vertex_world_to_clip{ 0u };
-		GLuint vertex_clip_to_world{ 0u };
-		GLuint depth_texture{ 0u };
-		GLuint normal_texture{ 0u };
-		GLuint shadow_texture{ 0u };
-		GLuint camera_position{ 0u };
-		GLuint inverse_screen_resolution{ 0u };
-		GLuint light_color{ 0u };
-		GLuint light_position{ 0u };
-		GLuint light_direction{ 0u };
-		GLuint light_intensity{ 0u };
-		GLuint light_angle_falloff{ 0u };
-	};
-	void fillAccumulateLightsShaderLocations(GLuint accumulate_lights_shader, AccumulateLightsShaderLocations& locations);
-
 	bonobo::mesh_data loadCone();
 } // namespace
 
-edan35::Assignment2::Assignment2(WindowManager& windowManager) :
+edan35::Assignment2::Assignment2(WindowManager& windowManager, BenchmarkSettings const& benchmarkSettings) :
 	mCamera(0.5f * glm::half_pi<float>(),
 	        static_cast<float>(config::resolution_x) / static_cast<float>(config::resolution_y),
 	        0.01f * constant::scale_lengths, 40.0f * constant::scale_lengths),
-	inputHandler(), mWindowManager(windowManager), window(nullptr)
+	inputHandler(), mWindowManager(windowManager), window(nullptr),
+	mBenchmarkSettings(benchmarkSettings)
 {
 	WindowManager::WindowDatum window_datum{ inputHandler, mCamera, config::resolution_x, config::resolution_y, 0, 0, 0, 0};
 
-	window = mWindowManager.CreateGLFWWindow("EDAN35: Assignment 2", window_datum, config::msaa_rate);
+	// Benchmarks should neither be bound by the display refresh rate nor
+	// need a display at all.
+	if (mBenchmarkSettings.is_enabled)
+		window = mWindowManager.CreateGLFWWindow("EDAN35: Assignment 2 (benchmark)", window_datum, config::msaa_rate, false, false,
+		                                         WindowManager::SwapStrategy::disable_vsync, false);
+	else
+		window = mWindowManager.CreateGLFWWindow("EDAN35: Assignment 2", window_datum, config::msaa_rate);
 	if (window == nullptr) {
 		throw std::runtime_error("Failed to get a window: aborting!");
 	}
@@ -185,8 +207,15 @@ edan35::Assignment2::~Assignment2()
 void
 edan35::Assignment2::run()
 {
+	ProfileThreadName("Main thread");
+
+	auto& resource_registry = bonobo::getResourceRegistry();
+	ResourceRegistry::OwnerScope const owner_scope(resource_registry, "EDAN35 assignment 2");
+	MemoryBudget memory_budget(resource_registry);
+	memory_budget.SetSoftLimit(static_cast<std::size_t>(mBenchmarkSettings.memory_budget_mib) * 1024u * 1024u);
+
 	// Load the geometry of Sponza
-	auto const sponza_geometry = bonobo::loadObjects(config::resources_path("sponza/sponza.obj"));
+	auto sponza_geometry = bonobo::loadObjects(config::resources_path("sponza/sponza.obj"));
 	if (sponza_geometry.empty()) {
 		LogError("Failed to load the Sponza model");
 		return;
@@ -219,7 +248,7 @@ edan35::Assignment2::run()
 		sponza_geometry_texture_data.emplace_back(std::move(data));
 	}
 
-	auto const cone_geometry = loadCone();
+	auto cone_geometry = loadCone();
 	Node cone;
 	cone.set_geometry(cone_geometry);
 
@@ -230,6 +259,37 @@ edan35::Assignment2::run()
 	mCamera.mMouseSensitivity = glm::vec2(0.003f);
 	mCamera.mMovementSpeed = glm::vec3(3.0f) * constant::scale_lengths; // 3 m/s => 10.8 km/h.
 
+	//
+	// Setup the camera path: F6 starts and stops recording one while
+	// flying around, and benchmarks replay one.
+	//
+	CameraPath camera_path;
+	bool is_recording_camera_path = false;
+	float camera_path_recording_time = 0.0f;
+	bool const is_benchmark = mBenchmarkSettings.is_enabled;
+	if (is_benchmark && !mBenchmarkSettings.camera_path.empty()) {
+		if (!camera_path.Load(mBenchmarkSettings.camera_path)) {
+			LogError("Failed to load the benchmark camera path: aborting!");
+			return;
+		}
+	} else if (is_benchmark) {
+		// Walk down the nave, then come back along the upper gallery,
+		// always looking towards the next keyframe.
+		std::array<glm::vec3, 6> const fly_through_positions = {
+			glm::vec3(-10.0f, 1.5f,  0.0f), glm::vec3(-4.0f, 1.5f, 2.0f), glm::vec3(4.0f, 1.5f, -2.0f),
+			glm::vec3( 10.0f, 1.5f,  0.0f), glm::vec3( 8.0f, 6.0f, 3.0f), glm::vec3(-10.0f, 6.0f, 3.0f)
+		};
+		auto const seconds_per_segment = 2.0f;
+		TRSTransformf pose;
+		for (size_t i = 0; i < fly_through_positions.size(); ++i) {
+			auto const position = fly_through_positions[i] * constant::scale_lengths;
+			auto const target = (i + 1 < fly_through_positions.size() ? fly_through_positions[i + 1]
+			                                                          : 2.0f * fly_through_positions[i] - fly_through_positions[i - 1]) * constant::scale_lengths;
+			pose.LookTowards(glm::normalize(target - position), glm::vec3(0.0f, 1.0f, 0.0f));
+			camera_path.AddKeyframe(static_cast<float>(i) * seconds_per_segment, position, pose.GetRotationQuaternion());
+		}
+	}
+
 	int framebuffer_width, framebuffer_height;
 	glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
 
@@ -237,81 +297,200 @@ edan35::Assignment2::run()
 	// Setup OpenGL objects
 	// Look further down in this file to see the implementation of those functions.
 	//
-	Textures const textures = createTextures(framebuffer_width, framebuffer_height);
-	FBOs const fbos = createFramebufferObjects(textures);
-	Samplers const samplers = createSamplers();
-	ElapsedTimeQueries const elapsed_time_queries = createElapsedTimeQueries();
-	UBOs const ubos = createUniformBufferObjects();
+	// Screen-sized targets come from the pool every frame, so they follow
+	// the size of the window as well as the G-buffer layout, which can be
+	// changed from the GUI.
+	auto gbuffer_layout = GBufferLayout::Standard;
+	auto requested_gbuffer_layout = gbuffer_layout;
+	RenderTargetPool render_target_pool;
+	render_target_pool.SetReferenceSize(glm::uvec2(framebuffer_width, framebuffer_height));
+	bool is_render_target_check_requested = false;
+	RenderGraph frame_graph(render_target_pool);
+	bool is_render_graph_report_requested = false;
+	Textures textures = createTextures();
+	FBOs fbos = createFramebufferObjects(textures);
+	Samplers samplers = createSamplers();
+	// Benchmarks record every frame, and run unthrottled: give the queries
+	// more frames to come back before any gets dropped.
+	GpuTimer gpu_timer(is_benchmark ? 16u : 4u);
+
+	// Every GPU frame gets recorded, even when several of them are
+	// collected at once.
+	BenchmarkRecorder benchmark_recorder;
+	if (is_benchmark) {
+		gpu_timer.SetFrameCallback([this, &benchmark_recorder](std::uint64_t frame_number, std::vector<GpuTimer::ScopeTiming> const& scopes) {
+			if (frame_number <= mBenchmarkSettings.warmup_frames_nb)
+				return;
+			for (auto const& scope : scopes)
+				benchmark_recorder.AddSample(frame_number, "GPU", scope.path, scope.statistics.last_ms);
+		});
+	}
+	UBOs ubos = createUniformBufferObjects();
 
 	//
 	// Load all the shader programs used
 	//
 	ShaderProgramManager program_manager;
 	GLuint fallback_shader = 0u;
-	program_manager.CreateAndRegisterProgram("Fallback",
-	                                         { { ShaderType::vertex, "common/fallback.vert" },
-	                                           { ShaderType::fragment, "common/fallback.frag" } },
-	                                         fallback_shader);
+	GLuint depth_prepass_opaque_shader = 0u;
+	GLuint depth_prepass_alpha_tested_shader = 0u;
+	GLuint fill_shadowmap_shader = 0u;
+	GLuint fill_shadowmap_layered_shader = 0u;
+	GLuint accumulate_lights_shader = 0u;
+	GLuint fill_shadowmap_cascade_shader = 0u;
+	GLuint accumulate_sun_shader = 0u;
+	GLuint accumulate_lights_clustered_shader = 0u;
+	GLuint resolve_deferred_shader = 0u;
+	GLuint render_light_cones_shader = 0u;
+	// Blocks get bound to the same points in every program, and again
+	// whenever those are rebuilt.
+	program_manager.SetUniformBlockBinding("CameraViewProjTransforms", toU(UBO::CameraViewProjTransforms));
+	program_manager.SetUniformBlockBinding("LightViewProjTransforms", toU(UBO::LightViewProjTransforms));
+
+	// Submit all programs before checking any of them, so that the driver
+	// can build them concurrently.
+	program_manager.CreateAndRegisterProgramDeferred("Fallback",
+	                                                 { { ShaderType::vertex, "common/fallback.vert" },
+	                                                   { ShaderType::fragment, "common/fallback.frag" } },
+	                                                 fallback_shader);
+
+	// The G-buffer shader gets specialised on the textures each mesh has,
+	// rather than branching on them at runtime; all variants used by
+	// Sponza, with and without the depth pre-pass, are built right away.
+	auto const fill_gbuffer_variants = program_manager.CreateAndRegisterProgramVariants("Fill G-Buffer",
+	                                                                                  { { ShaderType::vertex, "EDAN35/fill_gbuffer.vert" },
+	                                                                                    { ShaderType::fragment, "EDAN35/fill_gbuffer.frag" } },
+	                                                                                  { "HAS_DIFFUSE_TEXTURE", "HAS_SPECULAR_TEXTURE", "HAS_NORMALS_TEXTURE", "HAS_OPACITY_TEXTURE" });
+	auto const get_fill_gbuffer_variant_mask = [&program_manager, fill_gbuffer_variants](GeometryTextureData const& texture_data, bool is_depth_prepass_used) {
+		std::vector<std::string> keywords;
+		if (texture_data.diffuse_texture_id != 0u)
+			keywords.emplace_back("HAS_DIFFUSE_TEXTURE");
+		if (texture_data.specular_texture_id != 0u)
+			keywords.emplace_back("HAS_SPECULAR_TEXTURE");
+		if (texture_data.normals_texture_id != 0u)
+			keywords.emplace_back("HAS_NORMALS_TEXTURE");
+		// The depth pre-pass already discarded transparent fragments.
+		if (texture_data.opacity_texture_id != 0u && !is_depth_prepass_used)
+			keywords.emplace_back("HAS_OPACITY_TEXTURE");
+		return program_manager.GetVariantMask(fill_gbuffer_variants, keywords);
+	};
+	std::vector<ShaderProgramManager::VariantMask> fill_gbuffer_variant_masks;
+	for (auto const& texture_data : sponza_geometry_texture_data) {
+		for (auto const is_depth_prepass_used : { false, true }) {
+			auto const mask = get_fill_gbuffer_variant_mask(texture_data, is_depth_prepass_used);
+			if (std::find(fill_gbuffer_variant_masks.begin(), fill_gbuffer_variant_masks.end(), mask) == fill_gbuffer_variant_masks.end())
+				fill_gbuffer_variant_masks.push_back(mask);
+		}
+	}
+	program_manager.WarmProgramVariants(fill_gbuffer_variants, fill_gbuffer_variant_masks);
+
+	program_manager.CreateAndRegisterProgramDeferred("Depth pre-pass (opaque)",
+	                                                 { { ShaderType::vertex, "EDAN35/depth_prepass.vert" },
+	                                                   { ShaderType::fragment, "EDAN35/depth_prepass.frag" } },
+	                                                 depth_prepass_opaque_shader);
+	// Alpha-tested meshes discard fragments exactly as when filling shadow
+	// maps, hence the shared fragment shader.
+	program_manager.CreateAndRegisterProgramDeferred("Depth pre-pass (alpha tested)",
+	                                                 { { ShaderType::vertex, "EDAN35/depth_prepass.vert" },
+	                                                   { ShaderType::fragment, "EDAN35/fill_shadowmap.frag" } },
+	                                                 depth_prepass_alpha_tested_shader);
+	program_manager.CreateAndRegisterProgramDeferred("Fill shadow map",
+	                                                 { { ShaderType::vertex, "EDAN35/fill_shadowmap.vert" },
+	                                                   { ShaderType::fragment, "EDAN35/fill_shadowmap.frag" } },
+	                                                 fill_shadowmap_shader);
+	program_manager.CreateAndRegisterProgramDeferred("Fill shadow map (layered)",
+	                                                 { { ShaderType::vertex, "EDAN35/fill_shadowmap_layered.vert" },
+	                                                   { ShaderType::geometry, "EDAN35/fill_shadowmap_layered.geom" },
+	                                                   { ShaderType::fragment, "EDAN35/fill_shadowmap.frag" } },
+	                                                 fill_shadowmap_layered_shader);
+	program_manager.CreateAndRegisterProgramDeferred("Accumulate light",
+	                                                 { { ShaderType::vertex, "EDAN35/accumulate_lights.vert" },
+	                                                   { ShaderType::fragment, "EDAN35/accumulate_lights.frag" } },
+	                                                 accumulate_lights_shader);
+	program_manager.CreateAndRegisterProgramDeferred("Fill shadow map cascade",
+	                                                 { { ShaderType::vertex, "EDAN35/fill_shadowmap_cascade.vert" },
+	                                                   { ShaderType::fragment, "EDAN35/fill_shadowmap.frag" } },
+	                                                 fill_shadowmap_cascade_shader);
+	program_manager.CreateAndRegisterProgramDeferred("Accumulate sun",
+	                                                 { { ShaderType::vertex, "EDAN35/resolve_deferred.vert" },
+	                                                   { ShaderType::fragment, "EDAN35/accumulate_sun.frag" } },
+	                                                 accumulate_sun_shader);
+	program_manager.CreateAndRegisterProgramDeferred("Accumulate lights (clustered)",
+	                                                 { { ShaderType::vertex, "EDAN35/resolve_deferred.vert" },
+	                                                   { ShaderType::fragment, "EDAN35/accumulate_lights_clustered.frag" } },
+	                                                 accumulate_lights_clustered_shader);
+	program_manager.CreateAndRegisterProgramDeferred("Resolve deferred",
+	                                                 { { ShaderType::vertex, "EDAN35/resolve_deferred.vert" },
+	                                                   { ShaderType::fragment, "EDAN35/resolve_deferred.frag" } },
+	                                                 resolve_deferred_shader);
+	program_manager.CreateAndRegisterProgramDeferred("Render light cones",
+	                                                 { { ShaderType::vertex, "EDAN35/render_light_cones.vert" },
+	                                                   { ShaderType::fragment, "EDAN35/render_light_cones.frag" } },
+	                                                 render_light_cones_shader);
+	program_manager.ResolvePendingPrograms();
+
 	if (fallback_shader == 0u) {
 		LogError("Failed to load fallback shader");
 		return;
 	}
 
-	GLuint fill_gbuffer_shader = 0u;
-	program_manager.CreateAndRegisterProgram("Fill G-Buffer",
-	                                         { { ShaderType::vertex, "EDAN35/fill_gbuffer.vert" },
-	                                           { ShaderType::fragment, "EDAN35/fill_gbuffer.frag" } },
-	                                         fill_gbuffer_shader);
-	if (fill_gbuffer_shader == 0u) {
-		LogError("Failed to load G-buffer filling shader");
+	for (auto const mask : fill_gbuffer_variant_masks) {
+		if (program_manager.GetProgramVariant(fill_gbuffer_variants, mask) == 0u) {
+			LogError("Failed to load G-buffer filling shader");
+			return;
+		}
+	}
+
+	if (depth_prepass_opaque_shader == 0u) {
+		LogError("Failed to load opaque depth pre-pass shader");
+		return;
+	}
+
+	if (depth_prepass_alpha_tested_shader == 0u) {
+		LogError("Failed to load alpha-tested depth pre-pass shader");
 		return;
 	}
-	GBufferShaderLocations fill_gbuffer_shader_locations;
-	fillGBufferShaderLocations(fill_gbuffer_shader, fill_gbuffer_shader_locations);
 
-	GLuint fill_shadowmap_shader = 0u;
-	program_manager.CreateAndRegisterProgram("Fill shadow map",
-	                                         { { ShaderType::vertex, "EDAN35/fill_shadowmap.vert" },
-	                                           { ShaderType::fragment, "EDAN35/fill_shadowmap.frag" } },
-	                                         fill_shadowmap_shader);
 	if (fill_shadowmap_shader == 0u) {
 		LogError("Failed to load shadowmap filling shader");
 		return;
 	}
-	FillShadowmapShaderLocations fill_shadowmap_shader_locations;
-	fillShadowmapShaderLocations(fill_shadowmap_shader, fill_shadowmap_shader_locations);
 
-	GLuint accumulate_lights_shader = 0u;
-	program_manager.CreateAndRegisterProgram("Accumulate light",
-	                                         { { ShaderType::vertex, "EDAN35/accumulate_lights.vert" },
-	                                           { ShaderType::fragment, "EDAN35/accumulate_lights.frag" } },
-	                                         accumulate_lights_shader);
+	if (fill_shadowmap_layered_shader == 0u) {
+		LogError("Failed to load layered shadowmap filling shader");
+		return;
+	}
+
 	if (accumulate_lights_shader == 0u) {
 		LogError("Failed to load lights accumulating shader");
 		return;
 	}
-	AccumulateLightsShaderLocations accumulate_light_shader_locations;
-	fillAccumulateLightsShaderLocations(accumulate_lights_shader, accumulate_light_shader_locations);
 
-	GLuint resolve_deferred_shader = 0u;
-	program_manager.CreateAndRegisterProgram("Resolve deferred",
-	                                         { { ShaderType::vertex, "EDAN35/resolve_deferred.vert" },
-	                                           { ShaderType::fragment, "EDAN35/resolve_deferred.frag" } },
-	                                         resolve_deferred_shader);
+	if (fill_shadowmap_cascade_shader == 0u) {
+		LogError("Failed to load shadowmap cascade filling shader");
+		return;
+	}
+
+	if (accumulate_sun_shader == 0u) {
+		LogError("Failed to load sun accumulating shader");
+		return;
+	}
+
+	if (accumulate_lights_clustered_shader == 0u) {
+		LogError("Failed to load clustered lights accumulating shader");
+		return;
+	}
+
 	if (resolve_deferred_shader == 0u) {
 		LogError("Failed to load deferred resolution shader");
 		return;
 	}
 
-	GLuint render_light_cones_shader = 0u;
-	program_manager.CreateAndRegisterProgram("Render light cones",
-	                                         { { ShaderType::vertex, "EDAN35/render_light_cones.vert" },
-	                                           { ShaderType::fragment, "EDAN35/render_light_cones.frag" } },
-	                                         render_light_cones_shader);
 	if (render_light_cones_shader == 0u) {
 		LogError("Failed to load light cones rendering shader");
 		return;
 	}
+	program_manager.LogLoadingStatistics();
 
 	auto const set_uniforms = [](GLuint /*program*/){};
 
@@ -320,10 +499,10 @@ edan35::Assignment2::run()
 
 	const GLuint debug_texture_id = bonobo::getDebugTextureID();
 
-	auto const bind_texture_with_sampler = [](GLenum target, unsigned int slot, GLuint program, std::string const& name, GLuint texture, GLuint sampler){
+	auto const bind_texture_with_sampler = [&program_manager](GLenum target, unsigned int slot, GLuint program, std::string const& name, GLuint texture, GLuint sampler){
 		glActiveTexture(GL_TEXTURE0 + slot);
 		glBindTexture(target, texture);
-		glUniform1i(glGetUniformLocation(program, name.c_str()), static_cast<GLint>(slot));
+		glUniform1i(program_manager.GetUniformLocation(program, name), static_cast<GLint>(slot));
 		glBindSampler(slot, sampler);
 	};
 
@@ -345,16 +524,154 @@ edan35::Assignment2::run()
 
 	float const lightProjectionNearPlane = 0.01f * constant::scale_lengths;
 	float const lightProjectionFarPlane = 20.0f * constant::scale_lengths;
-	auto lightProjection = glm::perspective(0.5f * glm::pi<float>(),
-	                                        static_cast<float>(constant::shadowmap_res_x) / static_cast<float>(constant::shadowmap_res_y),
+	auto lightProjection = glm::perspective(0.5f * glm::pi<float>(), 1.0f,
 	                                        lightProjectionNearPlane, lightProjectionFarPlane);
 
+	//
+	// All shadow maps share a single atlas, in which each light gets a
+	// region sized after how much of the screen it might cover.
+	//
+	ShadowAtlas shadow_atlas(constant::shadow_atlas_res, constant::shadowmap_min_res);
+	std::vector<std::uint32_t> shadowmap_requested_res(constant::lights_nb, 0u);
+
+	//
+	// Sponza never moves, so its depth as seen from a light only needs to
+	// be rendered again when that light moves or gets a different atlas
+	// region. It is kept in a second atlas, from which it is copied every
+	// frame before dynamic shadow casters get drawn on top.
+	//
+	struct CachedShadowMap
+	{
+		glm::mat4 world_to_clip{ 1.0f };
+		ShadowAtlas::Region region;
+		bool is_valid{ false };
+	};
+	std::array<CachedShadowMap, constant::lights_nb> cached_shadowmaps;
+	bool use_shadowmap_caching = true;
+	size_t rerendered_shadowmaps_nb = 0u;
+
+	// The program manager keeps uniform locations and block bindings up
+	// to date, but the cached shadow maps were drawn with the previous
+	// shaders.
+	auto const refresh_programs_state = [&](){
+		for (auto& cached_shadowmap : cached_shadowmaps)
+			cached_shadowmap.is_valid = false;
+	};
+
+	// When enabled, all shadow maps needing an update are rendered by a
+	// single submission of the scene: a geometry shader duplicates each
+	// triangle into the viewport of each of those lights.
+	bool use_layered_shadowmaps = false;
+
+	// Draw the depth of the meshes for which |is_selected| returns true,
+	// discarding fragments through their opacity texture, if any.
+	auto const draw_depth_only = [&](GLuint program, auto const& is_selected) {
+		glUniform1i(program_manager.GetUniformLocation(program, "opacity_texture"), 0);
+		for (std::size_t i = 0; i < sponza_geometry.size(); ++i)
+		{
+			auto const& geometry = sponza_geometry[i];
+			auto const& texture_data = sponza_geometry_texture_data[i];
+			if (!is_selected(texture_data))
+				continue;
+
+			utils::opengl::debug::beginDebugGroup(geometry.name);
+
+			auto const vertex_model_to_world = glm::mat4(1.0f);
+			glUniformMatrix4fv(program_manager.GetUniformLocation(program, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(vertex_model_to_world));
+
+			glUniform1i(program_manager.GetUniformLocation(program, "has_opacity_texture"), texture_data.opacity_texture_id != 0u ? 1 : 0);
+			glBindSampler(0u, texture_data.opacity_texture_id != 0u ? samplers[toU(Sampler::Mipmaps)] : samplers[toU(Sampler::Nearest)]);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, texture_data.opacity_texture_id != 0u ? texture_data.opacity_texture_id : debug_texture_id);
+
+			// Textures which go unused are the first to shrink when over the
+			// memory budget.
+			for (auto const texture : { texture_data.diffuse_texture_id, texture_data.specular_texture_id,
+			                            texture_data.normals_texture_id, texture_data.opacity_texture_id })
+				resource_registry.MarkUsed(ResourceType::texture, texture);
+
+			glBindVertexArray(geometry.vao);
+			if (geometry.ibo != 0u)
+				glDrawElements(geometry.drawing_mode, geometry.indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
+			else
+				glDrawArrays(geometry.drawing_mode, 0, geometry.vertices_nb);
+
+
+			utils::opengl::debug::endDebugGroup();
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindVertexArray(0u);
+	};
+	auto const draw_shadow_casters = [&](GLuint program) {
+		draw_depth_only(program, [](GeometryTextureData const&){ return true; });
+	};
+
+	// When enabled, the depth of the scene is laid down first with
+	// cheap shaders, opaque meshes before alpha-tested ones, and the
+	// G-buffer is then only filled for the visible fragments.
+	bool use_depth_prepass = false;
+
+	//
+	// Setup the many unshadowed point lights used by the clustered
+	// lighting mode; they float around the atrium of Sponza.
+	//
+	LightClusters light_clusters(glm::uvec3(constant::light_clusters_x, constant::light_clusters_y, constant::light_clusters_z));
+	std::vector<LightClusters::Light> clustered_lights(constant::clustered_lights_nb);
+	std::vector<glm::vec3> clustered_lights_origins(constant::clustered_lights_nb);
+	std::vector<float> clustered_lights_phases(constant::clustered_lights_nb);
+	auto const random_unit = [](){ return static_cast<float>(rand()) / static_cast<float>(RAND_MAX); };
+	for (size_t i = 0; i < constant::clustered_lights_nb; ++i) {
+		clustered_lights_origins[i] = glm::vec3(-11.0f + 22.0f * random_unit(),
+		                                        0.5f + 5.5f * random_unit(),
+		                                        -4.0f + 8.0f * random_unit()) * constant::scale_lengths;
+		clustered_lights_phases[i] = glm::two_pi<float>() * random_unit();
+		clustered_lights[i].radius = constant::clustered_light_radius;
+		clustered_lights[i].color = glm::vec3(0.5f + 0.5f * random_unit(), 0.5f + 0.5f * random_unit(), 0.5f + 0.5f * random_unit());
+		clustered_lights[i].intensity = constant::clustered_light_intensity;
+	}
+	int clustered_lights_nb = 256;
+	bool use_clustered_lighting = false;
+	std::chrono::high_resolution_clock::duration light_binning_time{ 0 };
+
+	//
+	// Benchmark sweeping over the number of clustered lights; each step
+	// waits a few frames for the previous one to be flushed, then averages
+	// the timings over several frames.
+	//
+	std::array<int, 6> const light_sweep_counts = { 4, 16, 64, 256, 1024, 4096 };
+	constexpr int light_sweep_warmup_frames_nb = 10;
+	constexpr int light_sweep_measured_frames_nb = 50;
+	struct LightSweepResult
+	{
+		int lights_nb;
+		float gpu_time_ms;
+		float binning_time_ms;
+	};
+	std::vector<LightSweepResult> light_sweep_results;
+	size_t light_sweep_step = light_sweep_counts.size();
+	int light_sweep_frame = 0;
+	int light_sweep_gpu_samples_nb = 0;
+	LightSweepResult light_sweep_sum{ 0, 0.0f, 0.0f };
+
 	TRSTransformf coneScaleTransform;
 	coneScaleTransform.SetScale(glm::vec3(lightProjectionFarPlane * 0.8f));
 
 	TRSTransformf lightOffsetTransform;
 	lightOffsetTransform.SetTranslate(glm::vec3(0.0f, 0.0f, -0.4f) * constant::scale_lengths);
 
+	//
+	// Setup the sun, whose shadows are split into cascades along the
+	// camera frustum.
+	//
+	bool is_sun_enabled = false;
+	float sun_elevation = glm::radians(60.0f);
+	float sun_azimuth = glm::radians(30.0f);
+	glm::vec3 sun_color = glm::vec3(1.0f, 0.95f, 0.85f);
+	float sun_intensity = 2.0f;
+	std::vector<ShadowCascade> sun_cascades(constant::sun_cascades_nb);
+	std::array<glm::mat4, constant::sun_cascades_nb> sun_cascade_world_to_clip_matrices;
+	glm::vec4 sun_cascade_far_distances = glm::vec4(0.0f);
+
 
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClearDepthf(1.0f);
@@ -362,37 +679,137 @@ edan35::Assignment2::run()
 	glEnable(GL_CULL_FACE);
 
 
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
-
-
 	auto seconds_nb = 0.0f;
-	std::array<GLuint64, toU(ElapsedTimeQuery::Count)> pass_elapsed_times;
+	std::uint64_t transform_matrix_requests_nb = 0u, transform_matrix_builds_nb = 0u;
 	auto lastTime = std::chrono::high_resolution_clock::now();
 	bool show_textures = true;
 	bool show_cone_wireframe = false;
 
-	bool show_logs = true;
-	bool show_gui = true;
-	bool shader_reload_failed = false;
-	bool copy_elapsed_times = true;
-	bool first_frame = true;
+	bool show_logs = !is_benchmark;
+	bool show_profiler = false;
+	bool show_memory = false;
+	bool show_gui = !is_benchmark;
 	bool show_basis = false;
 	float basis_thickness_scale = 40.0f;
 	float basis_length_scale = 400.0f;
 
+	// Latest GPU timings measured with each G-buffer layout, to compare them.
+	struct GBufferLayoutTimings
+	{
+		float gbuffer_ms{ 0.0f };
+		float lighting_ms{ 0.0f };
+		float resolve_ms{ 0.0f };
+		bool is_measured{ false };
+	};
+	std::array<GBufferLayoutTimings, toU(GBufferLayout::Count)> gbuffer_layout_timings;
+	// GPU timings lag a few frames behind; this is the first frame rendered
+	// with the current layout.
+	std::uint64_t gbuffer_layout_first_frame = 0u;
+	std::uint64_t last_measured_frame = 0u;
+
+	// Rough amount of bytes read and written per frame by the G-buffer and
+	// light accumulation targets; every lighting pass is assumed to cover
+	// the whole screen, so this is an upper bound.
+	auto const estimate_gbuffer_traffic = [&](GBufferLayout layout) {
+		auto const pixels_nb = static_cast<size_t>(framebuffer_width) * static_cast<size_t>(framebuffer_height);
+		auto const lighting_passes_nb = (use_clustered_lighting ? 1u : static_cast<size_t>(lights_nb)) + (is_sun_enabled ? 1u : 0u);
+		auto const depth_and_normal_pixel_size = 4u + 4u;
+		// RGBA8 and R11F_G11F_B10F both take 4 bytes per pixel, so the
+		// compact layout only gains range and precision there.
+		auto const light_accumulation_pixel_size = 2u * 4u;
+		auto const resolve_pixel_size = (layout == GBufferLayout::Compact ? 4u : 8u) + light_accumulation_pixel_size + 4u;
+		return pixels_nb * (getGBufferPixelSize(layout)
+		                    + lighting_passes_nb * (depth_and_normal_pixel_size + 2u * light_accumulation_pixel_size)
+		                    + resolve_pixel_size);
+	};
+
 	while (!glfwWindowShouldClose(window)) {
+		ProfileNewFrame();
+		ProfileScope("Frame");
+
+		resource_registry.NewFrame();
+		memory_budget.Update();
+
 		auto const nowTime = std::chrono::high_resolution_clock::now();
 		auto const deltaTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(nowTime - lastTime);
 		lastTime = nowTime;
+
+		if (is_benchmark) {
+			// The previous frame just ended, for both the wall clock and the
+			// profiler.
+			auto const previous_frame = gpu_timer.GetCurrentFrameNumber();
+			if (previous_frame > mBenchmarkSettings.warmup_frames_nb) {
+				benchmark_recorder.AddSample(previous_frame, "CPU", "Frame time", std::chrono::duration<float, std::milli>(deltaTimeUs).count());
+				for (auto const& duration : Profiler::GetLastFrameDurations())
+					benchmark_recorder.AddSample(previous_frame, "CPU", duration.name, duration.duration_ms);
+			}
+
+			if (previous_frame >= mBenchmarkSettings.warmup_frames_nb + mBenchmarkSettings.frames_nb) {
+				gpu_timer.Flush();
+
+				auto const description = "EDAN35 deferred renderer at " + std::to_string(framebuffer_width) + "x" + std::to_string(framebuffer_height)
+				                       + ", " + std::to_string(mBenchmarkSettings.frames_nb) + " frames after " + std::to_string(mBenchmarkSettings.warmup_frames_nb)
+				                       + " warm-up ones, along " + (mBenchmarkSettings.camera_path.empty() ? std::string("the built-in fly-through") : mBenchmarkSettings.camera_path)
+				                       + ", " + std::to_string(gpu_timer.GetDroppedFramesCount()) + " GPU frames dropped";
+				LogInfo("Benchmark done: %s.", description.c_str());
+				if (gpu_timer.GetDroppedFramesCount() > 0u)
+					LogWarning("%llu GPU frames were dropped, as their timings took too long to come back: the GPU results are incomplete.",
+					           static_cast<unsigned long long>(gpu_timer.GetDroppedFramesCount()));
+				benchmark_recorder.LogSummaries();
+				benchmark_recorder.WriteCSV(mBenchmarkSettings.output_prefix + ".csv");
+				benchmark_recorder.WriteJSON(mBenchmarkSettings.output_prefix + ".json", description);
+				memory_budget.WriteJSON(mBenchmarkSettings.output_prefix + "_memory.json");
+				break;
+			}
+		}
+
+		// Benchmarks advance by fixed steps, so that every run renders the
+		// exact same frames.
+		auto const animation_delta_s = is_benchmark ? 1.0f / 60.0f : std::chrono::duration<float>(deltaTimeUs).count();
 		if (!are_lights_paused)
-			seconds_nb += std::chrono::duration<decltype(seconds_nb)>(deltaTimeUs).count();
+			seconds_nb += animation_delta_s;
 
 		auto& io = ImGui::GetIO();
 		inputHandler.SetUICapture(io.WantCaptureMouse, io.WantCaptureKeyboard);
 
 		glfwPollEvents();
 		inputHandler.Advance();
-		mCamera.Update(deltaTimeUs, inputHandler);
+
+		// Resizing the window, or toggling fullscreen, only changes the
+		// reference size of the pool: targets of the new size get created
+		// as they are acquired.
+		{
+			int width = 0, height = 0;
+			glfwGetFramebufferSize(window, &width, &height);
+			if (width > 0 && height > 0 && (width != framebuffer_width || height != framebuffer_height)) {
+				framebuffer_width = width;
+				framebuffer_height = height;
+				render_target_pool.SetReferenceSize(glm::uvec2(framebuffer_width, framebuffer_height));
+				LogTrivia("Render targets resized to %dx%d.", framebuffer_width, framebuffer_height);
+			}
+		}
+		render_target_pool.NewFrame();
+		if (is_benchmark) {
+			auto const progress = static_cast<float>(gpu_timer.GetCurrentFrameNumber()) / static_cast<float>(mBenchmarkSettings.warmup_frames_nb + mBenchmarkSettings.frames_nb);
+			camera_path.Apply(progress * camera_path.GetDuration(), mCamera);
+		} else {
+			mCamera.Update(deltaTimeUs, inputHandler);
+		}
+
+		if (inputHandler.GetKeycodeState(GLFW_KEY_F6) & JUST_RELEASED) {
+			is_recording_camera_path = !is_recording_camera_path;
+			if (is_recording_camera_path) {
+				camera_path.Clear();
+				camera_path_recording_time = 0.0f;
+				LogInfo("Started recording the camera path.");
+			} else {
+				camera_path.Save("camera_path.txt");
+			}
+		}
+		if (is_recording_camera_path) {
+			camera_path.AddKeyframe(camera_path_recording_time, mCamera);
+			camera_path_recording_time += std::chrono::duration<float>(deltaTimeUs).count();
+		}
 
 		camera_view_proj_transforms.view_projection = mCamera.GetWorldToClipMatrix();
 		camera_view_proj_transforms.view_projection_inverse = mCamera.GetClipToWorldMatrix();
@@ -400,36 +817,80 @@ edan35::Assignment2::run()
 		auto const view_projection = camera_view_proj_transforms.view_projection;
 
 		if (inputHandler.GetKeycodeState(GLFW_KEY_R) & JUST_PRESSED) {
-			shader_reload_failed = !program_manager.ReloadAllPrograms();
-			if (shader_reload_failed)
+			if (!program_manager.ReloadAllPrograms())
 			{
 				tinyfd_notifyPopup("Shader Program Reload Error",
 				                   "An error occurred while reloading shader programs; see the logs for details.\n"
-				                   "Rendering is suspended until the issue is solved. Once fixed, just reload the shaders again.",
+				                   "The previous versions of the failing programs are used until the issue is solved.",
 				                   "error");
 			}
-			else
-			{
-				fillGBufferShaderLocations(fill_gbuffer_shader, fill_gbuffer_shader_locations);
-				fillShadowmapShaderLocations(fill_shadowmap_shader, fill_shadowmap_shader_locations);
-				fillAccumulateLightsShaderLocations(accumulate_lights_shader, accumulate_light_shader_locations);
-			}
+			refresh_programs_state();
+		}
+		// Saved shaders get rebuilt in the background; only the programs
+		// which built successfully are swapped in.
+		else if (program_manager.ReloadChangedPrograms())
+		{
+			refresh_programs_state();
 		}
 		if (inputHandler.GetKeycodeState(GLFW_KEY_F3) & JUST_RELEASED)
 			show_logs = !show_logs;
 		if (inputHandler.GetKeycodeState(GLFW_KEY_F2) & JUST_RELEASED)
 			show_gui = !show_gui;
+		if (inputHandler.GetKeycodeState(GLFW_KEY_F11) & JUST_RELEASED)
+			mWindowManager.ToggleFullscreenStatusForWindow(window);
 
 		mWindowManager.NewImGuiFrame();
 
-		if (!first_frame && show_gui && copy_elapsed_times) {
-			// Copy all timings back from the GPU to the CPU.
-			for (GLuint i = 0; i < pass_elapsed_times.size(); ++i) {
-				glGetQueryObjectui64v(elapsed_time_queries[i], GL_QUERY_RESULT, pass_elapsed_times.data() + i);
-			}
+		bool const is_light_sweep_running = light_sweep_step < light_sweep_counts.size();
+
+		// Only collects the timings of previous frames which the GPU is
+		// already done with, so this never stalls.
+		gpu_timer.BeginFrame();
+		auto const measured_frame = gpu_timer.GetLatestFrameNumber();
+		bool const has_new_timings = measured_frame != last_measured_frame;
+		last_measured_frame = measured_frame;
+
+		if (has_new_timings && measured_frame >= gbuffer_layout_first_frame) {
+			// Passes which were not part of the measured frame, like the
+			// sun when it is disabled, get a duration of 0.
+			auto& timings = gbuffer_layout_timings[toU(gbuffer_layout)];
+			timings.gbuffer_ms = gpu_timer.GetLatestDuration("G-buffer generation");
+			timings.lighting_ms = gpu_timer.GetLatestDuration("Clustered lights accumulation")
+			                    + gpu_timer.GetLatestDuration("Sun accumulation");
+			for (size_t i = 0; i < constant::lights_nb; ++i)
+				timings.lighting_ms += gpu_timer.GetLatestDuration("Light " + std::to_string(i) + " accumulation");
+			timings.resolve_ms = gpu_timer.GetLatestDuration("Resolve");
+			timings.is_measured = true;
 		}
 
 
+		if (is_light_sweep_running) {
+			// GPU timings come back a few frames late, which the warm-up
+			// frames cover; frames whose timings did not come back at all
+			// are left out of the GPU average.
+			if (light_sweep_frame >= light_sweep_warmup_frames_nb) {
+				if (has_new_timings) {
+					light_sweep_sum.gpu_time_ms += gpu_timer.GetLatestDuration("Clustered lights accumulation");
+					++light_sweep_gpu_samples_nb;
+				}
+				light_sweep_sum.binning_time_ms += std::chrono::duration<float, std::milli>(light_binning_time).count();
+			}
+			if (++light_sweep_frame == light_sweep_warmup_frames_nb + light_sweep_measured_frames_nb) {
+				LightSweepResult const result = { clustered_lights_nb,
+				                                  light_sweep_sum.gpu_time_ms / static_cast<float>(std::max(light_sweep_gpu_samples_nb, 1)),
+				                                  light_sweep_sum.binning_time_ms / static_cast<float>(light_sweep_measured_frames_nb) };
+				LogInfo("Clustered lighting with %d lights: %.3f ms GPU, %.3f ms binning on CPU",
+				        result.lights_nb, result.gpu_time_ms, result.binning_time_ms);
+				light_sweep_results.push_back(result);
+
+				light_sweep_sum = LightSweepResult{ 0, 0.0f, 0.0f };
+				light_sweep_frame = 0;
+				light_sweep_gpu_samples_nb = 0;
+				if (++light_sweep_step < light_sweep_counts.size())
+					clustered_lights_nb = light_sweep_counts[light_sweep_step];
+			}
+		}
+
 		for (size_t i = 0; i < static_cast<size_t>(lights_nb); ++i) {
 			auto& lightTransform = lightTransforms[i];
 			lightTransform.SetRotate(glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(constant::lights_nb) + 0.1f * seconds_nb, glm::vec3(0.0f, 1.0f, 0.0f));
@@ -442,6 +903,269 @@ edan35::Assignment2::run()
 			light_view_proj_transforms[i].view_projection_inverse = glm::inverse(light_world_to_clip_matrix);
 		}
 
+		//
+		// Hand out the shadow atlas regions: the resolution wished for by a
+		// light follows the approximate fraction of the screen covered by
+		// its cone, and lights which do not cast shadows get none.
+		//
+		auto const shadowed_lights_nb = use_clustered_lighting ? 0u : static_cast<size_t>(lights_nb);
+		auto const camera_tan_half_fov = std::tan(0.5f * mCamera.mFov);
+		for (size_t i = 0; i < constant::lights_nb; ++i) {
+			if (i >= shadowed_lights_nb) {
+				shadowmap_requested_res[i] = 0u;
+				continue;
+			}
+			auto const light_position = glm::vec3(lightTransforms[i].GetMatrix() * lightOffsetTransform.GetMatrix() * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+			auto const light_distance = glm::max(glm::distance(light_position, mCamera.mWorld.GetTranslation()), 1.0f);
+			auto const screen_coverage = glm::clamp(lightProjectionFarPlane * 0.8f / (light_distance * camera_tan_half_fov), 0.0f, 1.0f);
+			shadowmap_requested_res[i] = static_cast<std::uint32_t>(screen_coverage * static_cast<float>(constant::shadowmap_max_res));
+		}
+		shadow_atlas.allocate(shadowmap_requested_res);
+
+		auto const sun_direction = -glm::vec3(std::cos(sun_elevation) * std::sin(sun_azimuth),
+		                                      std::sin(sun_elevation),
+		                                      std::cos(sun_elevation) * std::cos(sun_azimuth));
+		if (is_sun_enabled) {
+			auto const sun_shadow_distance = glm::min(mCamera.mFar, constant::sun_shadow_distance);
+			compute_shadow_cascades(mCamera.mWorld.GetMatrix(), mCamera.mFov, mCamera.mAspect,
+			                        mCamera.mNear, sun_shadow_distance, sun_direction,
+			                        constant::sun_shadowmap_res, constant::sun_cascade_split_lambda,
+			                        constant::sun_shadow_caster_extension, sun_cascades);
+			for (size_t i = 0; i < constant::sun_cascades_nb; ++i) {
+				sun_cascade_world_to_clip_matrices[i] = sun_cascades[i].world_to_clip;
+				sun_cascade_far_distances[static_cast<glm::length_t>(i)] = sun_cascades[i].far_distance;
+			}
+		}
+
+		// The targets of the previous layout no longer match any
+		// description, and get destroyed by the pool once unused.
+		if (requested_gbuffer_layout != gbuffer_layout) {
+			gbuffer_layout = requested_gbuffer_layout;
+			gbuffer_layout_first_frame = gpu_timer.GetCurrentFrameNumber();
+
+			LogInfo("Switched to the %s G-buffer layout.", gbuffer_layout_names[toU(gbuffer_layout)]);
+		}
+
+		if (is_render_target_check_requested) {
+			checkRenderTargetResizing(render_target_pool);
+			is_render_target_check_requested = false;
+		}
+
+		if (use_clustered_lighting) {
+			//
+			// Bin all clustered lights on the CPU, so that every pixel
+			// only gets shaded against the lights of its cluster.
+			//
+			auto const binning_start_time = std::chrono::high_resolution_clock::now();
+			{
+				ProfileScope("Bin clustered lights");
+				for (size_t i = 0; i < static_cast<size_t>(clustered_lights_nb); ++i) {
+					auto const bobbing = 0.5f * constant::scale_lengths * std::sin(0.5f * seconds_nb + clustered_lights_phases[i]);
+					clustered_lights[i].position = clustered_lights_origins[i] + glm::vec3(0.0f, bobbing, 0.0f);
+				}
+				light_clusters.update(clustered_lights, static_cast<size_t>(clustered_lights_nb),
+				                      mCamera.GetWorldToViewMatrix(), mCamera.GetViewToClipMatrix(),
+				                      mCamera.mNear, mCamera.mFar);
+			}
+			light_binning_time = std::chrono::high_resolution_clock::now() - binning_start_time;
+		}
+
+		//
+		// Build the GUI windows up front, as they get rendered by one of
+		// the passes of the frame.
+		//
+		bool opened = ImGui::Begin("Render Time", nullptr, ImGuiWindowFlags_None);
+		if (opened) {
+			ImGui::Text("Frame CPU time: %.3f ms", std::chrono::duration<float, std::milli>(deltaTimeUs).count());
+			ImGui::SameLine();
+			ImGui::Checkbox("Show profiler", &show_profiler);
+
+			ImGui::Text("Transform matrices in last frame: %llu requested, %llu built",
+			            static_cast<unsigned long long>(transform_matrix_requests_nb),
+			            static_cast<unsigned long long>(transform_matrix_builds_nb));
+
+			ImGui::Text("Shadow maps re-rendered in last frame: %zu", rerendered_shadowmaps_nb);
+
+			auto const resource_usage = resource_registry.GetTotalUsage();
+			ImGui::Text("OpenGL objects: %zu, using %.1f MiB", resource_usage.objects_nb,
+			            static_cast<float>(resource_usage.bytes) / (1024.0f * 1024.0f));
+			ImGui::SameLine();
+			if (ImGui::Button("Log resource usage"))
+				resource_registry.LogReport();
+			ImGui::SameLine();
+			ImGui::Checkbox("Show GPU memory", &show_memory);
+			ImGui::SameLine();
+			if (ImGui::Button("Write memory report"))
+				memory_budget.WriteJSON(mBenchmarkSettings.output_prefix + "_memory.json");
+
+			auto const render_target_statistics = render_target_pool.GetStatistics();
+			ImGui::Text("Render targets at %dx%d: %zu textures (%zu created so far), %zu framebuffers",
+			            framebuffer_width, framebuffer_height, render_target_statistics.targets_nb,
+			            render_target_statistics.created_targets_nb, render_target_statistics.framebuffers_nb);
+			ImGui::SameLine();
+			if (ImGui::Button("Check resizing"))
+				is_render_target_check_requested = true;
+
+			auto const render_graph_statistics = frame_graph.GetStatistics();
+			ImGui::Text("Render graph: %zu passes, %zu of them culled; %zu transient targets in %zu textures",
+			            render_graph_statistics.passes_nb, render_graph_statistics.culled_passes_nb,
+			            render_graph_statistics.transient_targets_nb, render_graph_statistics.textures_nb);
+			ImGui::SameLine();
+			if (ImGui::Button("Log render graph"))
+				is_render_graph_report_requested = true;
+
+			ImGui::Text("GPU timings from frame %llu; %llu frames dropped",
+			            static_cast<unsigned long long>(gpu_timer.GetLatestFrameNumber()),
+			            static_cast<unsigned long long>(gpu_timer.GetDroppedFramesCount()));
+			ImGui::SameLine();
+			if (ImGui::Button("Reset statistics"))
+				gpu_timer.ResetStatistics();
+
+			if (ImGui::BeginTable("Pass durations", 5, ImGuiTableFlags_SizingFixedFit))
+			{
+				ImGui::TableSetupColumn("Pass");
+				ImGui::TableSetupColumn("GPU time [ms]");
+				ImGui::TableSetupColumn("Min");
+				ImGui::TableSetupColumn("Avg");
+				ImGui::TableSetupColumn("Max");
+				ImGui::TableHeadersRow();
+
+				for (auto const& scope : gpu_timer.GetLatestFrameScopes()) {
+					ImGui::TableNextColumn();
+					ImGui::Text("%*s%s", static_cast<int>(2u * scope.depth), "", scope.name.c_str());
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", scope.statistics.last_ms);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", scope.statistics.min_ms);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", scope.statistics.avg_ms);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", scope.statistics.max_ms);
+				}
+
+				// Compare this total across both settings to tell whether
+				// the pre-pass pays for itself.
+				auto const* const gbuffer_statistics = gpu_timer.GetStatistics("G-buffer generation");
+				auto const* const prepass_statistics = gpu_timer.GetStatistics("Depth pre-pass");
+				ImGui::TableNextColumn();
+				ImGui::Text("G-buffer total with%s pre-pass", use_depth_prepass ? "" : "out");
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", gpu_timer.GetLatestDuration("G-buffer generation") + gpu_timer.GetLatestDuration("Depth pre-pass"));
+				ImGui::TableNextColumn();
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", (gbuffer_statistics != nullptr ? gbuffer_statistics->avg_ms : 0.0f)
+				                    + (use_depth_prepass && prepass_statistics != nullptr ? prepass_statistics->avg_ms : 0.0f));
+				ImGui::TableNextColumn();
+
+				ImGui::EndTable();
+			}
+
+			ImGui::Text("Shadow map resolutions:");
+			for (std::size_t i = 0; i < lights_nb; ++i) {
+				auto const shadowmap_res = shadow_atlas.get_region(i).size;
+				ImGui::SameLine();
+				ImGui::Text("%u", shadowmap_res);
+			}
+
+			ImGui::Separator();
+			auto gbuffer_layout_index = static_cast<int>(toU(requested_gbuffer_layout));
+			if (ImGui::Combo("G-buffer layout", &gbuffer_layout_index, gbuffer_layout_names.data(), static_cast<int>(gbuffer_layout_names.size())))
+				requested_gbuffer_layout = static_cast<GBufferLayout>(gbuffer_layout_index);
+			if (ImGui::BeginTable("G-buffer layouts", 6, ImGuiTableFlags_SizingFixedFit))
+			{
+				ImGui::TableSetupColumn("Layout");
+				ImGui::TableSetupColumn("G-buffer bytes/pixel");
+				ImGui::TableSetupColumn("Est. traffic [MiB/frame]");
+				ImGui::TableSetupColumn("G-buffer [ms]");
+				ImGui::TableSetupColumn("Lighting [ms]");
+				ImGui::TableSetupColumn("Resolve [ms]");
+				ImGui::TableHeadersRow();
+
+				for (uint32_t i = 0; i < toU(GBufferLayout::Count); ++i) {
+					auto const layout = static_cast<GBufferLayout>(i);
+					auto const& timings = gbuffer_layout_timings[i];
+					ImGui::TableNextColumn();
+					ImGui::Text("%s%s", gbuffer_layout_names[i], layout == gbuffer_layout ? " (current)" : "");
+					ImGui::TableNextColumn();
+					ImGui::Text("%zu", getGBufferPixelSize(layout));
+					ImGui::TableNextColumn();
+					ImGui::Text("%.1f", static_cast<float>(estimate_gbuffer_traffic(layout)) / (1024.0f * 1024.0f));
+					ImGui::TableNextColumn();
+					ImGui::Text(timings.is_measured ? "%.3f" : "-", timings.gbuffer_ms);
+					ImGui::TableNextColumn();
+					ImGui::Text(timings.is_measured ? "%.3f" : "-", timings.lighting_ms);
+					ImGui::TableNextColumn();
+					ImGui::Text(timings.is_measured ? "%.3f" : "-", timings.resolve_ms);
+				}
+
+				ImGui::EndTable();
+			}
+
+			ImGui::Separator();
+			ImGui::Text("Light binning CPU time: %.3f ms (%zu light indices)",
+			            std::chrono::duration<float, std::milli>(light_binning_time).count(),
+			            light_clusters.get_light_indices_nb());
+			if (is_light_sweep_running) {
+				ImGui::Text("Sweeping: %d lights...", clustered_lights_nb);
+			} else if (ImGui::Button("Sweep clustered light counts")) {
+				use_clustered_lighting = true;
+				light_sweep_results.clear();
+				light_sweep_step = 0u;
+				light_sweep_frame = 0;
+				clustered_lights_nb = light_sweep_counts[0];
+			}
+			if (!light_sweep_results.empty() && ImGui::BeginTable("Clustered lights sweep", 3, ImGuiTableFlags_SizingFixedFit))
+			{
+				ImGui::TableSetupColumn("Lights");
+				ImGui::TableSetupColumn("GPU time [ms]");
+				ImGui::TableSetupColumn("Binning CPU time [ms]");
+				ImGui::TableHeadersRow();
+
+				for (auto const& result : light_sweep_results) {
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", result.lights_nb);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", result.gpu_time_ms);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", result.binning_time_ms);
+				}
+
+				ImGui::EndTable();
+			}
+		}
+		ImGui::End();
+
+		opened = ImGui::Begin("Scene Controls", nullptr, ImGuiWindowFlags_None);
+		if (opened) {
+			ImGui::Checkbox("Pause lights", &are_lights_paused);
+			ImGui::SliderInt("Number of lights", &lights_nb, 1, static_cast<int>(constant::lights_nb));
+			ImGui::Checkbox("Use clustered lighting", &use_clustered_lighting);
+			ImGui::Checkbox("Use depth pre-pass", &use_depth_prepass);
+			ImGui::Checkbox("Cache static shadow maps", &use_shadowmap_caching);
+			ImGui::Checkbox("Render shadow maps in a single layered pass", &use_layered_shadowmaps);
+			ImGui::Separator();
+			ImGui::Checkbox("Enable sun", &is_sun_enabled);
+			ImGui::SliderAngle("Sun elevation", &sun_elevation, 0.0f, 90.0f);
+			ImGui::SliderAngle("Sun azimuth", &sun_azimuth, -180.0f, 180.0f);
+			ImGui::ColorEdit3("Sun colour", glm::value_ptr(sun_color));
+			ImGui::SliderFloat("Sun intensity", &sun_intensity, 0.0f, 10.0f);
+			ImGui::SliderInt("Number of clustered lights", &clustered_lights_nb, 1, static_cast<int>(constant::clustered_lights_nb));
+			ImGui::Checkbox("Show textures", &show_textures);
+			ImGui::Checkbox("Show light cones wireframe", &show_cone_wireframe);
+			ImGui::Separator();
+			ImGui::Checkbox("Show basis", &show_basis);
+			ImGui::SliderFloat("Basis thickness scale", &basis_thickness_scale, 0.0f, 100.0f);
+			ImGui::SliderFloat("Basis length scale", &basis_length_scale, 0.0f, 100.0f);
+		}
+		ImGui::End();
+
+		if (show_logs)
+			Log::View::Render();
+		if (show_profiler)
+			Profiler::RenderFlameView(&show_profiler);
+		if (show_memory)
+			memory_budget.RenderWindow(&show_memory);
+
 
 		//
 		// Update per-frame changing UBOs.
@@ -453,59 +1177,122 @@ edan35::Assignment2::run()
 		glBindBuffer(GL_UNIFORM_BUFFER, 0u);
 
 
-		if (!shader_reload_failed) {
-			//
-			// Pass 1: Render scene into the g-buffer
-			//
-			utils::opengl::debug::beginDebugGroup("Fill G-buffer");
-			glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::GbufferGeneration)]);
+		//
+		// Declare the passes of the frame along with what they read and
+		// write. Passes whose output ends up unused, like the texture
+		// views when hidden, get culled, and screen-sized targets share
+		// the same textures whenever their lifetimes allow it.
+		//
+		frame_graph.Clear();
+		auto targets = createSceneTargets(frame_graph, gbuffer_layout);
+		auto shadow_atlas_target = frame_graph.Import(texture_names[toU(Texture::ShadowAtlas)], textures[toU(Texture::ShadowAtlas)],
+		                                              glm::uvec2(constant::shadow_atlas_res));
+		auto sun_shadow_cascades_target = frame_graph.Import(texture_names[toU(Texture::SunShadowCascades)], textures[toU(Texture::SunShadowCascades)],
+		                                                     glm::uvec2(constant::sun_shadowmap_res));
 
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::GBuffer)]);
-			glViewport(0, 0, framebuffer_width, framebuffer_height);
-			glClear(GL_DEPTH_BUFFER_BIT);
+		//
+		// Pass 1 (pre-pass): Render the depth of the scene, first for
+		// opaque meshes, which can all benefit from early depth
+		// testing, then for alpha-tested ones
+		//
+		if (use_depth_prepass) {
+			frame_graph.AddPass("Depth pre-pass", [&](RenderGraph::PassBuilder& builder) {
+				targets.depth = builder.WriteDepth(targets.depth);
+				RenderPassState state;
+				state.colour_write = false;
+				builder.SetState(state);
+			}, [&](RenderGraph::PassContext const&) {
+				glClear(GL_DEPTH_BUFFER_BIT);
+
+				glUseProgram(depth_prepass_opaque_shader);
+				draw_depth_only(depth_prepass_opaque_shader,
+				                [](GeometryTextureData const& texture_data){ return texture_data.opacity_texture_id == 0u; });
+				glUseProgram(depth_prepass_alpha_tested_shader);
+				draw_depth_only(depth_prepass_alpha_tested_shader,
+				                [](GeometryTextureData const& texture_data){ return texture_data.opacity_texture_id != 0u; });
+				glUseProgram(0u);
+			});
+		}
+
+		//
+		// Pass 1: Render scene into the g-buffer
+		//
+		frame_graph.AddPass("G-buffer generation", [&](RenderGraph::PassBuilder& builder) {
+			targets.depth = builder.WriteDepth(targets.depth);
+			targets.gbuffer_diffuse = builder.WriteColour(0u, targets.gbuffer_diffuse);
+			// The compact layout has no specular texture, so the fragment
+			// shader output at location 1 gets discarded.
+			if (targets.gbuffer_specular.IsValid())
+				targets.gbuffer_specular = builder.WriteColour(1u, targets.gbuffer_specular);
+			targets.gbuffer_normals = builder.WriteColour(2u, targets.gbuffer_normals);
+
+			// The depth buffer was already filled by the pre-pass, so only
+			// the fragments matching it need to be shaded; as depth is not
+			// written anymore, early depth testing remains possible despite
+			// the discard in fill_gbuffer.frag, which gets skipped anyway.
+			if (use_depth_prepass) {
+				RenderPassState state;
+				state.depth_func = GL_EQUAL;
+				state.depth_write = false;
+				builder.SetState(state);
+			}
+		}, [&](RenderGraph::PassContext const&) {
+			if (!use_depth_prepass)
+				glClear(GL_DEPTH_BUFFER_BIT);
 			// XXX: Is any other clearing needed?
 
-			glUseProgram(fill_gbuffer_shader);
-			glUniform1i(fill_gbuffer_shader_locations.diffuse_texture, 0);
-			glUniform1i(fill_gbuffer_shader_locations.specular_texture, 1);
-			glUniform1i(fill_gbuffer_shader_locations.normals_texture, 2);
-			glUniform1i(fill_gbuffer_shader_locations.opacity_texture, 3);
+			GLuint current_fill_gbuffer_shader = 0u;
 			for (std::size_t i = 0; i < sponza_geometry.size(); ++i)
 			{
 				auto const& geometry = sponza_geometry[i];
 				auto const& texture_data = sponza_geometry_texture_data[i];
 
+				auto const fill_gbuffer_shader = program_manager.GetProgramVariant(fill_gbuffer_variants, get_fill_gbuffer_variant_mask(texture_data, use_depth_prepass));
+				if (fill_gbuffer_shader == 0u)
+					continue;
+				if (fill_gbuffer_shader != current_fill_gbuffer_shader) {
+					glUseProgram(fill_gbuffer_shader);
+					glUniform1i(program_manager.GetUniformLocation(fill_gbuffer_shader, "use_compact_gbuffer"), gbuffer_layout == GBufferLayout::Compact ? 1 : 0);
+					glUniform1i(program_manager.GetUniformLocation(fill_gbuffer_shader, "diffuse_texture"), 0);
+					glUniform1i(program_manager.GetUniformLocation(fill_gbuffer_shader, "specular_texture"), 1);
+					glUniform1i(program_manager.GetUniformLocation(fill_gbuffer_shader, "normals_texture"), 2);
+					glUniform1i(program_manager.GetUniformLocation(fill_gbuffer_shader, "opacity_texture"), 3);
+					current_fill_gbuffer_shader = fill_gbuffer_shader;
+				}
+
 				utils::opengl::debug::beginDebugGroup(geometry.name);
 
 				auto const vertex_model_to_world = glm::mat4(1.0f);
 				auto const normal_model_to_world = glm::mat4(1.0f);
 
-				glUniformMatrix4fv(fill_gbuffer_shader_locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(vertex_model_to_world));
-				glUniformMatrix4fv(fill_gbuffer_shader_locations.normal_model_to_world, 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
+				glUniformMatrix4fv(program_manager.GetUniformLocation(fill_gbuffer_shader, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(vertex_model_to_world));
+				glUniformMatrix4fv(program_manager.GetUniformLocation(fill_gbuffer_shader, "normal_model_to_world"), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
 
 				auto const default_sampler = samplers[toU(Sampler::Nearest)];
 				auto const mipmap_sampler = samplers[toU(Sampler::Mipmaps)];
 
-				glUniform1i(fill_gbuffer_shader_locations.has_diffuse_texture, texture_data.diffuse_texture_id != 0u ? 1 : 0);
 				glBindSampler(0u, texture_data.diffuse_texture_id != 0u ? mipmap_sampler : default_sampler);
 				glActiveTexture(GL_TEXTURE0);
 				glBindTexture(GL_TEXTURE_2D, texture_data.diffuse_texture_id != 0u ? texture_data.diffuse_texture_id : debug_texture_id);
 
-				glUniform1i(fill_gbuffer_shader_locations.has_specular_texture, texture_data.specular_texture_id != 0u ? 1 : 0);
 				glBindSampler(1u, texture_data.specular_texture_id != 0u ? mipmap_sampler : default_sampler);
 				glActiveTexture(GL_TEXTURE1);
 				glBindTexture(GL_TEXTURE_2D, texture_data.specular_texture_id != 0u ? texture_data.specular_texture_id : debug_texture_id);
 
-				glUniform1i(fill_gbuffer_shader_locations.has_normals_texture, texture_data.normals_texture_id != 0u ? 1 : 0);
 				glBindSampler(2u, texture_data.normals_texture_id != 0u ? mipmap_sampler : default_sampler);
 				glActiveTexture(GL_TEXTURE2);
 				glBindTexture(GL_TEXTURE_2D, texture_data.normals_texture_id != 0u ? texture_data.normals_texture_id : debug_texture_id);
 
-				glUniform1i(fill_gbuffer_shader_locations.has_opacity_texture, texture_data.opacity_texture_id != 0u ? 1 : 0);
 				glBindSampler(3u, texture_data.opacity_texture_id != 0u ? mipmap_sampler : default_sampler);
 				glActiveTexture(GL_TEXTURE3);
 				glBindTexture(GL_TEXTURE_2D, texture_data.opacity_texture_id != 0u ? texture_data.opacity_texture_id : debug_texture_id);
 
+				// Textures which go unused are the first to shrink when over the
+				// memory budget.
+				for (auto const texture : { texture_data.diffuse_texture_id, texture_data.specular_texture_id,
+				                            texture_data.normals_texture_id, texture_data.opacity_texture_id })
+					resource_registry.MarkUsed(ResourceType::texture, texture);
+
 				glBindVertexArray(geometry.vao);
 				if (geometry.ibo != 0u)
 					glDrawElements(geometry.drawing_mode, geometry.indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
@@ -518,111 +1305,256 @@ edan35::Assignment2::run()
 			glBindTexture(GL_TEXTURE_2D, 0);
 			glBindVertexArray(0u);
 			glUseProgram(0u);
-
-			glEndQuery(GL_TIME_ELAPSED);
-			utils::opengl::debug::endDebugGroup();
+		});
 
 
+		//
+		// Pass 2.1: Generate the shadow maps of all lights, each one
+		// into its own region of the shadow atlas; in clustered mode,
+		// the shadowed spot lights are skipped.
+		//
+		frame_graph.AddPass("Shadow atlas", [&](RenderGraph::PassBuilder& builder) {
+			shadow_atlas_target = builder.Write(shadow_atlas_target);
+		}, [&](RenderGraph::PassContext const&) {
+			std::array<bool, constant::lights_nb> is_cache_up_to_date;
+			for (size_t i = 0; i < shadowed_lights_nb; ++i) {
+				auto const& region = shadow_atlas.get_region(i);
+				auto const& cached_shadowmap = cached_shadowmaps[i];
+				is_cache_up_to_date[i] = use_shadowmap_caching
+				                      && cached_shadowmap.is_valid
+				                      && cached_shadowmap.world_to_clip == light_view_proj_transforms[i].view_projection
+				                      && cached_shadowmap.region.offset == region.offset
+				                      && cached_shadowmap.region.size == region.size;
+			}
+			auto const update_cache = [&](size_t i) {
+				cached_shadowmaps[i].world_to_clip = light_view_proj_transforms[i].view_projection;
+				cached_shadowmaps[i].region = shadow_atlas.get_region(i);
+				cached_shadowmaps[i].is_valid = true;
+				is_cache_up_to_date[i] = true;
+				++rerendered_shadowmaps_nb;
+			};
 
 			//
-			// Pass 2: Generate shadowmaps and accumulate lights' contribution
+			// Pass 2.1.1 (layered): Render the static geometry of all
+			// outdated lights into the cache at once
 			//
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
-			glViewport(0, 0, framebuffer_width, framebuffer_height);
-			// XXX: Is any clearing needed?
-			for (size_t i = 0; i < static_cast<size_t>(lights_nb); ++i) {
-				auto const& lightTransform = lightTransforms[i];
-				auto const light_view_matrix = lightOffsetTransform.GetMatrixInverse() * lightTransform.GetMatrixInverse();
-				auto const light_world_matrix = glm::inverse(light_view_matrix) * coneScaleTransform.GetMatrix();
-				auto const light_world_to_clip_matrix = lightProjection * light_view_matrix;
+			if (use_layered_shadowmaps) {
+				utils::opengl::debug::beginDebugGroup("Create shadow maps (layered)");
+				gpu_timer.BeginScope("Layered shadow maps");
+
+				std::array<GLint, constant::lights_nb> layered_light_indices;
+				GLint layered_lights_nb = 0;
+				for (size_t i = 0; i < shadowed_lights_nb; ++i) {
+					auto const& region = shadow_atlas.get_region(i);
+					if (region.size == 0u || is_cache_up_to_date[i])
+						continue;
+
+					glViewportIndexedf(static_cast<GLuint>(layered_lights_nb),
+					                   static_cast<float>(region.offset.x), static_cast<float>(region.offset.y),
+					                   static_cast<float>(region.size), static_cast<float>(region.size));
+					glScissorIndexed(static_cast<GLuint>(layered_lights_nb),
+					                 static_cast<GLint>(region.offset.x), static_cast<GLint>(region.offset.y),
+					                 static_cast<GLsizei>(region.size), static_cast<GLsizei>(region.size));
+					layered_light_indices[layered_lights_nb++] = static_cast<GLint>(i);
+				}
 
-				//
-				// Pass 2.1: Generate shadow map for light i
-				//
-				utils::opengl::debug::beginDebugGroup("Create shadow map " + std::to_string(i));
-				glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::ShadowMap0Generation) + i]);
+				if (layered_lights_nb > 0) {
+					glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::ShadowAtlasStaticCache)]);
+					glEnable(GL_SCISSOR_TEST);
+					// XXX: Is any clearing needed? Clears only use the first
+					// scissor rectangle, so each region has to be handled on
+					// its own.
 
-				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)]);
-				glViewport(0, 0, constant::shadowmap_res_x, constant::shadowmap_res_y);
-				// XXX: Is any clearing needed?
+					glUseProgram(fill_shadowmap_layered_shader);
+					glUniform1i(program_manager.GetUniformLocation(fill_shadowmap_layered_shader, "lights_nb"), layered_lights_nb);
+					glUniform1iv(program_manager.GetUniformLocation(fill_shadowmap_layered_shader, "light_indices"), layered_lights_nb, layered_light_indices.data());
+					draw_shadow_casters(fill_shadowmap_layered_shader);
+					glUseProgram(0u);
 
-				glUseProgram(fill_shadowmap_shader);
-				glUniform1i(fill_shadowmap_shader_locations.light_index, static_cast<int>(i));
-				glUniform1i(fill_shadowmap_shader_locations.opacity_texture, 0);
-				for (std::size_t i = 0; i < sponza_geometry.size(); ++i)
-				{
-					auto const& geometry = sponza_geometry[i];
-					auto const& texture_data = sponza_geometry_texture_data[i];
+					glDisable(GL_SCISSOR_TEST);
 
-					utils::opengl::debug::beginDebugGroup(geometry.name);
+					for (GLint k = 0; k < layered_lights_nb; ++k)
+						update_cache(static_cast<size_t>(layered_light_indices[k]));
+				}
 
-					auto const vertex_model_to_world = glm::mat4(1.0f);
-					glUniformMatrix4fv(fill_shadowmap_shader_locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(vertex_model_to_world));
+				gpu_timer.EndScope();
+				utils::opengl::debug::endDebugGroup();
+			}
 
-					glUniform1i(fill_shadowmap_shader_locations.has_opacity_texture, texture_data.opacity_texture_id != 0u ? 1 : 0);
-					glBindSampler(0u, texture_data.opacity_texture_id != 0u ? samplers[toU(Sampler::Mipmaps)] : samplers[toU(Sampler::Nearest)]);
-					glActiveTexture(GL_TEXTURE0);
-					glBindTexture(GL_TEXTURE_2D, texture_data.opacity_texture_id != 0u ? texture_data.opacity_texture_id : debug_texture_id);
+			for (size_t i = 0; i < shadowed_lights_nb; ++i) {
+				auto const& region = shadow_atlas.get_region(i);
+				if (region.size == 0u)
+					continue;
 
-					glBindVertexArray(geometry.vao);
-					if (geometry.ibo != 0u)
-						glDrawElements(geometry.drawing_mode, geometry.indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
-					else
-						glDrawArrays(geometry.drawing_mode, 0, geometry.vertices_nb);
+				utils::opengl::debug::beginDebugGroup("Create shadow map " + std::to_string(i));
+				gpu_timer.BeginScope("Shadow map " + std::to_string(i));
+
+				//
+				// Pass 2.1.1: Render the static geometry into the cache,
+				// unless it is still up to date
+				//
+				if (!is_cache_up_to_date[i]) {
+					glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::ShadowAtlasStaticCache)]);
+					glViewport(static_cast<GLint>(region.offset.x), static_cast<GLint>(region.offset.y),
+					           static_cast<GLsizei>(region.size), static_cast<GLsizei>(region.size));
+					// Only this light's region of the cache should be
+					// modified, including by clears.
+					glEnable(GL_SCISSOR_TEST);
+					glScissor(static_cast<GLint>(region.offset.x), static_cast<GLint>(region.offset.y),
+					          static_cast<GLsizei>(region.size), static_cast<GLsizei>(region.size));
+					// XXX: Is any clearing needed?
+
+					glUseProgram(fill_shadowmap_shader);
+					glUniform1i(program_manager.GetUniformLocation(fill_shadowmap_shader, "light_index"), static_cast<int>(i));
+					draw_shadow_casters(fill_shadowmap_shader);
+					glUseProgram(0u);
+
+					glDisable(GL_SCISSOR_TEST);
+
+					update_cache(i);
+				}
 
+				//
+				// Pass 2.1.2: Copy the static depth over to the atlas, and
+				// draw the dynamic shadow casters on top of it; Sponza being
+				// the only object of the scene, there currently are none.
+				//
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[toU(FBO::ShadowAtlasStaticCache)]);
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::ShadowAtlas)]);
+				auto const region_min = glm::ivec2(region.offset);
+				auto const region_max = region_min + glm::ivec2(static_cast<int>(region.size));
+				glBlitFramebuffer(region_min.x, region_min.y, region_max.x, region_max.y,
+				                  region_min.x, region_min.y, region_max.x, region_max.y,
+				                  GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, 0u);
+
+				gpu_timer.EndScope();
+				utils::opengl::debug::endDebugGroup();
+			}
+		});
 
+		//
+		// Pass 2.1 (sun): Generate one shadow map per cascade
+		//
+		if (is_sun_enabled) {
+			frame_graph.AddPass("Sun shadow cascades", [&](RenderGraph::PassBuilder& builder) {
+				sun_shadow_cascades_target = builder.Write(sun_shadow_cascades_target);
+			}, [&](RenderGraph::PassContext const&) {
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::SunShadowCascades)]);
+				glViewport(0, 0, constant::sun_shadowmap_res, constant::sun_shadowmap_res);
+				// Casters in front of the near plane of a cascade get
+				// flattened onto it rather than clipped away.
+				glEnable(GL_DEPTH_CLAMP);
+				glEnable(GL_POLYGON_OFFSET_FILL);
+				glPolygonOffset(2.0f, 4.0f);
+
+				glUseProgram(fill_shadowmap_cascade_shader);
+				for (size_t i = 0; i < constant::sun_cascades_nb; ++i) {
+					utils::opengl::debug::beginDebugGroup("Create sun cascade " + std::to_string(i));
+					gpu_timer.BeginScope("Sun cascade " + std::to_string(i));
+
+					glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[toU(Texture::SunShadowCascades)], 0, static_cast<GLint>(i));
+					glClear(GL_DEPTH_BUFFER_BIT);
+
+					glUniformMatrix4fv(program_manager.GetUniformLocation(fill_shadowmap_cascade_shader, "vertex_world_to_clip"), 1, GL_FALSE,
+					                   glm::value_ptr(sun_cascade_world_to_clip_matrices[i]));
+					draw_shadow_casters(fill_shadowmap_cascade_shader);
+
+					gpu_timer.EndScope();
 					utils::opengl::debug::endDebugGroup();
 				}
-				glBindTexture(GL_TEXTURE_2D, 0);
-				glBindVertexArray(0u);
 				glUseProgram(0u);
 
-				glEndQuery(GL_TIME_ELAPSED);
-				utils::opengl::debug::endDebugGroup();
+				glDisable(GL_POLYGON_OFFSET_FILL);
+				glDisable(GL_DEPTH_CLAMP);
+			});
+		}
 
 
-				glCullFace(GL_FRONT);
-				glEnable(GL_BLEND);
-				glDepthFunc(GL_GREATER);
-				glDepthMask(GL_FALSE);
-				glBlendEquationSeparate(GL_FUNC_ADD, GL_MIN);
-				glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
-				//
-				// Pass 2.2: Accumulate light i contribution
-				utils::opengl::debug::beginDebugGroup("Accumulate light " + std::to_string(i));
-				glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::Light0Accumulation) + i]);
+		//
+		// Pass 2.2: Accumulate the contribution of all lights
+		//
+		// XXX: Is any clearing needed?
+		if (use_clustered_lighting) {
+			//
+			// Pass 2.2 (clustered): Shade every pixel against its
+			// cluster's lights in a single full-screen pass
+			//
+			frame_graph.AddPass("Clustered lights accumulation", [&](RenderGraph::PassBuilder& builder) {
+				builder.Read(targets.depth);
+				builder.Read(targets.gbuffer_normals);
+				targets.light_diffuse = builder.WriteColour(0u, targets.light_diffuse);
+				targets.light_specular = builder.WriteColour(1u, targets.light_specular);
+
+				// Every pixel is written, so neither clearing nor depth
+				// testing is needed.
+				RenderPassState state;
+				state.depth_test = false;
+				state.depth_write = false;
+				builder.SetState(state);
+			}, [&](RenderGraph::PassContext const& context) {
+				glUseProgram(accumulate_lights_clustered_shader);
+				glUniform1i(program_manager.GetUniformLocation(accumulate_lights_clustered_shader, "use_compact_gbuffer"), gbuffer_layout == GBufferLayout::Compact ? 1 : 0);
+				glUniform3fv(program_manager.GetUniformLocation(accumulate_lights_clustered_shader, "camera_position"), 1, glm::value_ptr(mCamera.mWorld.GetTranslation()));
+				glUniform2f(program_manager.GetUniformLocation(accumulate_lights_clustered_shader, "inverse_screen_resolution"),
+				            1.0f / static_cast<float>(framebuffer_width),
+				            1.0f / static_cast<float>(framebuffer_height));
+				glUniform1f(program_manager.GetUniformLocation(accumulate_lights_clustered_shader, "shininess"), 64.0f);
+
+				bind_texture_with_sampler(GL_TEXTURE_2D, 0, accumulate_lights_clustered_shader, "depth_texture", context.GetTexture(targets.depth), samplers[toU(Sampler::Nearest)]);
+				bind_texture_with_sampler(GL_TEXTURE_2D, 1, accumulate_lights_clustered_shader, "normal_texture", context.GetTexture(targets.gbuffer_normals), samplers[toU(Sampler::Nearest)]);
+				light_clusters.bind(program_manager, accumulate_lights_clustered_shader, 2u);
+
+				bonobo::drawFullscreen();
+
+				glBindSampler(1, 0u);
+				glBindSampler(0, 0u);
+				glUseProgram(0u);
+			});
+		}
+
+		// Light volumes are drawn with their back faces, and only affect
+		// the pixels in front of those.
+		RenderPassState light_accumulation_state;
+		light_accumulation_state.cull_face_mode = GL_FRONT;
+		light_accumulation_state.depth_func = GL_GREATER;
+		light_accumulation_state.depth_write = false;
+		light_accumulation_state.blend = true;
+		light_accumulation_state.blend_equation_alpha = GL_MIN;
+		light_accumulation_state.blend_dst_rgb = GL_ONE;
+		light_accumulation_state.blend_dst_alpha = GL_ONE;
+		for (size_t i = 0; i < shadowed_lights_nb; ++i) {
+			frame_graph.AddPass("Light " + std::to_string(i) + " accumulation", [&](RenderGraph::PassBuilder& builder) {
+				builder.ReadDepth(targets.depth);
+				builder.Read(targets.gbuffer_normals);
+				builder.Read(shadow_atlas_target);
+				targets.light_diffuse = builder.WriteColour(0u, targets.light_diffuse);
+				targets.light_specular = builder.WriteColour(1u, targets.light_specular);
+				builder.SetState(light_accumulation_state);
+			}, [&, i](RenderGraph::PassContext const& context) {
+				auto const& lightTransform = lightTransforms[i];
+				auto const light_view_matrix = lightOffsetTransform.GetMatrixInverse() * lightTransform.GetMatrixInverse();
+				auto const light_world_matrix = glm::inverse(light_view_matrix) * coneScaleTransform.GetMatrix();
 
-				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
 				glUseProgram(accumulate_lights_shader);
-				glViewport(0, 0, framebuffer_width, framebuffer_height);
-				// XXX: Is any clearing needed?
+				glUniform1i(program_manager.GetUniformLocation(accumulate_lights_shader, "use_compact_gbuffer"), gbuffer_layout == GBufferLayout::Compact ? 1 : 0);
 
-				glUniform1i(accumulate_light_shader_locations.light_index, static_cast<int>(i));
-				glUniformMatrix4fv(accumulate_light_shader_locations.vertex_model_to_world, 1, GL_FALSE, glm::value_ptr(light_world_matrix));
-				glUniform3fv(accumulate_light_shader_locations.camera_position, 1, glm::value_ptr(mCamera.mWorld.GetTranslation()));
-				glUniform2f(accumulate_light_shader_locations.inverse_screen_resolution,
+				glUniform1i(program_manager.GetUniformLocation(accumulate_lights_shader, "light_index"), static_cast<int>(i));
+				glUniformMatrix4fv(program_manager.GetUniformLocation(accumulate_lights_shader, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(light_world_matrix));
+				glUniform3fv(program_manager.GetUniformLocation(accumulate_lights_shader, "camera_position"), 1, glm::value_ptr(mCamera.mWorld.GetTranslation()));
+				glUniform2f(program_manager.GetUniformLocation(accumulate_lights_shader, "inverse_screen_resolution"),
 				            1.0f / static_cast<float>(framebuffer_width),
 				            1.0f / static_cast<float>(framebuffer_height));
-				glUniform3fv(accumulate_light_shader_locations.light_color, 1, glm::value_ptr(lightColors[i]));
-				glUniform3fv(accumulate_light_shader_locations.light_position, 1, glm::value_ptr(lightTransform.GetTranslation()));
-				glUniform3fv(accumulate_light_shader_locations.light_direction, 1, glm::value_ptr(lightTransform.GetFront()));
-				glUniform1f(accumulate_light_shader_locations.light_intensity, constant::light_intensity);
-				glUniform1f(accumulate_light_shader_locations.light_angle_falloff, constant::light_angle_falloff);
-
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)]);
-				glUniform1i(accumulate_light_shader_locations.depth_texture, 0);
-				glBindSampler(0, samplers[toU(Sampler::Linear)]);
+				glUniform3fv(program_manager.GetUniformLocation(accumulate_lights_shader, "light_color"), 1, glm::value_ptr(lightColors[i]));
+				glUniform3fv(program_manager.GetUniformLocation(accumulate_lights_shader, "light_position"), 1, glm::value_ptr(lightTransform.GetTranslation()));
+				glUniform3fv(program_manager.GetUniformLocation(accumulate_lights_shader, "light_direction"), 1, glm::value_ptr(lightTransform.GetFront()));
+				glUniform1f(program_manager.GetUniformLocation(accumulate_lights_shader, "light_intensity"), constant::light_intensity);
+				glUniform1f(program_manager.GetUniformLocation(accumulate_lights_shader, "light_angle_falloff"), constant::light_angle_falloff);
+				glUniform4fv(program_manager.GetUniformLocation(accumulate_lights_shader, "shadow_atlas_region"), 1, glm::value_ptr(shadow_atlas.get_region_uv(i)));
 
-				glActiveTexture(GL_TEXTURE1);
-				glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferWorldSpaceNormal)]);
-				glUniform1i(accumulate_light_shader_locations.normal_texture, 1);
-				glBindSampler(1, samplers[toU(Sampler::Linear)]);
-
-				glActiveTexture(GL_TEXTURE2);
-				glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::ShadowMap)]);
-				glUniform1i(accumulate_light_shader_locations.shadow_texture, 2);
-				glBindSampler(2, samplers[toU(Sampler::Linear)]);
+				bind_texture_with_sampler(GL_TEXTURE_2D, 0, accumulate_lights_shader, "depth_texture", context.GetTexture(targets.depth), samplers[toU(Sampler::Linear)]);
+				bind_texture_with_sampler(GL_TEXTURE_2D, 1, accumulate_lights_shader, "normal_texture", context.GetTexture(targets.gbuffer_normals), samplers[toU(Sampler::Linear)]);
+				bind_texture_with_sampler(GL_TEXTURE_2D, 2, accumulate_lights_shader, "shadow_texture", context.GetTexture(shadow_atlas_target), samplers[toU(Sampler::Linear)]);
 
 				glBindVertexArray(cone_geometry.vao);
 				glDrawArrays(cone_geometry.drawing_mode, 0, cone_geometry.vertices_nb);
@@ -632,32 +1564,83 @@ edan35::Assignment2::run()
 				glBindSampler(2u, 0u);
 				glBindSampler(1u, 0u);
 				glBindSampler(0u, 0u);
+			});
+		}
 
-				glEndQuery(GL_TIME_ELAPSED);
-				utils::opengl::debug::endDebugGroup();
-
-				glDepthMask(GL_TRUE);
-				glDepthFunc(GL_LESS);
-				glDisable(GL_BLEND);
-				glCullFace(GL_BACK);
-			}
-
+		//
+		// Pass 2.2 (sun): Accumulate the sun contribution over the whole
+		// screen, blending between cascades
+		//
+		if (is_sun_enabled) {
+			frame_graph.AddPass("Sun accumulation", [&](RenderGraph::PassBuilder& builder) {
+				builder.Read(targets.depth);
+				builder.Read(targets.gbuffer_normals);
+				builder.Read(sun_shadow_cascades_target);
+				targets.light_diffuse = builder.WriteColour(0u, targets.light_diffuse);
+				targets.light_specular = builder.WriteColour(1u, targets.light_specular);
+
+				RenderPassState state;
+				state.depth_test = false;
+				state.depth_write = false;
+				state.blend = true;
+				state.blend_equation_alpha = GL_MIN;
+				state.blend_dst_rgb = GL_ONE;
+				state.blend_dst_alpha = GL_ONE;
+				builder.SetState(state);
+			}, [&](RenderGraph::PassContext const& context) {
+				glUseProgram(accumulate_sun_shader);
+				glUniform1i(program_manager.GetUniformLocation(accumulate_sun_shader, "use_compact_gbuffer"), gbuffer_layout == GBufferLayout::Compact ? 1 : 0);
+				glUniform3fv(program_manager.GetUniformLocation(accumulate_sun_shader, "camera_position"), 1, glm::value_ptr(mCamera.mWorld.GetTranslation()));
+				glUniform2f(program_manager.GetUniformLocation(accumulate_sun_shader, "camera_depth_range"), mCamera.mNear, mCamera.mFar);
+				glUniform2f(program_manager.GetUniformLocation(accumulate_sun_shader, "inverse_screen_resolution"),
+				            1.0f / static_cast<float>(framebuffer_width),
+				            1.0f / static_cast<float>(framebuffer_height));
+				glUniform3fv(program_manager.GetUniformLocation(accumulate_sun_shader, "sun_direction"), 1, glm::value_ptr(sun_direction));
+				glUniform3fv(program_manager.GetUniformLocation(accumulate_sun_shader, "sun_color"), 1, glm::value_ptr(sun_color));
+				glUniform1f(program_manager.GetUniformLocation(accumulate_sun_shader, "sun_intensity"), sun_intensity);
+				glUniform1f(program_manager.GetUniformLocation(accumulate_sun_shader, "shininess"), 64.0f);
+				glUniformMatrix4fv(program_manager.GetUniformLocation(accumulate_sun_shader, "sun_cascade_world_to_clip"),
+				                   static_cast<GLsizei>(constant::sun_cascades_nb), GL_FALSE,
+				                   glm::value_ptr(sun_cascade_world_to_clip_matrices[0]));
+				glUniform4fv(program_manager.GetUniformLocation(accumulate_sun_shader, "sun_cascade_far_distances"), 1, glm::value_ptr(sun_cascade_far_distances));
+				glUniform1f(program_manager.GetUniformLocation(accumulate_sun_shader, "sun_cascade_blend_ratio"), constant::sun_cascade_blend_ratio);
+
+				bind_texture_with_sampler(GL_TEXTURE_2D, 0, accumulate_sun_shader, "depth_texture", context.GetTexture(targets.depth), samplers[toU(Sampler::Nearest)]);
+				bind_texture_with_sampler(GL_TEXTURE_2D, 1, accumulate_sun_shader, "normal_texture", context.GetTexture(targets.gbuffer_normals), samplers[toU(Sampler::Nearest)]);
+				bind_texture_with_sampler(GL_TEXTURE_2D_ARRAY, 2, accumulate_sun_shader, "sun_shadow_cascades", context.GetTexture(sun_shadow_cascades_target), samplers[toU(Sampler::ShadowComparison)]);
+
+				bonobo::drawFullscreen();
+
+				glBindSampler(2, 0u);
+				glBindSampler(1, 0u);
+				glBindSampler(0, 0u);
+				glUseProgram(0u);
+			});
+		}
 
-			//
-			// Pass 3: Compute final image using both the g-buffer and  the light accumulation buffer
-			//
-			utils::opengl::debug::beginDebugGroup("Resolve");
-			glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::Resolve)]);
 
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
+		//
+		// Pass 3: Compute final image using both the g-buffer and  the light accumulation buffer
+		//
+		// The normals are not needed anymore, unless displayed for
+		// debugging, so the result can usually reuse their texture.
+		//
+		frame_graph.AddPass("Resolve", [&](RenderGraph::PassBuilder& builder) {
+			builder.Read(targets.gbuffer_diffuse);
+			if (targets.gbuffer_specular.IsValid())
+				builder.Read(targets.gbuffer_specular);
+			builder.Read(targets.light_diffuse);
+			builder.Read(targets.light_specular);
+			targets.result = builder.WriteColour(0u, targets.result);
+		}, [&](RenderGraph::PassContext const& context) {
 			glUseProgram(resolve_deferred_shader);
-			glViewport(0, 0, framebuffer_width, framebuffer_height);
+			glUniform1i(program_manager.GetUniformLocation(resolve_deferred_shader, "use_compact_gbuffer"), gbuffer_layout == GBufferLayout::Compact ? 1 : 0);
 			// XXX: Is any clearing needed?
 
-			bind_texture_with_sampler(GL_TEXTURE_2D, 0, resolve_deferred_shader, "diffuse_texture", textures[toU(Texture::GBufferDiffuse)], samplers[toU(Sampler::Nearest)]);
-			bind_texture_with_sampler(GL_TEXTURE_2D, 1, resolve_deferred_shader, "specular_texture", textures[toU(Texture::GBufferSpecular)], samplers[toU(Sampler::Nearest)]);
-			bind_texture_with_sampler(GL_TEXTURE_2D, 2, resolve_deferred_shader, "light_d_texture", textures[toU(Texture::LightDiffuseContribution)], samplers[toU(Sampler::Nearest)]);
-			bind_texture_with_sampler(GL_TEXTURE_2D, 3, resolve_deferred_shader, "light_s_texture", textures[toU(Texture::LightSpecularContribution)], samplers[toU(Sampler::Nearest)]);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 0, resolve_deferred_shader, "diffuse_texture", context.GetTexture(targets.gbuffer_diffuse), samplers[toU(Sampler::Nearest)]);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 1, resolve_deferred_shader, "specular_texture", targets.gbuffer_specular.IsValid() ? context.GetTexture(targets.gbuffer_specular) : 0u, samplers[toU(Sampler::Nearest)]);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 2, resolve_deferred_shader, "light_d_texture", context.GetTexture(targets.light_diffuse), samplers[toU(Sampler::Nearest)]);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 3, resolve_deferred_shader, "light_s_texture", context.GetTexture(targets.light_specular), samplers[toU(Sampler::Nearest)]);
 
 			bonobo::drawFullscreen();
 
@@ -666,197 +1649,163 @@ edan35::Assignment2::run()
 			glBindSampler(1, 0u);
 			glBindSampler(0, 0u);
 			glUseProgram(0u);
-
-			glEndQuery(GL_TIME_ELAPSED);
-			utils::opengl::debug::endDebugGroup();
-		}
-
-
-		auto const show_debug_elements = show_cone_wireframe || show_basis;
-		if (show_debug_elements) {
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::FinalWithDepth)]);
-		}
+		});
 
 
 		//
-		// Draw wireframe cones on top of the final image for debugging purposes
+		// Draw wireframe cones and the basis on top of the final image
+		// for debugging purposes
 		//
-		glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::ConeWireframe)]);
-		if (show_cone_wireframe) {
-			utils::opengl::debug::beginDebugGroup("Draw cone wireframe");
-
-			glDisable(GL_CULL_FACE);
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-			for (size_t i = 0; i < lights_nb; ++i) {
-				cone.render(view_projection,
-				            lightTransforms[i].GetMatrix() * lightOffsetTransform.GetMatrix() * coneScaleTransform.GetMatrix(),
-				            render_light_cones_shader, set_uniforms);
-			}
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-			glEnable(GL_CULL_FACE);
-			utils::opengl::debug::endDebugGroup();
-		}
-		glEndQuery(GL_TIME_ELAPSED);
-
+		if (show_cone_wireframe || show_basis) {
+			frame_graph.AddPass("Debug geometry", [&](RenderGraph::PassBuilder& builder) {
+				builder.ReadDepth(targets.depth);
+				targets.result = builder.WriteColour(0u, targets.result);
+			}, [&](RenderGraph::PassContext const&) {
+				if (show_cone_wireframe) {
+					glDisable(GL_CULL_FACE);
+					glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+					for (size_t i = 0; i < lights_nb; ++i) {
+						cone.render(view_projection,
+						            lightTransforms[i].GetMatrix() * lightOffsetTransform.GetMatrix() * coneScaleTransform.GetMatrix(),
+						            render_light_cones_shader, set_uniforms);
+					}
+					glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+					glEnable(GL_CULL_FACE);
+				}
 
-		utils::opengl::debug::beginDebugGroup("Draw GUI");
-		glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::GUI)]);
+				if (show_basis) {
+					bonobo::renderBasis(basis_thickness_scale, basis_length_scale, mCamera.GetWorldToClipMatrix());
+				}
+			});
+		}
 
 		//
-		// Display 3D helpers
+		// Output content of the g-buffer as well as of the shadowmap, for
+		// debugging purposes. The pass is always declared, but its output
+		// only gets used when the textures are shown; otherwise it gets
+		// culled, along with the shadow atlas in clustered mode.
 		//
-		if (show_basis) {
-			bonobo::renderBasis(basis_thickness_scale, basis_length_scale, mCamera.GetWorldToClipMatrix());
-		}
+		auto result_with_textures = targets.result;
+		frame_graph.AddPass("Texture views", [&](RenderGraph::PassBuilder& builder) {
+			builder.Read(targets.depth);
+			builder.Read(targets.gbuffer_diffuse);
+			if (targets.gbuffer_specular.IsValid())
+				builder.Read(targets.gbuffer_specular);
+			builder.Read(targets.gbuffer_normals);
+			builder.Read(targets.light_diffuse);
+			builder.Read(targets.light_specular);
+			builder.Read(shadow_atlas_target);
+			result_with_textures = builder.WriteColour(0u, targets.result);
+		}, [&](RenderGraph::PassContext const& context) {
+			auto const screen_size = glm::uvec2(framebuffer_width, framebuffer_height);
+			bonobo::displayTexture({-0.95f, -0.95f}, {-0.55f, -0.55f}, context.GetTexture(targets.gbuffer_diffuse),            samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, screen_size);
+			if (gbuffer_layout == GBufferLayout::Compact)
+				bonobo::displayTexture({-0.45f, -0.95f}, {-0.05f, -0.55f}, context.GetTexture(targets.gbuffer_diffuse),    samplers[toU(Sampler::Linear)], {3, 3, 3, -1}, screen_size);
+			else
+				bonobo::displayTexture({-0.45f, -0.95f}, {-0.05f, -0.55f}, context.GetTexture(targets.gbuffer_specular),   samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, screen_size);
+			bonobo::displayTexture({ 0.05f, -0.95f}, { 0.45f, -0.55f}, context.GetTexture(targets.gbuffer_normals),            samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, screen_size);
+			bonobo::displayTexture({ 0.55f, -0.95f}, { 0.95f, -0.55f}, context.GetTexture(targets.depth),                      samplers[toU(Sampler::Linear)], {0, 0, 0, -1}, screen_size, true, mCamera.mNear, mCamera.mFar);
+			bonobo::displayTexture({-0.95f,  0.55f}, {-0.55f,  0.95f}, context.GetTexture(shadow_atlas_target),                samplers[toU(Sampler::Linear)], {0, 0, 0, -1}, screen_size, true, lightProjectionNearPlane, lightProjectionFarPlane);
+			bonobo::displayTexture({-0.45f,  0.55f}, {-0.05f,  0.95f}, context.GetTexture(targets.light_diffuse),              samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, screen_size);
+			bonobo::displayTexture({ 0.05f,  0.55f}, { 0.45f,  0.95f}, context.GetTexture(targets.light_specular),             samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, screen_size);
 
-		// If the basis and cone wireframe were not shown, FBO::Resolve
-		// is still bound so there is no need to rebind it.
-		if (show_debug_elements) {
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
-		}
+			//
+			// Reset viewport back to normal
+			//
+			glViewport(0, 0, framebuffer_width, framebuffer_height);
+		});
+		if (show_textures)
+			targets.result = result_with_textures;
 
-		//
-		// Output content of the g-buffer as well as of the shadowmap, for debugging purposes
-		//
-		if (show_textures) {
-			bonobo::displayTexture({-0.95f, -0.95f}, {-0.55f, -0.55f}, textures[toU(Texture::GBufferDiffuse)],            samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
-			bonobo::displayTexture({-0.45f, -0.95f}, {-0.05f, -0.55f}, textures[toU(Texture::GBufferSpecular)],           samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
-			bonobo::displayTexture({ 0.05f, -0.95f}, { 0.45f, -0.55f}, textures[toU(Texture::GBufferWorldSpaceNormal)],   samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
-			bonobo::displayTexture({ 0.55f, -0.95f}, { 0.95f, -0.55f}, textures[toU(Texture::DepthBuffer)],               samplers[toU(Sampler::Linear)], {0, 0, 0, -1}, glm::uvec2(framebuffer_width, framebuffer_height), true, mCamera.mNear, mCamera.mFar);
-			bonobo::displayTexture({-0.95f,  0.55f}, {-0.55f,  0.95f}, textures[toU(Texture::ShadowMap)],                 samplers[toU(Sampler::Linear)], {0, 0, 0, -1}, glm::uvec2(framebuffer_width, framebuffer_height), true, lightProjectionNearPlane, lightProjectionFarPlane);
-			bonobo::displayTexture({-0.45f,  0.55f}, {-0.05f,  0.95f}, textures[toU(Texture::LightDiffuseContribution)],  samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
-			bonobo::displayTexture({ 0.05f,  0.55f}, { 0.45f,  0.95f}, textures[toU(Texture::LightSpecularContribution)], samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
-		}
+		frame_graph.AddPass("GUI", [&](RenderGraph::PassBuilder& builder) {
+			targets.result = builder.WriteColour(0u, targets.result);
+		}, [&](RenderGraph::PassContext const&) {
+			mWindowManager.RenderImGuiFrame(show_gui);
+		});
 
 		//
-		// Reset viewport back to normal
+		// Blit the result back to the default framebuffer.
 		//
-		glViewport(0, 0, framebuffer_width, framebuffer_height);
-
-		bool opened = ImGui::Begin("Render Time", nullptr, ImGuiWindowFlags_None);
-		if (opened) {
-			ImGui::Text("Frame CPU time: %.3f ms", std::chrono::duration<float, std::milli>(deltaTimeUs).count());
-
-			ImGui::Checkbox("Copy elapsed times back to CPU", &copy_elapsed_times);
-
-			if (ImGui::BeginTable("Pass durations", 2, ImGuiTableFlags_SizingFixedFit))
-			{
-				ImGui::TableSetupColumn("Pass");
-				ImGui::TableSetupColumn("GPU time [ms]");
-				ImGui::TableHeadersRow();
-
-				ImGui::TableNextColumn();
-				ImGui::Text("Gbuffer gen.");
-				ImGui::TableNextColumn();
-				ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::GbufferGeneration)] / 1000000.0f);
-
-				for (std::size_t i = 0; i < lights_nb; ++i) {
-					ImGui::TableNextColumn();
-					ImGui::Text("Light %zu", i);
-					ImGui::TableNextColumn();
-					ImGui::Text("");
-
-					ImGui::TableNextColumn();
-					ImGui::Text("  Shadow map");
-					ImGui::TableNextColumn();
-					ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::ShadowMap0Generation) + i] / 1000000.0f);
-
-					ImGui::TableNextColumn();
-					ImGui::Text("  Light accumulation");
-					ImGui::TableNextColumn();
-					ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::Light0Accumulation) + i] / 1000000.0f);
-				}
-
-				ImGui::TableNextColumn();
-				ImGui::Text("Resolve");
-				ImGui::TableNextColumn();
-				ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::Resolve)] / 1000000.0f);
-
-				ImGui::TableNextColumn();
-				ImGui::Text("Cone wireframe");
-				ImGui::TableNextColumn();
-				ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::ConeWireframe)] / 1000000.0f);
-
-				ImGui::TableNextColumn();
-				ImGui::Text("GUI");
-				ImGui::TableNextColumn();
-				ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::GUI)] / 1000000.0f);
-
-				ImGui::TableNextColumn();
-				ImGui::Text("Copy to framebuffer");
-				ImGui::TableNextColumn();
-				ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::CopyToFramebuffer)] / 1000000.0f);
-
-				ImGui::EndTable();
-			}
+		frame_graph.AddPass("Copy to framebuffer", [&](RenderGraph::PassBuilder& builder) {
+			builder.Read(targets.result);
+			builder.WriteDefaultFramebuffer();
+		}, [&](RenderGraph::PassContext const& context) {
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, context.GetFramebuffer({ targets.result }));
+			glBlitFramebuffer(0, 0, framebuffer_width, framebuffer_height, 0, 0, framebuffer_width, framebuffer_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, 0u);
+		});
+
+		rerendered_shadowmaps_nb = 0u;
+		if (frame_graph.Compile())
+			frame_graph.Execute(&gpu_timer);
+		if (is_render_graph_report_requested) {
+			frame_graph.LogReport();
+			is_render_graph_report_requested = false;
 		}
-		ImGui::End();
 
-		opened = ImGui::Begin("Scene Controls", nullptr, ImGuiWindowFlags_None);
-		if (opened) {
-			ImGui::Checkbox("Pause lights", &are_lights_paused);
-			ImGui::SliderInt("Number of lights", &lights_nb, 1, static_cast<int>(constant::lights_nb));
-			ImGui::Checkbox("Show textures", &show_textures);
-			ImGui::Checkbox("Show light cones wireframe", &show_cone_wireframe);
-			ImGui::Separator();
-			ImGui::Checkbox("Show basis", &show_basis);
-			ImGui::SliderFloat("Basis thickness scale", &basis_thickness_scale, 0.0f, 100.0f);
-			ImGui::SliderFloat("Basis length scale", &basis_length_scale, 0.0f, 100.0f);
+		{
+			ProfileScope("Swap buffers");
+			glfwSwapBuffers(window);
 		}
-		ImGui::End();
-
-		if (show_logs)
-			Log::View::Render();
-		mWindowManager.RenderImGuiFrame(show_gui);
-
-		glEndQuery(GL_TIME_ELAPSED);
-		utils::opengl::debug::endDebugGroup();
 
-		//
-		// Blit the result back to the default framebuffer.
-		//
-		utils::opengl::debug::beginDebugGroup("Copy to default framebuffer");
-		glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::CopyToFramebuffer)]);
-
-		// FBO::Resolve has already been bound to GL_READ_FRAMEBUFFER before rendering the first frame,
-		// as no other frame buffer gets bound to it.
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0u);
-		glBlitFramebuffer(0, 0, framebuffer_width, framebuffer_height, 0, 0, framebuffer_width, framebuffer_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		// Without caching, every requested matrix would have been built.
+		transform_matrix_requests_nb = TRSTransformf::GetMatrixRequestsCount();
+		transform_matrix_builds_nb = TRSTransformf::GetMatrixBuildsCount();
+		TRSTransformf::ResetMatrixCounters();
 
-		glEndQuery(GL_TIME_ELAPSED);
-		utils::opengl::debug::endDebugGroup();
+		gpu_timer.EndFrame();
+	}
 
-		glfwSwapBuffers(window);
+	for (auto& ubo : ubos)
+		resource_registry.Release(ResourceType::buffer, ubo);
+	for (auto& sampler : samplers)
+		resource_registry.Release(ResourceType::sampler, sampler);
+	for (auto& fbo : fbos)
+		resource_registry.Release(ResourceType::framebuffer, fbo);
+	for (auto& texture : textures)
+		resource_registry.Release(ResourceType::texture, texture);
 
-		first_frame = false;
-	}
+	resource_registry.Release(ResourceType::buffer, cone_geometry.bo);
+	resource_registry.Release(ResourceType::vertex_array, cone_geometry.vao);
+	bonobo::releaseObjects(sponza_geometry);
 
-	glDeleteBuffers(static_cast<GLsizei>(ubos.size()), ubos.data());
-	glDeleteQueries(static_cast<GLsizei>(elapsed_time_queries.size()), elapsed_time_queries.data());
-	glDeleteSamplers(static_cast<GLsizei>(samplers.size()), samplers.data());
-	glDeleteFramebuffers(static_cast<GLsizei>(fbos.size()), fbos.data());
-	glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
-
-	glDeleteProgram(resolve_deferred_shader);
-	resolve_deferred_shader = 0u;
-	glDeleteProgram(accumulate_lights_shader);
-	accumulate_lights_shader = 0u;
-	glDeleteProgram(fill_shadowmap_shader);
-	fill_shadowmap_shader = 0u;
-	glDeleteProgram(fill_gbuffer_shader);
-	fill_gbuffer_shader = 0u;
-	glDeleteProgram(fallback_shader);
-	fallback_shader = 0u;
+	// Programs are owned, and released, by the program manager.
 }
 
-int main()
+int main(int argc, char* argv[])
 {
 	std::setlocale(LC_ALL, "");
 
+	edan35::BenchmarkSettings benchmark_settings;
+	for (int i = 1; i < argc; ++i) {
+		auto const has_value = i + 1 < argc;
+		if (std::strcmp(argv[i], "--benchmark") == 0) {
+			benchmark_settings.is_enabled = true;
+		} else if (std::strcmp(argv[i], "--camera-path") == 0 && has_value) {
+			benchmark_settings.camera_path = argv[++i];
+		} else if (std::strcmp(argv[i], "--frames") == 0 && has_value) {
+			benchmark_settings.frames_nb = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--warmup") == 0 && has_value) {
+			benchmark_settings.warmup_frames_nb = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--output") == 0 && has_value) {
+			benchmark_settings.output_prefix = argv[++i];
+		} else if (std::strcmp(argv[i], "--memory-budget") == 0 && has_value) {
+			benchmark_settings.memory_budget_mib = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		} else {
+			LogError("Unknown or incomplete argument \"%s\"; usage: %s [--benchmark [--camera-path <file>] [--frames <count>] [--warmup <count>] [--output <prefix>]] [--memory-budget <MiB>]",
+			         argv[i], argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (benchmark_settings.is_enabled && benchmark_settings.frames_nb == 0u) {
+		LogError("A benchmark needs at least one frame to measure.");
+		return EXIT_FAILURE;
+	}
+
 	Bonobo framework;
 
 	try {
-		edan35::Assignment2 assignment2(framework.GetWindowManager());
+		edan35::Assignment2 assignment2(framework.GetWindowManager(), benchmark_settings);
 		assignment2.run();
 	} catch (std::runtime_error const& e) {
 		LogError(e.what());
@@ -865,66 +1814,191 @@ int main()
 
 namespace
 {
-Textures createTextures(GLsizei framebuffer_width, GLsizei framebuffer_height)
+size_t getGBufferPixelSize(GBufferLayout layout)
 {
-	Textures textures;
-	glGenTextures(static_cast<GLsizei>(textures.size()), textures.data());
+	// Depth is always stored in 4 bytes, alongside 4 bytes per colour target.
+	return 4u + (layout == GBufferLayout::Compact ? 2u * 4u : 3u * 4u);
+}
+
+Textures createTextures()
+{
+	auto& registry = bonobo::getResourceRegistry();
+
+	Textures textures = {};
+	glGenTextures(1, &textures[toU(Texture::ShadowAtlas)]);
+	glGenTextures(1, &textures[toU(Texture::ShadowAtlasStaticCache)]);
+	glGenTextures(1, &textures[toU(Texture::SunShadowCascades)]);
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, framebuffer_width, framebuffer_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::DepthBuffer)], "Depth buffer");
+	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::ShadowAtlas)]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, constant::shadow_atlas_res, constant::shadow_atlas_res, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	registry.Register(ResourceType::texture, textures[toU(Texture::ShadowAtlas)], "Shadow atlas", ResourceCategory::render_targets);
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::ShadowMap)]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, constant::shadowmap_res_x, constant::shadowmap_res_y, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::ShadowMap)], "Shadow map");
+	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::ShadowAtlasStaticCache)]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, constant::shadow_atlas_res, constant::shadow_atlas_res, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	registry.Register(ResourceType::texture, textures[toU(Texture::ShadowAtlasStaticCache)], "Shadow atlas static cache", ResourceCategory::render_targets);
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferDiffuse)]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::GBufferDiffuse)], "GBuffer diffuse");
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textures[toU(Texture::SunShadowCascades)]);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, constant::sun_shadowmap_res, constant::sun_shadowmap_res, static_cast<GLsizei>(constant::sun_cascades_nb), 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0u);
+	registry.Register(ResourceType::texture, textures[toU(Texture::SunShadowCascades)], "Sun shadow cascades", ResourceCategory::render_targets, GL_TEXTURE_2D_ARRAY);
+
+	glBindTexture(GL_TEXTURE_2D, 0u);
+	return textures;
+}
+
+RenderTargetDesc getRenderTargetDesc(Texture texture, GBufferLayout gbuffer_layout)
+{
+	bool const is_compact = gbuffer_layout == GBufferLayout::Compact;
+
+	RenderTargetDesc desc;
+	switch (texture) {
+		case Texture::DepthBuffer:
+			desc.internal_format = GL_DEPTH24_STENCIL8;
+			desc.format = GL_DEPTH_COMPONENT;
+			desc.type = GL_FLOAT;
+			break;
+		case Texture::GBufferWorldSpaceNormal:
+			if (is_compact) {
+				desc.internal_format = GL_RG16;
+				desc.format = GL_RG;
+				desc.type = GL_UNSIGNED_SHORT;
+			}
+			break;
+		case Texture::LightDiffuseContribution:
+		case Texture::LightSpecularContribution:
+			if (is_compact) {
+				desc.internal_format = GL_R11F_G11F_B10F;
+				desc.format = GL_RGB;
+				desc.type = GL_FLOAT;
+			}
+			break;
+		default:
+			break;
+	}
+	return desc;
+}
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferSpecular)]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::GBufferSpecular)], "GBuffer specular");
+SceneTargets createSceneTargets(RenderGraph& graph, GBufferLayout gbuffer_layout)
+{
+	auto const create_target = [&graph, gbuffer_layout](Texture texture) {
+		return graph.CreateTarget(texture_names[toU(texture)], getRenderTargetDesc(texture, gbuffer_layout));
+	};
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferWorldSpaceNormal)]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::GBufferWorldSpaceNormal)], "GBuffer normals");
+	SceneTargets targets;
+	targets.depth = create_target(Texture::DepthBuffer);
+	targets.gbuffer_diffuse = create_target(Texture::GBufferDiffuse);
+	// The compact layout stores the specular intensity alongside the
+	// diffuse colour.
+	if (gbuffer_layout == GBufferLayout::Standard)
+		targets.gbuffer_specular = create_target(Texture::GBufferSpecular);
+	targets.gbuffer_normals = create_target(Texture::GBufferWorldSpaceNormal);
+	targets.light_diffuse = create_target(Texture::LightDiffuseContribution);
+	targets.light_specular = create_target(Texture::LightSpecularContribution);
+	targets.result = create_target(Texture::Result);
+	return targets;
+}
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::LightDiffuseContribution)]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::LightDiffuseContribution)], "Light diffuse contribution");
+bool checkRenderTargetResizing(RenderTargetPool& pool)
+{
+	auto& registry = bonobo::getResourceRegistry();
+	auto const reference_size = pool.GetReferenceSize();
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::LightSpecularContribution)]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::LightSpecularContribution)], "Light specular contribution");
+	pool.Trim();
+	auto const objects_nb = registry.GetTotalUsage().objects_nb;
+	auto const incomplete_framebuffers_nb = pool.GetStatistics().incomplete_framebuffers_nb;
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::Result)]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::Result)], "Final result");
+	// Odd and tiny sizes are the likeliest to go wrong.
+	std::array<glm::uvec2, 8> const sizes = {
+		glm::uvec2(1u, 1u), glm::uvec2(3u, 517u), glm::uvec2(640u, 480u), glm::uvec2(1921u, 1079u),
+		glm::uvec2(1280u, 720u), glm::uvec2(2u, 2u), glm::uvec2(3840u, 2160u), reference_size
+	};
+	// The passes draw nothing, but use the targets just like those of a
+	// frame do, so that the result aliases the normals.
+	RenderGraph graph(pool);
+	auto const nothing = [](RenderGraph::PassContext const&){};
+	for (std::size_t i = 0; i < 4u * sizes.size(); ++i) {
+		pool.SetReferenceSize(sizes[i % sizes.size()]);
+		for (std::uint32_t layout = 0u; layout < toU(GBufferLayout::Count); ++layout) {
+			graph.Clear();
+			auto targets = createSceneTargets(graph, static_cast<GBufferLayout>(layout));
+			graph.AddPass("G-buffer generation", [&targets](RenderGraph::PassBuilder& builder) {
+				targets.depth = builder.WriteDepth(targets.depth);
+				targets.gbuffer_diffuse = builder.WriteColour(0u, targets.gbuffer_diffuse);
+				if (targets.gbuffer_specular.IsValid())
+					targets.gbuffer_specular = builder.WriteColour(1u, targets.gbuffer_specular);
+				targets.gbuffer_normals = builder.WriteColour(2u, targets.gbuffer_normals);
+			}, nothing);
+			graph.AddPass("Lights accumulation", [&targets](RenderGraph::PassBuilder& builder) {
+				builder.ReadDepth(targets.depth);
+				builder.Read(targets.gbuffer_normals);
+				targets.light_diffuse = builder.WriteColour(0u, targets.light_diffuse);
+				targets.light_specular = builder.WriteColour(1u, targets.light_specular);
+			}, nothing);
+			graph.AddPass("Resolve", [&targets](RenderGraph::PassBuilder& builder) {
+				builder.Read(targets.gbuffer_diffuse);
+				if (targets.gbuffer_specular.IsValid())
+					builder.Read(targets.gbuffer_specular);
+				builder.Read(targets.light_diffuse);
+				builder.Read(targets.light_specular);
+				targets.result = builder.WriteColour(0u, targets.result);
+			}, nothing);
+			graph.AddPass("Debug geometry", [&targets](RenderGraph::PassBuilder& builder) {
+				builder.ReadDepth(targets.depth);
+				targets.result = builder.WriteColour(0u, targets.result);
+			}, nothing);
+			graph.AddPass("Copy to framebuffer", [&targets](RenderGraph::PassBuilder& builder) {
+				builder.Read(targets.result);
+				builder.WriteDefaultFramebuffer();
+			}, nothing);
+			if (graph.Compile())
+				graph.Execute();
+		}
+		pool.NewFrame();
+	}
 
-	glBindTexture(GL_TEXTURE_2D, 0u);
-	return textures;
+	pool.SetReferenceSize(reference_size);
+	pool.Trim();
+	auto const leaked_objects_nb = static_cast<long long>(registry.GetTotalUsage().objects_nb) - static_cast<long long>(objects_nb);
+	auto const new_incomplete_framebuffers_nb = pool.GetStatistics().incomplete_framebuffers_nb - incomplete_framebuffers_nb;
+	if (leaked_objects_nb != 0 || new_incomplete_framebuffers_nb != 0u) {
+		LogError("Render target resizing check failed: %lld objects leaked, %zu incomplete framebuffers.",
+		         leaked_objects_nb, new_incomplete_framebuffers_nb);
+		return false;
+	}
+	LogInfo("Render target resizing check passed: %zu sizes, no objects leaked and all framebuffers complete.", 4u * sizes.size());
+	return true;
 }
 
 Samplers createSamplers()
 {
+	auto& registry = bonobo::getResourceRegistry();
 	Samplers samplers;
 	glGenSamplers(static_cast<GLsizei>(samplers.size()), samplers.data());
 
 	// For sampling 2-D textures without interpolation.
 	glSamplerParameteri(samplers[toU(Sampler::Nearest)], GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glSamplerParameteri(samplers[toU(Sampler::Nearest)], GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	utils::opengl::debug::nameObject(GL_SAMPLER, samplers[toU(Sampler::Nearest)], "Nearest");
+	registry.Register(ResourceType::sampler, samplers[toU(Sampler::Nearest)], "Nearest");
 
 	// For sampling 2-D textures without mipmaps.
 	glSamplerParameteri(samplers[toU(Sampler::Linear)], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glSamplerParameteri(samplers[toU(Sampler::Linear)], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	utils::opengl::debug::nameObject(GL_SAMPLER, samplers[toU(Sampler::Linear)], "Linear");
+	registry.Register(ResourceType::sampler, samplers[toU(Sampler::Linear)], "Linear");
 
 	// For sampling 2-D textures with mipmaps.
 	glSamplerParameteri(samplers[toU(Sampler::Mipmaps)], GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glSamplerParameteri(samplers[toU(Sampler::Mipmaps)], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	utils::opengl::debug::nameObject(GL_SAMPLER, samplers[toU(Sampler::Mipmaps)], "Mimaps");
+	registry.Register(ResourceType::sampler, samplers[toU(Sampler::Mipmaps)], "Mimaps");
+
+	// For sampling depth textures through shadow samplers, with the
+	// comparisons filtered by the hardware.
+	glSamplerParameteri(samplers[toU(Sampler::ShadowComparison)], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glSamplerParameteri(samplers[toU(Sampler::ShadowComparison)], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(samplers[toU(Sampler::ShadowComparison)], GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(samplers[toU(Sampler::ShadowComparison)], GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(samplers[toU(Sampler::ShadowComparison)], GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glSamplerParameteri(samplers[toU(Sampler::ShadowComparison)], GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	registry.Register(ResourceType::sampler, samplers[toU(Sampler::ShadowComparison)], "Shadow comparison");
 
 	return samplers;
 }
@@ -939,174 +2013,53 @@ FBOs createFramebufferObjects(Textures const& textures)
 		LogError("Framebuffer \"%s\" is not complete: check the logs for additional information.", fbo_name.data());
 	};
 
-	FBOs fbos;
-	glGenFramebuffers(static_cast<GLsizei>(fbos.size()), fbos.data());
-
-	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::GBuffer)]);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::GBufferDiffuse)], 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[toU(Texture::GBufferSpecular)], 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, textures[toU(Texture::GBufferWorldSpaceNormal)], 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)], 0);
-	glReadBuffer(GL_NONE); // Disable reading back from the colour attachments, as unnecessary in this assignment.
-	// Configure the mapping from fragment shader outputs to colour attachments.
-	std::array<GLenum, 3> const gbuffer_draws = {
-		GL_COLOR_ATTACHMENT0, // The fragment shader output at location 0 will be written to colour attachment 0 (i.e. the diffuse texture).
-		GL_COLOR_ATTACHMENT1, // The fragment shader output at location 1 will be written to colour attachment 1 (i.e. the specular texture).
-		GL_COLOR_ATTACHMENT2  // The fragment shader output at location 2 will be written to colour attachment 2 (i.e. the normal texture).
-	};
-	glDrawBuffers(static_cast<GLsizei>(gbuffer_draws.size()), gbuffer_draws.data());
-	validate_fbo("GBuffer");
-	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::GBuffer)], "GBuffer");
-
-	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)]);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::ShadowMap)], 0);
-	validate_fbo("Shadow map generation");
-	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)], "Shadow map generation");
-
-	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::LightDiffuseContribution)], 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[toU(Texture::LightSpecularContribution)], 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)], 0);
-	glReadBuffer(GL_NONE); // Disable reading back from the colour attachments, as unnecessary in this assignment.
-	// Configure the mapping from fragment shader outputs to colour attachments.
-	std::array<GLenum, 2> const light_accumulation_draws = {
-		GL_COLOR_ATTACHMENT0, // The fragment shader output at location 0 will be written to colour attachment 0 (i.e. the light diffuse contribution texture).
-		GL_COLOR_ATTACHMENT1  // The fragment shader output at location 1 will be written to colour attachment 1 (i.e. the light specular contribution texture).
-	};
-	glDrawBuffers(static_cast<GLsizei>(light_accumulation_draws.size()), light_accumulation_draws.data());
-	validate_fbo("Light accumulation");
-	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)], "Light acccumulation");
-
-	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::Result)], 0);
-	glReadBuffer(GL_COLOR_ATTACHMENT0); // Colour attachment result 0 (i.e. the rendering result texture) will be blitted to the screen.
-	glDrawBuffer(GL_COLOR_ATTACHMENT0); // The fragment shader output at location 0 will be written to colour attachment 0 (i.e. the rendering result texture).
-	validate_fbo("Resolve");
-	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::Resolve)], "Resolve");
-
-	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::FinalWithDepth)]);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::Result)], 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)], 0);
-	glReadBuffer(GL_NONE); // Disable reading back from the colour attachments, as unnecessary in this assignment.
-	glDrawBuffer(GL_COLOR_ATTACHMENT0); // The fragment shader output at location 0 will be written to colour attachment 0 (i.e. the rendering result texture).
-	validate_fbo("Final with depth");
-	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::FinalWithDepth)], "Cone wireframe");
+	auto& registry = bonobo::getResourceRegistry();
+	FBOs fbos = {};
+	glGenFramebuffers(1, &fbos[toU(FBO::ShadowAtlas)]);
+	glGenFramebuffers(1, &fbos[toU(FBO::ShadowAtlasStaticCache)]);
+	glGenFramebuffers(1, &fbos[toU(FBO::SunShadowCascades)]);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowAtlas)]);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::ShadowAtlas)], 0);
+	validate_fbo("Shadow atlas generation");
+	registry.Register(ResourceType::framebuffer, fbos[toU(FBO::ShadowAtlas)], "Shadow atlas generation");
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowAtlasStaticCache)]);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::ShadowAtlasStaticCache)], 0);
+	validate_fbo("Shadow atlas static cache generation");
+	registry.Register(ResourceType::framebuffer, fbos[toU(FBO::ShadowAtlasStaticCache)], "Shadow atlas static cache generation");
+
+	// The layer being rendered to gets attached before rendering each
+	// cascade; attach the first one for now, for validation.
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::SunShadowCascades)]);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[toU(Texture::SunShadowCascades)], 0, 0);
+	validate_fbo("Sun shadow cascades generation");
+	registry.Register(ResourceType::framebuffer, fbos[toU(FBO::SunShadowCascades)], "Sun shadow cascades generation");
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0u);
 	return fbos;
 }
 
-ElapsedTimeQueries createElapsedTimeQueries()
-{
-	ElapsedTimeQueries queries;
-	glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
-
-	if (utils::opengl::debug::isSupported())
-	{
-		// Queries (like any other OpenGL object) need to have been used at least
-		// once to ensure their resources have been allocated so we can call
-		// `glObjectLabel()` on them.
-		auto const register_query = [](GLuint const query) {
-			glBeginQuery(GL_TIME_ELAPSED, query);
-			glEndQuery(GL_TIME_ELAPSED);
-		};
-
-		register_query(queries[toU(ElapsedTimeQuery::GbufferGeneration)]);
-		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::GbufferGeneration)], "GBuffer generation");
-
-		for (size_t i = 0; i < constant::lights_nb; ++i)
-		{
-			register_query(queries[toU(ElapsedTimeQuery::ShadowMap0Generation) + i]);
-			utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::ShadowMap0Generation) + i], "Shadow map " + std::to_string(i) + " generation");
-
-			register_query(queries[toU(ElapsedTimeQuery::Light0Accumulation) + i]);
-			utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::Light0Accumulation) + i], "Light" + std::to_string(i) + " accumulation");
-		}
-
-		register_query(queries[toU(ElapsedTimeQuery::Resolve)]);
-		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::Resolve)], "Resolve");
-
-		register_query(queries[toU(ElapsedTimeQuery::ConeWireframe)]);
-		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::ConeWireframe)], "Cone wireframe");
-
-		register_query(queries[toU(ElapsedTimeQuery::GUI)]);
-		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::GUI)], "GUI");
-	}
-
-	return queries;
-}
-
 UBOs createUniformBufferObjects()
 {
+	auto& registry = bonobo::getResourceRegistry();
 	UBOs ubos;
 	glGenBuffers(static_cast<GLsizei>(ubos.size()), ubos.data());
 
 	glBindBuffer(GL_UNIFORM_BUFFER, ubos[toU(UBO::CameraViewProjTransforms)]);
 	glBufferData(GL_UNIFORM_BUFFER, sizeof(ViewProjTransforms), nullptr, GL_STREAM_DRAW);
 	glBindBufferBase(GL_UNIFORM_BUFFER, toU(UBO::CameraViewProjTransforms), ubos[toU(UBO::CameraViewProjTransforms)]);
-	utils::opengl::debug::nameObject(GL_BUFFER, ubos[toU(UBO::CameraViewProjTransforms)], "Camera view-projection transforms");
+	registry.Register(ResourceType::buffer, ubos[toU(UBO::CameraViewProjTransforms)], "Camera view-projection transforms");
 
 	glBindBuffer(GL_UNIFORM_BUFFER, ubos[toU(UBO::LightViewProjTransforms)]);
 	glBufferData(GL_UNIFORM_BUFFER, constant::lights_nb * sizeof(ViewProjTransforms), nullptr, GL_STREAM_DRAW);
 	glBindBufferBase(GL_UNIFORM_BUFFER, toU(UBO::LightViewProjTransforms), ubos[toU(UBO::LightViewProjTransforms)]);
-	utils::opengl::debug::nameObject(GL_BUFFER, ubos[toU(UBO::LightViewProjTransforms)], "Light view-projection transforms");
+	registry.Register(ResourceType::buffer, ubos[toU(UBO::LightViewProjTransforms)], "Light view-projection transforms");
 
 	glBindBuffer(GL_UNIFORM_BUFFER, 0u);
 	return ubos;
 }
 
-void fillGBufferShaderLocations(GLuint gbuffer_shader, GBufferShaderLocations& locations)
-{
-	locations.ubo_CameraViewProjTransforms = glGetUniformBlockIndex(gbuffer_shader, "CameraViewProjTransforms");
-	locations.vertex_model_to_world = glGetUniformLocation(gbuffer_shader, "vertex_model_to_world");
-	locations.normal_model_to_world = glGetUniformLocation(gbuffer_shader, "normal_model_to_world");
-	locations.diffuse_texture = glGetUniformLocation(gbuffer_shader, "diffuse_texture");
-	locations.specular_texture = glGetUniformLocation(gbuffer_shader, "specular_texture");
-	locations.normals_texture = glGetUniformLocation(gbuffer_shader, "normals_texture");
-	locations.opacity_texture = glGetUniformLocation(gbuffer_shader, "opacity_texture");
-	locations.has_diffuse_texture = glGetUniformLocation(gbuffer_shader, "has_diffuse_texture");
-	locations.has_specular_texture = glGetUniformLocation(gbuffer_shader, "has_specular_texture");
-	locations.has_normals_texture = glGetUniformLocation(gbuffer_shader, "has_normals_texture");
-	locations.has_opacity_texture = glGetUniformLocation(gbuffer_shader, "has_opacity_texture");
-
-	glUniformBlockBinding(gbuffer_shader, locations.ubo_CameraViewProjTransforms, toU(UBO::CameraViewProjTransforms));
-
-}
-
-void fillShadowmapShaderLocations(GLuint shadowmap_shader, FillShadowmapShaderLocations& locations)
-{
-	locations.ubo_LightViewProjTransforms = glGetUniformBlockIndex(shadowmap_shader, "LightViewProjTransforms");
-	locations.light_index = glGetUniformLocation(shadowmap_shader, "light_index");
-	locations.vertex_model_to_world = glGetUniformLocation(shadowmap_shader, "vertex_model_to_world");
-	locations.opacity_texture = glGetUniformLocation(shadowmap_shader, "opacity_texture");
-	locations.has_opacity_texture = glGetUniformLocation(shadowmap_shader, "has_opacity_texture");
-
-	glUniformBlockBinding(shadowmap_shader, locations.ubo_LightViewProjTransforms, toU(UBO::LightViewProjTransforms));
-}
-
-void fillAccumulateLightsShaderLocations(GLuint accumulate_lights_shader, AccumulateLightsShaderLocations& locations)
-{
-	locations.ubo_CameraViewProjTransforms = glGetUniformBlockIndex(accumulate_lights_shader, "CameraViewProjTransforms");
-	locations.ubo_LightViewProjTransforms = glGetUniformBlockIndex(accumulate_lights_shader, "LightViewProjTransforms");
-	locations.light_index = glGetUniformLocation(accumulate_lights_shader, "light_index");
-	locations.vertex_model_to_world = glGetUniformLocation(accumulate_lights_shader, "vertex_model_to_world");
-	locations.vertex_world_to_clip = glGetUniformLocation(accumulate_lights_shader, "vertex_world_to_clip");
-	locations.vertex_clip_to_world = glGetUniformLocation(accumulate_lights_shader, "vertex_clip_to_world");
-	locations.depth_texture = glGetUniformLocation(accumulate_lights_shader, "depth_texture");
-	locations.normal_texture = glGetUniformLocation(accumulate_lights_shader, "normal_texture");
-	locations.shadow_texture = glGetUniformLocation(accumulate_lights_shader, "shadow_texture");
-	locations.camera_position = glGetUniformLocation(accumulate_lights_shader, "camera_position");
-	locations.inverse_screen_resolution = glGetUniformLocation(accumulate_lights_shader, "inverse_screen_resolution");
-	locations.light_color = glGetUniformLocation(accumulate_lights_shader, "light_color");
-	locations.light_position = glGetUniformLocation(accumulate_lights_shader, "light_position");
-	locations.light_direction = glGetUniformLocation(accumulate_lights_shader, "light_direction");
-	locations.light_intensity = glGetUniformLocation(accumulate_lights_shader, "light_intensity");
-	locations.light_angle_falloff = glGetUniformLocation(accumulate_lights_shader, "light_angle_falloff");
-
-	glUniformBlockBinding(accumulate_lights_shader, locations.ubo_CameraViewProjTransforms, toU(UBO::CameraViewProjTransforms));
-	glUniformBlockBinding(accumulate_lights_shader, locations.ubo_LightViewProjTransforms, toU(UBO::LightViewProjTransforms));
-}
-
 bonobo::mesh_data
 loadCone()
 {
@@ -1181,17 +2134,18 @@ loadCone()
 		0.f, 0.f, -1.f
 	};
 
+	auto& registry = bonobo::getResourceRegistry();
 	glGenVertexArrays(1, &cone.vao);
 	assert(cone.vao != 0u);
 	glBindVertexArray(cone.vao);
 	{
-		utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, cone.vao, "Cone VAO");
+		registry.Register(ResourceType::vertex_array, cone.vao, "Cone VAO");
 
 		glGenBuffers(1, &cone.bo);
 		assert(cone.bo != 0u);
 		glBindBuffer(GL_ARRAY_BUFFER, cone.bo);
 		glBufferData(GL_ARRAY_BUFFER, cone.vertices_nb * 3 * sizeof(float), vertexArrayData, GL_STATIC_DRAW);
-		utils::opengl::debug::nameObject(GL_BUFFER, cone.bo, "Cone VBO");
+		registry.Register(ResourceType::buffer, cone.bo, "Cone VBO");
 
 		glVertexAttribPointer(static_cast<int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
 		glEnableVertexAttribArray(static_cast<int>(bonobo::shader_bindings::vertices));
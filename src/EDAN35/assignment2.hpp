@@ -4,20 +4,34 @@
 #include "core/FPSCamera.h"
 #include "core/WindowManager.hpp"
 
+#include <string>
+
 
 class Window;
 
 
 namespace edan35
 {
+	//! \brief Settings for running a fixed number of frames along a
+	//!        camera path, without any window or vsync, and writing
+	//!        the per-pass timings out.
+	struct BenchmarkSettings {
+		bool is_enabled{false};
+		std::string camera_path;       //!< File to load; empty for the built-in fly-through.
+		unsigned int frames_nb{600u};  //!< Frames measured, excluding the warm-up ones.
+		unsigned int warmup_frames_nb{60u};
+		std::string output_prefix{"edan35_benchmark"};  //!< Results go to <prefix>.csv, <prefix>.json and <prefix>_memory.json.
+		unsigned int memory_budget_mib{0u};  //!< Soft video memory budget; 0 for none.
+	};
+
 	//! \brief Wrapper class for Assignment 2
 	class Assignment2 {
 	public:
 		//! \brief Default constructor.
 		//!
 		//! It will initialise various modules of bonobo and retrieve a
-		//! window to draw to.
-		Assignment2(WindowManager& windowManager);
+		//! window to draw to; in benchmark mode, that window is hidden.
+		Assignment2(WindowManager& windowManager, BenchmarkSettings const& benchmarkSettings = BenchmarkSettings());
 
 		//! \brief Default destructor.
 		//!
@@ -34,5 +48,6 @@ namespace edan35
 		InputHandler   inputHandler;
 		WindowManager& mWindowManager;
 		GLFWwindow*    window;
+		BenchmarkSettings mBenchmarkSettings;
 	};
 }
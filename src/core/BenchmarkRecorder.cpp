@@ -0,0 +1,146 @@
+#include "BenchmarkRecorder.hpp"
+
+#include "Log.h"
+#include "various.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace
+{
+	std::string EscapeCsv(std::string const& text)
+	{
+		if (text.find_first_of(",\"\n") == std::string::npos)
+			return text;
+
+		std::string escaped = "\"";
+		for (auto const c : text)
+			escaped += c == '"' ? std::string("\"\"") : std::string(1u, c);
+		return escaped + "\"";
+	}
+}
+
+void BenchmarkRecorder::AddSample(std::uint64_t frame, std::string const& source, std::string const& pass, float duration_ms)
+{
+	auto const existing_pass = std::find_if(passes.begin(), passes.end(),
+	                                        [&source, &pass](Pass const& p) { return p.source == source && p.name == pass; });
+	auto const pass_index = static_cast<std::size_t>(existing_pass - passes.begin());
+	if (existing_pass == passes.end())
+		passes.push_back({ source, pass });
+
+	samples.push_back({ frame, pass_index, duration_ms });
+}
+
+void BenchmarkRecorder::Clear()
+{
+	passes.clear();
+	samples.clear();
+}
+
+std::vector<BenchmarkRecorder::Summary> BenchmarkRecorder::ComputeSummaries() const
+{
+	std::vector<std::vector<float>> durations(passes.size());
+	for (auto const& sample : samples)
+		durations[sample.pass_index].push_back(sample.duration_ms);
+
+	std::vector<Summary> summaries;
+	summaries.reserve(passes.size());
+	for (std::size_t i = 0u; i < passes.size(); ++i) {
+		auto& pass_durations = durations[i];
+		std::sort(pass_durations.begin(), pass_durations.end());
+
+		Summary summary;
+		summary.source = passes[i].source;
+		summary.pass = passes[i].name;
+		summary.samples_nb = pass_durations.size();
+		if (!pass_durations.empty()) {
+			auto const percentile = [&pass_durations](float ratio) {
+				auto const index = static_cast<std::size_t>(std::ceil(ratio * static_cast<float>(pass_durations.size()))) - 1u;
+				return pass_durations[std::min(index, pass_durations.size() - 1u)];
+			};
+			auto sum_ms = 0.0;
+			for (auto const duration : pass_durations)
+				sum_ms += duration;
+			summary.min_ms = pass_durations.front();
+			summary.avg_ms = static_cast<float>(sum_ms / static_cast<double>(pass_durations.size()));
+			summary.median_ms = percentile(0.5f);
+			summary.p95_ms = percentile(0.95f);
+			summary.max_ms = pass_durations.back();
+		}
+		summaries.push_back(summary);
+	}
+	return summaries;
+}
+
+bool BenchmarkRecorder::WriteCSV(std::string const& filename) const
+{
+	std::ofstream output(filename);
+	if (!output) {
+		LogError("Failed to open \"%s\" for writing the benchmark results.", filename.c_str());
+		return false;
+	}
+
+	output << "frame,source,pass,duration_ms\n";
+	for (auto const& sample : samples) {
+		auto const& pass = passes[sample.pass_index];
+		output << sample.frame << ',' << EscapeCsv(pass.source) << ',' << EscapeCsv(pass.name) << ',' << sample.duration_ms << '\n';
+	}
+
+	output.flush();
+	if (!output) {
+		LogError("Failed to write the benchmark results to \"%s\".", filename.c_str());
+		return false;
+	}
+
+	LogInfo("Wrote %zu benchmark samples to \"%s\".", samples.size(), filename.c_str());
+	return true;
+}
+
+bool BenchmarkRecorder::WriteJSON(std::string const& filename, std::string const& description) const
+{
+	std::ofstream output(filename);
+	if (!output) {
+		LogError("Failed to open \"%s\" for writing the benchmark results.", filename.c_str());
+		return false;
+	}
+
+	output << "{\n\t\"description\": \"" << utils::escape_json(description) << "\",\n\t\"summaries\": [";
+	auto const summaries = ComputeSummaries();
+	for (std::size_t i = 0u; i < summaries.size(); ++i) {
+		auto const& summary = summaries[i];
+		output << (i == 0u ? "\n" : ",\n")
+		       << "\t\t{ \"source\": \"" << utils::escape_json(summary.source) << "\", \"pass\": \"" << utils::escape_json(summary.pass) << "\""
+		       << ", \"samples_nb\": " << summary.samples_nb
+		       << ", \"min_ms\": " << summary.min_ms << ", \"avg_ms\": " << summary.avg_ms
+		       << ", \"median_ms\": " << summary.median_ms << ", \"p95_ms\": " << summary.p95_ms
+		       << ", \"max_ms\": " << summary.max_ms << " }";
+	}
+	output << "\n\t],\n\t\"samples\": [";
+	for (std::size_t i = 0u; i < samples.size(); ++i) {
+		auto const& sample = samples[i];
+		auto const& pass = passes[sample.pass_index];
+		output << (i == 0u ? "\n" : ",\n")
+		       << "\t\t{ \"frame\": " << sample.frame << ", \"source\": \"" << utils::escape_json(pass.source)
+		       << "\", \"pass\": \"" << utils::escape_json(pass.name) << "\", \"duration_ms\": " << sample.duration_ms << " }";
+	}
+	output << "\n\t]\n}\n";
+
+	output.flush();
+	if (!output) {
+		LogError("Failed to write the benchmark results to \"%s\".", filename.c_str());
+		return false;
+	}
+
+	LogInfo("Wrote %zu benchmark summaries to \"%s\".", summaries.size(), filename.c_str());
+	return true;
+}
+
+void BenchmarkRecorder::LogSummaries() const
+{
+	for (auto const& summary : ComputeSummaries()) {
+		LogInfo("%s %-40s avg %8.3f ms, median %8.3f ms, p95 %8.3f ms (min %.3f, max %.3f, %zu samples)",
+		        summary.source.c_str(), summary.pass.c_str(), summary.avg_ms, summary.median_ms, summary.p95_ms,
+		        summary.min_ms, summary.max_ms, summary.samples_nb);
+	}
+}
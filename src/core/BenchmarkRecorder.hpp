@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! \brief Gather per-frame durations of named passes during a benchmark
+//!        run, and write them out for later comparison between runs.
+//!
+//! Durations are tagged with their source, like "CPU" or "GPU", as a same
+//! pass name can be measured on both sides.
+class BenchmarkRecorder
+{
+public:
+	struct Summary
+	{
+		std::string source;
+		std::string pass;
+		std::size_t samples_nb{0u};
+		float min_ms{0.0f};
+		float avg_ms{0.0f};
+		float median_ms{0.0f};
+		float p95_ms{0.0f};  //!< 95th percentile.
+		float max_ms{0.0f};
+	};
+
+	void AddSample(std::uint64_t frame, std::string const& source, std::string const& pass, float duration_ms);
+	void Clear();
+
+	//! \brief Compute statistics for each pass, in the order passes were
+	//!        first recorded.
+	std::vector<Summary> ComputeSummaries() const;
+
+	//! \brief Write one line per sample, with the frame, source, pass and
+	//!        duration columns.
+	bool WriteCSV(std::string const& filename) const;
+
+	//! \brief Write the per-pass summaries followed by all samples.
+	//!
+	//! @param [in] filename File to write to
+	//! @param [in] description Free-form text describing the run, like the
+	//!             settings used, stored alongside the results
+	bool WriteJSON(std::string const& filename, std::string const& description) const;
+
+	//! \brief Log the per-pass summaries.
+	void LogSummaries() const;
+
+private:
+	struct Sample
+	{
+		std::uint64_t frame;
+		std::size_t pass_index;
+		float duration_ms;
+	};
+
+	struct Pass
+	{
+		std::string source;
+		std::string name;
+	};
+
+	std::vector<Pass> passes;
+	std::vector<Sample> samples;
+};
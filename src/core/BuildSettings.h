@@ -31,3 +31,10 @@
 *	Turn off for maximum performance.
 */
 #define ENABLE_GL_STATE_INSPECTION		1
+
+/*
+*	Stores the rotation of a TRSTransform as a quaternion (1) or as a 3x3 matrix (0) (found in TRSTransform.h)
+*	Quaternions are smaller and do not drift away from a pure rotation when accumulating many small rotations,
+*	but need to be converted back to a matrix each time one of the transform matrices is rebuilt.
+*/
+#define TRS_TRANSFORM_USE_QUATERNION	0
@@ -0,0 +1,121 @@
+#include "CameraPath.hpp"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+void CameraPath::AddKeyframe(float time, glm::vec3 const& position, glm::quat const& orientation)
+{
+	if (!keyframes.empty() && time < keyframes.back().time) {
+		LogWarning("Camera path keyframe at %.3f s comes before the previous one, at %.3f s: discarding it.", time, keyframes.back().time);
+		return;
+	}
+
+	Keyframe keyframe;
+	keyframe.time = time;
+	keyframe.position = position;
+	keyframe.orientation = orientation;
+	keyframes.push_back(keyframe);
+}
+
+void CameraPath::AddKeyframe(float time, FPSCameraf const& camera)
+{
+	AddKeyframe(time, camera.mWorld.GetTranslation(), camera.mWorld.GetRotationQuaternion());
+}
+
+void CameraPath::Clear()
+{
+	keyframes.clear();
+}
+
+bool CameraPath::IsEmpty() const
+{
+	return keyframes.empty();
+}
+
+float CameraPath::GetDuration() const
+{
+	return keyframes.empty() ? 0.0f : keyframes.back().time;
+}
+
+void CameraPath::Apply(float time, FPSCameraf& camera) const
+{
+	if (keyframes.empty())
+		return;
+
+	auto const next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+	                                   [](float t, Keyframe const& keyframe) { return t < keyframe.time; });
+	if (next == keyframes.begin() || next == keyframes.end()) {
+		auto const& keyframe = next == keyframes.begin() ? keyframes.front() : keyframes.back();
+		camera.mWorld.SetTranslate(keyframe.position);
+		camera.mWorld.SetRotation(keyframe.orientation);
+		return;
+	}
+
+	auto const& previous = *(next - 1);
+	auto const span = next->time - previous.time;
+	auto const x = span > 0.0f ? (time - previous.time) / span : 1.0f;
+	camera.mWorld.SetTranslate(glm::mix(previous.position, next->position, x));
+	camera.mWorld.SetRotation(glm::slerp(previous.orientation, next->orientation, x));
+}
+
+bool CameraPath::Load(std::string const& filename)
+{
+	std::ifstream input(filename);
+	if (!input) {
+		LogError("Failed to open camera path \"%s\".", filename.c_str());
+		return false;
+	}
+
+	keyframes.clear();
+	std::string line;
+	std::size_t line_number = 0u;
+	while (std::getline(input, line)) {
+		++line_number;
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream line_stream(line);
+		float time = 0.0f;
+		glm::vec3 position;
+		glm::quat orientation;
+		if (!(line_stream >> time >> position.x >> position.y >> position.z
+		                  >> orientation.w >> orientation.x >> orientation.y >> orientation.z)) {
+			LogError("Invalid keyframe on line %zu of camera path \"%s\".", line_number, filename.c_str());
+			keyframes.clear();
+			return false;
+		}
+		AddKeyframe(time, position, glm::normalize(orientation));
+	}
+
+	LogInfo("Loaded %zu keyframes, spanning %.3f s, from camera path \"%s\".", keyframes.size(), GetDuration(), filename.c_str());
+	return !keyframes.empty();
+}
+
+bool CameraPath::Save(std::string const& filename) const
+{
+	std::ofstream output(filename);
+	if (!output) {
+		LogError("Failed to open \"%s\" for writing the camera path.", filename.c_str());
+		return false;
+	}
+
+	output.precision(9);
+	output << "# time position.x position.y position.z orientation.w orientation.x orientation.y orientation.z\n";
+	for (auto const& keyframe : keyframes) {
+		output << keyframe.time << ' '
+		       << keyframe.position.x << ' ' << keyframe.position.y << ' ' << keyframe.position.z << ' '
+		       << keyframe.orientation.w << ' ' << keyframe.orientation.x << ' ' << keyframe.orientation.y << ' ' << keyframe.orientation.z << '\n';
+	}
+
+	output.flush();
+	if (!output) {
+		LogError("Failed to write the camera path to \"%s\".", filename.c_str());
+		return false;
+	}
+
+	LogInfo("Saved %zu keyframes to camera path \"%s\".", keyframes.size(), filename.c_str());
+	return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "FPSCamera.h"
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/vec3.hpp>
+
+#include <string>
+#include <vector>
+
+//! \brief A sequence of camera poses over time, which can be recorded while
+//!        flying around, saved to a file, and replayed later on to get
+//!        repeatable frames, for example when benchmarking.
+//!
+//! Files contain one keyframe per line, made of the time in seconds, the
+//! position, and the orientation as a quaternion (w, x, y, z), all separated
+//! by spaces; lines starting with '#' are ignored.
+class CameraPath
+{
+public:
+	struct Keyframe
+	{
+		float time{0.0f};
+		glm::vec3 position{0.0f};
+		glm::quat orientation;
+	};
+
+	//! \brief Append a keyframe; keyframes must be added in increasing
+	//!        time order.
+	void AddKeyframe(float time, glm::vec3 const& position, glm::quat const& orientation);
+
+	//! \brief Append a keyframe with the current pose of |camera|.
+	void AddKeyframe(float time, FPSCameraf const& camera);
+
+	void Clear();
+	bool IsEmpty() const;
+
+	//! \brief Return the time of the last keyframe.
+	float GetDuration() const;
+
+	//! \brief Place |camera| at the pose the path reaches at |time|,
+	//!        interpolating between the surrounding keyframes; times outside
+	//!        of the path are clamped to it.
+	void Apply(float time, FPSCameraf& camera) const;
+
+	bool Load(std::string const& filename);
+	bool Save(std::string const& filename) const;
+
+private:
+	std::vector<Keyframe> keyframes;
+};
@@ -8,6 +8,7 @@
 #include <glm/gtx/io.hpp>
 
 #include <chrono>
+#include <cstdint>
 #include <iostream>
 
 template<typename T, glm::precision P>
@@ -32,6 +33,12 @@ public:
 	glm::tmat4x4<T, P> GetClipToViewMatrix();
 	glm::tmat4x4<T, P> GetViewToClipMatrix();
 
+	// Same as GetWorldToClipMatrix(), but for a world space translated so
+	// that the camera sits at its origin: use it with positions from which
+	// the camera position was already subtracted, ideally in double
+	// precision, to keep precision in large scenes.
+	glm::tmat4x4<T, P> GetCameraRelativeWorldToClipMatrix();
+
 	glm::tvec3<T, P> GetClipToWorld(glm::tvec3<T, P> xyw);
 	glm::tvec3<T, P> GetClipToView(glm::tvec3<T, P> xyw);
 
@@ -42,9 +49,19 @@ public:
 
 public:
 	T mFov, mAspect, mNear, mFar;
+	glm::tvec2<T, P> mMousePosition;
+
+private:
+	// Only modified through SetProjection(), so that the cache below gets
+	// invalidated.
 	glm::tmat4x4<T, P> mProjection;
 	glm::tmat4x4<T, P> mProjectionInverse;
-	glm::tvec2<T, P> mMousePosition;
+
+	// Cache for GetWorldToClipMatrix(), invalidated by SetProjection() or by
+	// any modification of mWorld.
+	glm::tmat4x4<T, P> mWorldToClip;
+	std::uint64_t mWorldToClipVersion;
+	bool mIsWorldToClipDirty;
 
 public:
 	friend std::ostream &operator<<(std::ostream &os, FPSCamera<T, P> &v) {
@@ -1,5 +1,5 @@
 template<typename T, glm::precision P>
-FPSCamera<T, P>::FPSCamera(T fovy, T aspect, T nnear, T nfar) : mWorld(), mMovementSpeed(1), mMouseSensitivity(1), mFov(fovy), mAspect(aspect), mNear(nnear), mFar(nfar), mProjection(), mProjectionInverse(), mMousePosition(glm::tvec2<T, P>(0.0f))
+FPSCamera<T, P>::FPSCamera(T fovy, T aspect, T nnear, T nfar) : mWorld(), mMovementSpeed(1), mMouseSensitivity(1), mFov(fovy), mAspect(aspect), mNear(nnear), mFar(nfar), mMousePosition(glm::tvec2<T, P>(0.0f)), mProjection(), mProjectionInverse(), mWorldToClip(), mWorldToClipVersion(0u), mIsWorldToClipDirty(true)
 {
 	SetProjection(fovy, aspect, nnear, nfar);
 }
@@ -18,6 +18,7 @@ void FPSCamera<T, P>::SetProjection(T fovy, T aspect, T nnear, T nfar)
 	mFar = nfar;
 	mProjection = glm::perspective(fovy, aspect, nnear, nfar);
 	mProjectionInverse = glm::inverse(mProjection);
+	mIsWorldToClipDirty = true;
 }
 
 template<typename T, glm::precision P>
@@ -99,7 +100,12 @@ glm::tmat4x4<T, P> FPSCamera<T, P>::GetClipToWorldMatrix()
 template<typename T, glm::precision P>
 glm::tmat4x4<T, P> FPSCamera<T, P>::GetWorldToClipMatrix()
 {
-	return mProjection * GetWorldToViewMatrix();
+	if (mIsWorldToClipDirty || mWorldToClipVersion != mWorld.GetVersion()) {
+		mWorldToClip = mProjection * GetWorldToViewMatrix();
+		mWorldToClipVersion = mWorld.GetVersion();
+		mIsWorldToClipDirty = false;
+	}
+	return mWorldToClip;
 }
 
 template<typename T, glm::precision P>
@@ -114,6 +120,12 @@ glm::tmat4x4<T, P> FPSCamera<T, P>::GetViewToClipMatrix()
 	return mProjection;
 }
 
+template<typename T, glm::precision P>
+glm::tmat4x4<T, P> FPSCamera<T, P>::GetCameraRelativeWorldToClipMatrix()
+{
+	return mProjection * mWorld.GetScaleMatrixInverse() * mWorld.GetRotationMatrixInverse();
+}
+
 template<typename T, glm::precision P>
 glm::tvec3<T, P> FPSCamera<T, P>::GetClipToWorld(glm::tvec3<T, P> xyw)
 {
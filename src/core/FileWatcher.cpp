@@ -0,0 +1,138 @@
+#include "FileWatcher.hpp"
+
+#include "Log.h"
+#include "various.hpp"
+
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Returns -1 if |filename| cannot be accessed, for example while an
+	// editor is in the middle of replacing it.
+	long long getModificationTime(std::string const& filename)
+	{
+#if defined(_WIN32)
+		struct _stat64 status;
+		if (_wstat64(utils::widen(filename).c_str(), &status) != 0)
+			return -1;
+#else
+		struct stat status;
+		if (stat(filename.c_str(), &status) != 0)
+			return -1;
+#endif
+		return static_cast<long long>(status.st_mtime);
+	}
+
+	std::string getDirectory(std::string const& filename)
+	{
+		auto const separator = filename.find_last_of("/\\");
+		return separator == std::string::npos ? std::string(".") : filename.substr(0u, separator);
+	}
+}
+
+FileWatcher::FileWatcher(std::chrono::milliseconds polling_interval) :
+	polling_interval(polling_interval), last_polling_time(std::chrono::steady_clock::now())
+{
+#if defined(__linux__)
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0)
+		LogWarning("Failed to initialise inotify (error %d): falling back to polling for file changes.", errno);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#if defined(__linux__)
+	if (inotify_fd >= 0)
+		close(inotify_fd);
+#endif
+}
+
+void FileWatcher::Watch(std::string const& filename)
+{
+	if (!watched_files.insert(filename).second)
+		return;
+
+#if defined(__linux__)
+	if (inotify_fd >= 0) {
+		auto const directory = getDirectory(filename);
+		auto const is_directory_watched = std::any_of(watched_directories.begin(), watched_directories.end(),
+		                                              [&directory](std::pair<int const, std::string> const& d) { return d.second == directory; });
+		if (is_directory_watched)
+			return;
+
+		// Editors often save by writing a new file and renaming it over the
+		// old one, hence watching the directory rather than the file.
+		auto const watch_descriptor = inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (watch_descriptor >= 0) {
+			watched_directories.emplace(watch_descriptor, directory);
+			return;
+		}
+		LogWarning("Failed to watch directory \"%s\" (error %d): falling back to polling for its files.", directory.c_str(), errno);
+	}
+#endif
+
+	modification_times.emplace(filename, getModificationTime(filename));
+}
+
+std::vector<std::string> FileWatcher::PollChanges()
+{
+	auto changed_files = PollModificationTimes();
+
+#if defined(__linux__)
+	if (inotify_fd >= 0) {
+		alignas(inotify_event) char buffer[4096];
+		for (;;) {
+			auto const read_length = read(inotify_fd, buffer, sizeof(buffer));
+			if (read_length <= 0)
+				break; // EAGAIN once all pending events have been consumed.
+
+			for (auto event_start = buffer; event_start < buffer + read_length;) {
+				auto const event = reinterpret_cast<inotify_event const*>(event_start);
+				event_start += sizeof(inotify_event) + event->len;
+
+				auto const directory = watched_directories.find(event->wd);
+				if (event->len == 0u || directory == watched_directories.end())
+					continue;
+
+				auto const filename = directory->second + "/" + event->name;
+				if (watched_files.count(filename) != 0u)
+					changed_files.push_back(filename);
+			}
+		}
+	}
+#endif
+
+	// Saving a file can trigger several events.
+	std::sort(changed_files.begin(), changed_files.end());
+	changed_files.erase(std::unique(changed_files.begin(), changed_files.end()), changed_files.end());
+	return changed_files;
+}
+
+std::vector<std::string> FileWatcher::PollModificationTimes()
+{
+	std::vector<std::string> changed_files;
+	if (modification_times.empty())
+		return changed_files;
+
+	auto const now = std::chrono::steady_clock::now();
+	if (now - last_polling_time < polling_interval)
+		return changed_files;
+	last_polling_time = now;
+
+	for (auto& file : modification_times) {
+		auto const modification_time = getModificationTime(file.first);
+		if (modification_time == file.second || modification_time < 0)
+			continue;
+		file.second = modification_time;
+		changed_files.push_back(file.first);
+	}
+	return changed_files;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//! \brief Report which of a set of files got modified, without blocking.
+//!
+//! On Linux, the directories containing the watched files are monitored
+//! through inotify, so changes are picked up as soon as they are polled
+//! for, even when an editor replaces a file rather than writing to it. On
+//! other platforms, or if inotify is unavailable, the modification times
+//! of all watched files are compared every |polling_interval| instead.
+class FileWatcher
+{
+public:
+	explicit FileWatcher(std::chrono::milliseconds polling_interval = std::chrono::milliseconds(500));
+	~FileWatcher();
+	FileWatcher(FileWatcher const&) = delete;
+	FileWatcher& operator=(FileWatcher const&) = delete;
+
+	//! \brief Start watching |filename|; watching a file several times
+	//!        has no further effect.
+	void Watch(std::string const& filename);
+
+	//! \brief Return the watched files modified since the previous call,
+	//!        each reported once, as they were passed to Watch().
+	std::vector<std::string> PollChanges();
+
+private:
+	std::vector<std::string> PollModificationTimes();
+
+	std::unordered_set<std::string> watched_files;
+
+	// Polling fallback
+	std::chrono::milliseconds polling_interval;
+	std::chrono::steady_clock::time_point last_polling_time;
+	std::unordered_map<std::string, long long> modification_times;
+
+	// inotify
+	int inotify_fd{-1};
+	std::unordered_map<int, std::string> watched_directories; //!< Directory of each watch descriptor
+};
@@ -0,0 +1,262 @@
+#include "GpuTimer.hpp"
+
+#include "Log.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+GpuTimer::GpuTimer(std::size_t frames_in_flight, std::size_t history_length) :
+	frames(std::max(frames_in_flight, static_cast<std::size_t>(1u))),
+	history_length(std::max(history_length, static_cast<std::size_t>(1u)))
+{
+}
+
+GpuTimer::~GpuTimer()
+{
+	for (auto& frame : frames) {
+		if (!frame.queries.empty())
+			glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+	}
+}
+
+void GpuTimer::BeginFrame()
+{
+	if (is_recording) {
+		LogWarning("A new GPU timer frame was begun before the previous one ended.");
+		EndFrame();
+	}
+
+	// Frames complete in the order they were submitted: go through them
+	// from the oldest, and stop at the first one which is not done yet.
+	for (std::size_t offset = 1u; offset <= frames.size(); ++offset) {
+		auto& frame = frames[(current_frame + offset) % frames.size()];
+		if (!frame.is_pending)
+			continue;
+		if (!IsAvailable(frame))
+			break;
+		Collect(frame);
+	}
+
+	current_frame = (current_frame + 1u) % frames.size();
+	auto& frame = frames[current_frame];
+	if (frame.is_pending) {
+		// Waiting for those results is exactly what this class is meant to
+		// avoid, so they are thrown away instead.
+		++dropped_frames_nb;
+		frame.is_pending = false;
+	}
+	frame.used_queries_nb = 0u;
+	frame.scopes.clear();
+	frame.number = ++frames_begun_nb;
+#if defined ENABLE_PROFILING && ENABLE_PROFILING != 0
+	// Reading the current GPU time does not wait for previous commands to
+	// complete.
+	GLint64 gpu_now_ns = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpu_now_ns);
+	frame.gpu_to_cpu_offset_ns = Profiler::Now() - static_cast<std::int64_t>(gpu_now_ns);
+#endif
+	is_recording = true;
+}
+
+void GpuTimer::EndFrame()
+{
+	if (!is_recording) {
+		LogWarning("Ending a GPU timer frame which was never begun.");
+		return;
+	}
+
+	if (!open_scopes.empty()) {
+		LogWarning("%zu GPU timer scopes were left open at the end of the frame.", open_scopes.size());
+		while (!open_scopes.empty())
+			EndScope();
+	}
+
+	auto& frame = frames[current_frame];
+	frame.is_pending = !frame.scopes.empty();
+	is_recording = false;
+}
+
+void GpuTimer::Flush()
+{
+	if (is_recording) {
+		LogWarning("Flushing the GPU timer while a frame is being recorded; ending that frame first.");
+		EndFrame();
+	}
+
+	glFinish();
+	for (std::size_t offset = 1u; offset <= frames.size(); ++offset) {
+		auto& frame = frames[(current_frame + offset) % frames.size()];
+		if (frame.is_pending)
+			Collect(frame);
+	}
+}
+
+void GpuTimer::BeginScope(std::string const& name)
+{
+	if (!is_recording) {
+		LogError("GPU timer scope '%s' was begun outside of a frame.", name.c_str());
+		return;
+	}
+
+	auto& frame = frames[current_frame];
+
+	RecordedScope scope;
+	scope.path = open_scopes.empty() ? name : frame.scopes[open_scopes.back()].path + "/" + name;
+	scope.depth = open_scopes.size();
+	scope.begin_query = AcquireQuery(frame);
+	scope.end_query = scope.begin_query;
+	glQueryCounter(frame.queries[scope.begin_query], GL_TIMESTAMP);
+
+	open_scopes.push_back(frame.scopes.size());
+	frame.scopes.push_back(std::move(scope));
+}
+
+void GpuTimer::EndScope()
+{
+	if (open_scopes.empty()) {
+		LogError("Ending a GPU timer scope which was never begun.");
+		return;
+	}
+
+	auto& frame = frames[current_frame];
+	auto& scope = frame.scopes[open_scopes.back()];
+	open_scopes.pop_back();
+
+	scope.end_query = AcquireQuery(frame);
+	glQueryCounter(frame.queries[scope.end_query], GL_TIMESTAMP);
+}
+
+GpuTimer::Statistics const* GpuTimer::GetStatistics(std::string const& path) const
+{
+	auto const history = histories.find(path);
+	return history != histories.end() ? &history->second.statistics : nullptr;
+}
+
+float GpuTimer::GetLatestDuration(std::string const& path) const
+{
+	for (auto const& scope : latest_frame_scopes) {
+		if (scope.path == path)
+			return scope.statistics.last_ms;
+	}
+	return 0.0f;
+}
+
+std::vector<GpuTimer::ScopeTiming> const& GpuTimer::GetLatestFrameScopes() const
+{
+	return latest_frame_scopes;
+}
+
+std::uint64_t GpuTimer::GetLatestFrameNumber() const
+{
+	return latest_frame_number;
+}
+
+std::uint64_t GpuTimer::GetCurrentFrameNumber() const
+{
+	return frames_begun_nb;
+}
+
+std::uint64_t GpuTimer::GetDroppedFramesCount() const
+{
+	return dropped_frames_nb;
+}
+
+void GpuTimer::ResetStatistics()
+{
+	histories.clear();
+	latest_frame_scopes.clear();
+}
+
+void GpuTimer::SetFrameCallback(FrameCallback callback)
+{
+	frame_callback = std::move(callback);
+}
+
+std::size_t GpuTimer::AcquireQuery(Frame& frame)
+{
+	if (frame.used_queries_nb == frame.queries.size()) {
+		GLuint query = 0u;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+	}
+	return frame.used_queries_nb++;
+}
+
+bool GpuTimer::IsAvailable(Frame const& frame) const
+{
+	// The last query issued should be the last one to complete, but the
+	// specification does not promise it, so all of them are checked.
+	for (std::size_t i = frame.used_queries_nb; i-- > 0u;) {
+		GLuint is_available = GL_FALSE;
+		glGetQueryObjectuiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &is_available);
+		if (is_available == GL_FALSE)
+			return false;
+	}
+	return true;
+}
+
+void GpuTimer::Collect(Frame& frame)
+{
+	frame.is_pending = false;
+	latest_frame_number = frame.number;
+	latest_frame_scopes.clear();
+
+	for (auto const& scope : frame.scopes) {
+		GLuint64 begin_ns = 0u, end_ns = 0u;
+		glGetQueryObjectui64v(frame.queries[scope.begin_query], GL_QUERY_RESULT, &begin_ns);
+		glGetQueryObjectui64v(frame.queries[scope.end_query], GL_QUERY_RESULT, &end_ns);
+		auto const duration_ms = end_ns > begin_ns ? static_cast<float>(end_ns - begin_ns) / 1000000.0f : 0.0f;
+		auto const name_start = scope.path.rfind('/');
+		auto const name = name_start == std::string::npos ? scope.path : scope.path.substr(name_start + 1u);
+
+#if defined ENABLE_PROFILING && ENABLE_PROFILING != 0
+		Profiler::RecordGpuEvent(Profiler::InternName(name),
+		                         static_cast<std::int64_t>(begin_ns) + frame.gpu_to_cpu_offset_ns,
+		                         static_cast<std::int64_t>(end_ns) + frame.gpu_to_cpu_offset_ns,
+		                         static_cast<std::uint32_t>(scope.depth));
+#endif
+
+		auto const same_path = std::find_if(latest_frame_scopes.begin(), latest_frame_scopes.end(),
+		                                    [&scope](ScopeTiming const& timing) { return timing.path == scope.path; });
+		if (same_path != latest_frame_scopes.end()) {
+			same_path->statistics.last_ms += duration_ms;
+			continue;
+		}
+
+		ScopeTiming timing;
+		timing.path = scope.path;
+		timing.name = name;
+		timing.depth = scope.depth;
+		timing.statistics.last_ms = duration_ms;
+		latest_frame_scopes.push_back(std::move(timing));
+	}
+
+	for (auto& timing : latest_frame_scopes) {
+		auto& history = histories[timing.path];
+		if (history.samples.size() < history_length)
+			history.samples.push_back(timing.statistics.last_ms);
+		else
+			history.samples[history.next_sample] = timing.statistics.last_ms;
+		history.next_sample = (history.next_sample + 1u) % history_length;
+
+		auto& statistics = history.statistics;
+		statistics.last_ms = timing.statistics.last_ms;
+		statistics.min_ms = std::numeric_limits<float>::max();
+		statistics.max_ms = 0.0f;
+		auto sum_ms = 0.0f;
+		for (auto const sample : history.samples) {
+			statistics.min_ms = std::min(statistics.min_ms, sample);
+			statistics.max_ms = std::max(statistics.max_ms, sample);
+			sum_ms += sample;
+		}
+		statistics.samples_nb = history.samples.size();
+		statistics.avg_ms = sum_ms / static_cast<float>(statistics.samples_nb);
+
+		timing.statistics = statistics;
+	}
+
+	if (frame_callback)
+		frame_callback(frame.number, latest_frame_scopes);
+}
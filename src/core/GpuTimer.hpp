@@ -0,0 +1,158 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Measure how long the GPU spends on named scopes of a frame,
+//!        without ever waiting for the GPU to catch up.
+//!
+//! Each scope is delimited by two timestamp queries, which, unlike
+//! GL_TIME_ELAPSED queries, can be nested. The queries of the last few
+//! frames are kept in a ring: when a frame starts, the results of older
+//! frames are only read back if the GPU already made them available, and
+//! a frame whose results are still pending when its slot of the ring gets
+//! reused is dropped rather than waited for. Timings therefore lag a few
+//! frames behind the frame being recorded.
+//!
+//! Scopes are identified by their path, made of the names of all enclosing
+//! scopes separated by slashes, like "Lighting/Light 3". If the same path
+//! is used several times within a frame, the durations get summed up.
+//!
+//! When CPU profiling is enabled, measured scopes are also forwarded to the
+//! profiler (see Profiler.h), so that they show up in exported traces.
+class GpuTimer
+{
+public:
+	struct Statistics
+	{
+		float last_ms{0.0f};
+		float min_ms{0.0f};
+		float avg_ms{0.0f};
+		float max_ms{0.0f};
+		std::size_t samples_nb{0u}; //!< Number of frames the other fields were computed over.
+	};
+
+	struct ScopeTiming
+	{
+		std::string path;
+		std::string name;
+		std::size_t depth{0u};  //!< Number of enclosing scopes.
+		Statistics statistics;
+	};
+
+	using FrameCallback = std::function<void (std::uint64_t frame_number, std::vector<ScopeTiming> const& scopes)>;
+
+	//! \brief Create a timer; an OpenGL context must be current.
+	//!
+	//! @param [in] frames_in_flight Number of frames whose queries can be
+	//!             pending at once; if results take longer than that to
+	//!             come back, some frames will be dropped
+	//! @param [in] history_length Number of frames over which the min, avg
+	//!             and max statistics are computed
+	GpuTimer(std::size_t frames_in_flight = 4u, std::size_t history_length = 64u);
+	~GpuTimer();
+
+	GpuTimer(GpuTimer const&) = delete;
+	GpuTimer& operator=(GpuTimer const&) = delete;
+
+	//! \brief Collect the results of all previous frames made available by
+	//!        the GPU, and start recording a new frame.
+	void BeginFrame();
+
+	//! \brief Stop recording the current frame; any scope left open is
+	//!        closed.
+	void EndFrame();
+
+	//! \brief Wait for the GPU to complete all pending frames, and collect
+	//!        their results.
+	//!
+	//! This stalls the CPU, so it is only meant for when every frame
+	//! matters, like at the end of a benchmark run.
+	void Flush();
+
+	//! \brief Start a new scope, nested in the current one if any.
+	void BeginScope(std::string const& name);
+
+	//! \brief End the most recently started scope.
+	void EndScope();
+
+	//! \brief Return the statistics of the scope identified by |path|, or
+	//!        nullptr if it was never measured.
+	Statistics const* GetStatistics(std::string const& path) const;
+
+	//! \brief Return the duration of the scope identified by |path| in the
+	//!        latest frame measured, or 0 if it was not part of it.
+	float GetLatestDuration(std::string const& path) const;
+
+	//! \brief Return all scopes of the latest frame measured, in the order
+	//!        they were started.
+	std::vector<ScopeTiming> const& GetLatestFrameScopes() const;
+
+	//! \brief Return the number of the latest frame measured, counting
+	//!        from 1 for the first frame ever begun, or 0 if none was.
+	std::uint64_t GetLatestFrameNumber() const;
+
+	//! \brief Return the number of the frame being recorded.
+	std::uint64_t GetCurrentFrameNumber() const;
+
+	//! \brief Return how many frames were dropped because their results
+	//!        did not come back in time.
+	std::uint64_t GetDroppedFramesCount() const;
+
+	//! \brief Forget all statistics gathered so far.
+	void ResetStatistics();
+
+	//! \brief Call |callback| with the scopes of each frame as soon as it
+	//!        gets collected; several frames can be collected at once, in
+	//!        which case the latest-frame accessors only see the last one.
+	void SetFrameCallback(FrameCallback callback);
+
+private:
+	struct RecordedScope
+	{
+		std::string path;
+		std::size_t depth;
+		std::size_t begin_query;
+		std::size_t end_query;
+	};
+
+	struct Frame
+	{
+		std::vector<GLuint> queries;
+		std::size_t used_queries_nb{0u};
+		std::vector<RecordedScope> scopes;
+		std::uint64_t number{0u};
+		std::int64_t gpu_to_cpu_offset_ns{0}; //!< Converts GPU timestamps to the CPU profiler's clock.
+		bool is_pending{false};
+	};
+
+	struct History
+	{
+		std::vector<float> samples;
+		std::size_t next_sample{0u};
+		Statistics statistics;
+	};
+
+	std::size_t AcquireQuery(Frame& frame);
+	bool IsAvailable(Frame const& frame) const;
+	void Collect(Frame& frame);
+
+	std::vector<Frame> frames;
+	std::size_t current_frame{0u};
+	std::uint64_t frames_begun_nb{0u};
+	std::uint64_t latest_frame_number{0u};
+	std::uint64_t dropped_frames_nb{0u};
+	bool is_recording{false};
+	std::vector<std::size_t> open_scopes;
+
+	std::size_t history_length;
+	std::unordered_map<std::string, History> histories;
+	std::vector<ScopeTiming> latest_frame_scopes;
+	FrameCallback frame_callback;
+};
@@ -0,0 +1,215 @@
+#include "MemoryBudget.hpp"
+
+#include "Log.h"
+#include "various.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t bytes_per_mib = 1024u * 1024u;
+
+	float toMiB(std::size_t bytes)
+	{
+		return static_cast<float>(bytes) / static_cast<float>(bytes_per_mib);
+	}
+
+	char const* getOwnerName(std::string const& owner)
+	{
+		return owner.empty() ? "(none)" : owner.c_str();
+	}
+
+	void renderUsageRow(char const* name, ResourceRegistry::Usage const& usage)
+	{
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::TextUnformatted(name);
+		ImGui::TableNextColumn();
+		ImGui::Text("%zu", usage.objects_nb);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.2f", toMiB(usage.bytes));
+	}
+
+	bool beginUsageTable(char const* id, char const* name_column)
+	{
+		if (!ImGui::BeginTable(id, 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+			return false;
+		ImGui::TableSetupColumn(name_column);
+		ImGui::TableSetupColumn("Objects", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("MiB", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableHeadersRow();
+		return true;
+	}
+}
+
+MemoryBudget::MemoryBudget(ResourceRegistry& registry) : registry(registry)
+{
+}
+
+void MemoryBudget::SetSoftLimit(std::size_t const bytes)
+{
+	soft_limit = bytes;
+}
+
+std::size_t MemoryBudget::GetSoftLimit() const
+{
+	return soft_limit;
+}
+
+void MemoryBudget::Update(std::size_t const max_drops_per_frame)
+{
+	if (soft_limit == 0u || registry.GetTotalUsage().bytes <= soft_limit)
+		return;
+	if (is_registry_exhausted && exhausted_registry_revision == registry.GetRevision())
+		return;
+
+	std::vector<ResourceRegistry::ObjectInfo> candidates;
+	for (auto& object : registry.GetObjects()) {
+		if (object.type == ResourceType::texture && object.category == ResourceCategory::textures && object.mips_size > 0u)
+			candidates.push_back(std::move(object));
+	}
+	// Least recently used first, and the largest first among those.
+	std::sort(candidates.begin(), candidates.end(),
+	          [](ResourceRegistry::ObjectInfo const& lhs, ResourceRegistry::ObjectInfo const& rhs){
+	              return lhs.last_used_frame != rhs.last_used_frame ? lhs.last_used_frame < rhs.last_used_frame
+	                                                                : lhs.size > rhs.size;
+	          });
+
+	std::size_t drops_nb = 0u;
+	for (auto const& candidate : candidates) {
+		if (drops_nb == max_drops_per_frame || registry.GetTotalUsage().bytes <= soft_limit)
+			break;
+		if (!registry.DropTopMipLevel(candidate.handle))
+			continue;
+
+		LogTrivia("Dropped the first level of texture \"%s\" to stay within the memory budget.", candidate.label.c_str());
+		++drops_nb;
+		++dropped_levels_nb;
+	}
+
+	// Dropping a level changes the revision, so this only sticks when
+	// nothing could be dropped.
+	is_registry_exhausted = drops_nb == 0u && max_drops_per_frame > 0u;
+	exhausted_registry_revision = registry.GetRevision();
+}
+
+void MemoryBudget::RenderWindow(bool* opened)
+{
+	if (!ImGui::Begin("GPU memory", opened, ImGuiWindowFlags_None)) {
+		ImGui::End();
+		return;
+	}
+
+	auto const total_usage = registry.GetTotalUsage();
+	ImGui::Text("%zu OpenGL objects, using %.2f MiB", total_usage.objects_nb, toMiB(total_usage.bytes));
+
+	auto soft_limit_mib = static_cast<int>(soft_limit / bytes_per_mib);
+	if (ImGui::SliderInt("Soft budget", &soft_limit_mib, 0, 4096, soft_limit_mib == 0 ? "Disabled" : "%d MiB"))
+		soft_limit = static_cast<std::size_t>(soft_limit_mib) * bytes_per_mib;
+	ImGui::Text("%zu mip levels dropped", dropped_levels_nb);
+	if (soft_limit > 0u && total_usage.bytes > soft_limit)
+		ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), "Over budget by %.2f MiB", toMiB(total_usage.bytes - soft_limit));
+
+	if (ImGui::CollapsingHeader("By category", ImGuiTreeNodeFlags_DefaultOpen) && beginUsageTable("categories", "Category")) {
+		for (std::uint32_t i = 0u; i < static_cast<std::uint32_t>(ResourceCategory::count); ++i) {
+			auto const category = static_cast<ResourceCategory>(i);
+			renderUsageRow(ResourceRegistry::GetCategoryName(category), registry.GetUsage(category));
+		}
+		ImGui::EndTable();
+	}
+
+	if (ImGui::CollapsingHeader("By owner", ImGuiTreeNodeFlags_DefaultOpen) && beginUsageTable("owners", "Owner")) {
+		for (auto const& owner_usage : registry.GetUsageByOwner())
+			renderUsageRow(getOwnerName(owner_usage.first), owner_usage.second);
+		ImGui::EndTable();
+	}
+
+	if (ImGui::CollapsingHeader("Largest objects")) {
+		auto objects = registry.GetObjects();
+		auto const listed_objects_nb = std::min<std::size_t>(objects.size(), 32u);
+		std::partial_sort(objects.begin(), objects.begin() + listed_objects_nb, objects.end(),
+		                  [](ResourceRegistry::ObjectInfo const& lhs, ResourceRegistry::ObjectInfo const& rhs){ return lhs.size > rhs.size; });
+		if (ImGui::BeginTable("objects", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+			ImGui::TableSetupColumn("Label");
+			ImGui::TableSetupColumn("Category", ImGuiTableColumnFlags_WidthFixed);
+			ImGui::TableSetupColumn("Owner");
+			ImGui::TableSetupColumn("MiB", ImGuiTableColumnFlags_WidthFixed);
+			ImGui::TableSetupColumn("Last used", ImGuiTableColumnFlags_WidthFixed);
+			ImGui::TableHeadersRow();
+			for (std::size_t i = 0u; i < listed_objects_nb; ++i) {
+				auto const& object = objects[i];
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(object.label.empty() ? ResourceRegistry::GetTypeName(object.type) : object.label.c_str());
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(ResourceRegistry::GetCategoryName(object.category));
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(getOwnerName(object.owner));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", toMiB(object.size));
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu frames ago", static_cast<unsigned long long>(registry.GetFrame() - object.last_used_frame));
+			}
+			ImGui::EndTable();
+		}
+	}
+
+	ImGui::End();
+}
+
+bool MemoryBudget::WriteJSON(std::string const& filename) const
+{
+	std::ofstream output(filename);
+	if (!output) {
+		LogError("Failed to open \"%s\" for writing the memory report.", filename.c_str());
+		return false;
+	}
+
+	auto const total_usage = registry.GetTotalUsage();
+	output << "{\n\t\"frame\": " << registry.GetFrame()
+	       << ",\n\t\"soft_limit_bytes\": " << soft_limit
+	       << ",\n\t\"dropped_levels_nb\": " << dropped_levels_nb
+	       << ",\n\t\"total\": { \"objects_nb\": " << total_usage.objects_nb << ", \"bytes\": " << total_usage.bytes << " }"
+	       << ",\n\t\"categories\": [";
+	for (std::uint32_t i = 0u; i < static_cast<std::uint32_t>(ResourceCategory::count); ++i) {
+		auto const category = static_cast<ResourceCategory>(i);
+		auto const usage = registry.GetUsage(category);
+		output << (i == 0u ? "\n" : ",\n")
+		       << "\t\t{ \"name\": \"" << ResourceRegistry::GetCategoryName(category) << "\""
+		       << ", \"objects_nb\": " << usage.objects_nb << ", \"bytes\": " << usage.bytes << " }";
+	}
+	output << "\n\t],\n\t\"owners\": [";
+	bool is_first = true;
+	for (auto const& owner_usage : registry.GetUsageByOwner()) {
+		output << (is_first ? "\n" : ",\n")
+		       << "\t\t{ \"name\": \"" << utils::escape_json(owner_usage.first) << "\""
+		       << ", \"objects_nb\": " << owner_usage.second.objects_nb << ", \"bytes\": " << owner_usage.second.bytes << " }";
+		is_first = false;
+	}
+	output << "\n\t],\n\t\"objects\": [";
+	auto const objects = registry.GetObjects();
+	for (std::size_t i = 0u; i < objects.size(); ++i) {
+		auto const& object = objects[i];
+		output << (i == 0u ? "\n" : ",\n")
+		       << "\t\t{ \"type\": \"" << ResourceRegistry::GetTypeName(object.type) << "\""
+		       << ", \"category\": \"" << ResourceRegistry::GetCategoryName(object.category) << "\""
+		       << ", \"owner\": \"" << utils::escape_json(object.owner) << "\", \"label\": \"" << utils::escape_json(object.label) << "\""
+		       << ", \"bytes\": " << object.size << ", \"mips_bytes\": " << object.mips_size
+		       << ", \"last_used_frame\": " << object.last_used_frame << " }";
+	}
+	output << "\n\t]\n}\n";
+
+	output.flush();
+	if (!output) {
+		LogError("Failed to write the memory usage to \"%s\".", filename.c_str());
+		return false;
+	}
+
+	LogInfo("Wrote the memory usage of %zu OpenGL objects to \"%s\".", objects.size(), filename.c_str());
+	return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ResourceRegistry.hpp"
+
+#include <cstddef>
+#include <string>
+
+//! \brief Report the video memory used by the objects of a ResourceRegistry,
+//!        and optionally enforce a soft budget on it.
+//!
+//! While the total usage exceeds the budget, textures lose their first mip
+//! level, starting from the least recently used ones, as recorded by
+//! ResourceRegistry::MarkUsed(), and the largest ones among those. The
+//! budget is soft: only mipmapped RGBA8 textures can shrink, and dropped
+//! levels are never restored, even once usage falls back under the budget.
+class MemoryBudget
+{
+public:
+	explicit MemoryBudget(ResourceRegistry& registry);
+
+	//! \brief Set the budget, in bytes; 0 disables it.
+	void SetSoftLimit(std::size_t bytes);
+	std::size_t GetSoftLimit() const;
+
+	//! \brief Enforce the budget, to be called once per frame.
+	//!
+	//! As dropping a level requires reading the texture back, at most
+	//! |max_drops_per_frame| levels are dropped per call. Once no texture
+	//! can shrink any further, nothing is attempted again until objects of
+	//! the registry change.
+	void Update(std::size_t max_drops_per_frame = 2u);
+
+	//! \brief Display the usage by category and by owner, along with the
+	//!        budget controls.
+	void RenderWindow(bool* opened = nullptr);
+
+	//! \brief Write the usage by category, by owner, and of every object to
+	//!        |filename| as JSON.
+	bool WriteJSON(std::string const& filename) const;
+
+private:
+	ResourceRegistry& registry;
+	std::size_t soft_limit{ 0u };
+	std::size_t dropped_levels_nb{ 0u };
+	bool is_registry_exhausted{ false };      //!< Whether no texture could shrink at |exhausted_registry_revision|
+	std::uint64_t exhausted_registry_revision{ 0u };
+};
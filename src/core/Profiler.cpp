@@ -0,0 +1,361 @@
+#include "Profiler.h"
+
+#include "Log.h"
+#include "various.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	struct Event
+	{
+		char const* name;
+		std::int64_t start_ns;
+		std::int64_t end_ns;
+		std::uint32_t depth;
+	};
+
+	// Once full, a buffer overwrites its oldest events.
+	constexpr std::size_t max_events_per_thread = 1u << 15;
+	// Threads spawned for a single task, like those of
+	// utils::parallel_for(), leave their buffer behind when exiting; only
+	// the most recent ones are kept.
+	constexpr std::size_t max_retired_buffers = 64u;
+
+	struct ThreadBuffer
+	{
+		// Only guards |events| and |next_event|, which are read from other
+		// threads; it is never contended otherwise.
+		std::mutex mutex;
+		std::vector<Event> events;
+		std::size_t next_event{0u};
+
+		// Only ever accessed by the owning thread.
+		std::vector<std::pair<char const*, std::int64_t>> open_scopes;
+
+		std::string name;
+		std::uint32_t id{0u};
+		bool is_retired{false};
+
+		void Push(Event const& event)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (events.size() < max_events_per_thread)
+				events.push_back(event);
+			else
+				events[next_event] = event;
+			next_event = (next_event + 1u) % max_events_per_thread;
+		}
+	};
+
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+		std::uint32_t next_thread_id{0u};
+		std::unordered_set<std::string> interned_names;
+
+		ThreadBuffer gpu_buffer;
+
+		std::int64_t frame_start_ns{0};
+		std::int64_t last_frame_start_ns{0};
+		std::int64_t last_frame_end_ns{0};
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	struct ThreadBufferHandle
+	{
+		std::shared_ptr<ThreadBuffer> buffer;
+
+		ThreadBufferHandle() : buffer(std::make_shared<ThreadBuffer>())
+		{
+			auto& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			buffer->id = registry.next_thread_id++;
+			buffer->name = "Thread " + std::to_string(buffer->id);
+			registry.buffers.push_back(buffer);
+
+			auto const retired_buffers_nb = std::count_if(registry.buffers.begin(), registry.buffers.end(),
+			                                              [](std::shared_ptr<ThreadBuffer> const& b) { return b->is_retired; });
+			if (static_cast<std::size_t>(retired_buffers_nb) > max_retired_buffers) {
+				auto const oldest_retired = std::find_if(registry.buffers.begin(), registry.buffers.end(),
+				                                         [](std::shared_ptr<ThreadBuffer> const& b) { return b->is_retired; });
+				registry.buffers.erase(oldest_retired);
+			}
+		}
+
+		~ThreadBufferHandle()
+		{
+			auto& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			buffer->is_retired = true;
+		}
+	};
+
+	ThreadBuffer& GetThreadBuffer()
+	{
+		thread_local ThreadBufferHandle handle;
+		return *handle.buffer;
+	}
+
+	void ForEachEvent(ThreadBuffer& buffer, std::function<void (Event const&)> const& callback)
+	{
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		for (auto const& event : buffer.events)
+			callback(event);
+	}
+
+	// State of the flame view, only accessed from the thread rendering the
+	// GUI.
+	struct ThreadSnapshot
+	{
+		std::string name;
+		std::vector<Event> events;
+		std::uint32_t rows_nb{0u};
+	};
+	std::vector<ThreadSnapshot> flame_view_snapshot;
+	std::int64_t flame_view_start_ns = 0;
+	std::int64_t flame_view_end_ns = 0;
+	bool is_flame_view_paused = false;
+}
+
+std::int64_t Profiler::Now()
+{
+	static auto const epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::BeginScope(char const* name)
+{
+	auto& buffer = GetThreadBuffer();
+	buffer.open_scopes.emplace_back(name, Now());
+}
+
+void Profiler::EndScope()
+{
+	auto const end_ns = Now();
+	auto& buffer = GetThreadBuffer();
+	if (buffer.open_scopes.empty()) {
+		LogWarning("Ending a profiler scope which was never begun.");
+		return;
+	}
+
+	auto const scope = buffer.open_scopes.back();
+	buffer.open_scopes.pop_back();
+	buffer.Push({ scope.first, scope.second, end_ns, static_cast<std::uint32_t>(buffer.open_scopes.size()) });
+}
+
+void Profiler::NewFrame()
+{
+	auto const now_ns = Now();
+	auto& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	registry.last_frame_start_ns = registry.frame_start_ns;
+	registry.last_frame_end_ns = now_ns;
+	registry.frame_start_ns = now_ns;
+}
+
+std::vector<Profiler::ScopeDuration> Profiler::GetLastFrameDurations()
+{
+	std::int64_t frame_start_ns = 0, frame_end_ns = 0;
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		frame_start_ns = registry.last_frame_start_ns;
+		frame_end_ns = registry.last_frame_end_ns;
+	}
+
+	std::vector<Event> frame_events;
+	ForEachEvent(GetThreadBuffer(), [&](Event const& event) {
+		if (event.start_ns >= frame_start_ns && event.end_ns <= frame_end_ns)
+			frame_events.push_back(event);
+	});
+	// Events are stored as they end, so parents come after their children.
+	std::sort(frame_events.begin(), frame_events.end(),
+	          [](Event const& lhs, Event const& rhs) { return lhs.start_ns < rhs.start_ns; });
+
+	std::vector<ScopeDuration> durations;
+	for (auto const& event : frame_events) {
+		auto const duration_ms = static_cast<float>(event.end_ns - event.start_ns) / 1000000.0f;
+		auto const same_scope = std::find_if(durations.begin(), durations.end(), [&event](ScopeDuration const& duration) {
+			return duration.depth == event.depth && std::string(duration.name) == event.name;
+		});
+		if (same_scope != durations.end())
+			same_scope->duration_ms += duration_ms;
+		else
+			durations.push_back({ event.name, event.depth, duration_ms });
+	}
+	return durations;
+}
+
+void Profiler::SetThreadName(char const* name)
+{
+	auto& buffer = GetThreadBuffer();
+	auto& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	buffer.name = name;
+}
+
+char const* Profiler::InternName(std::string const& name)
+{
+	auto& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	// Elements of an unordered_set never move once inserted.
+	return registry.interned_names.insert(name).first->c_str();
+}
+
+void Profiler::RecordGpuEvent(char const* name, std::int64_t start_ns, std::int64_t end_ns, std::uint32_t depth)
+{
+	GetRegistry().gpu_buffer.Push({ name, start_ns, end_ns, depth });
+}
+
+bool Profiler::ExportChromeTrace(std::string const& path)
+{
+	std::ofstream output(path);
+	if (!output) {
+		LogError("Failed to open \"%s\" for writing the profiler trace.", path.c_str());
+		return false;
+	}
+
+	auto& registry = GetRegistry();
+	std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		buffers = registry.buffers;
+	}
+
+	// GPU scopes go into their own process, so that they get displayed
+	// apart from the CPU threads.
+	auto const cpu_process_id = 0, gpu_process_id = 1;
+	std::size_t events_nb = 0u;
+	bool is_first_entry = true;
+	auto const write_entry = [&output, &is_first_entry](std::string const& entry) {
+		output << (is_first_entry ? "\n" : ",\n") << entry;
+		is_first_entry = false;
+	};
+	auto const write_events = [&](ThreadBuffer& buffer, int process_id, std::uint32_t thread_id) {
+		ForEachEvent(buffer, [&](Event const& event) {
+			// Timestamps and durations are expressed in microseconds.
+			write_entry("{\"name\":\"" + utils::escape_json(event.name) + "\",\"ph\":\"X\""
+			            + ",\"ts\":" + std::to_string(static_cast<double>(event.start_ns) / 1000.0)
+			            + ",\"dur\":" + std::to_string(static_cast<double>(event.end_ns - event.start_ns) / 1000.0)
+			            + ",\"pid\":" + std::to_string(process_id)
+			            + ",\"tid\":" + std::to_string(thread_id) + "}");
+			++events_nb;
+		});
+	};
+
+	output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	write_entry("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(cpu_process_id) + ",\"args\":{\"name\":\"CPU\"}}");
+	write_entry("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(gpu_process_id) + ",\"args\":{\"name\":\"GPU\"}}");
+	for (auto const& buffer : buffers) {
+		std::string name;
+		{
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			name = buffer->name;
+		}
+		write_entry("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + std::to_string(cpu_process_id)
+		            + ",\"tid\":" + std::to_string(buffer->id) + ",\"args\":{\"name\":\"" + utils::escape_json(name) + "\"}}");
+		write_events(*buffer, cpu_process_id, buffer->id);
+	}
+	write_events(registry.gpu_buffer, gpu_process_id, 0u);
+	output << "\n]}\n";
+
+	if (!output) {
+		LogError("Failed to write the profiler trace to \"%s\".", path.c_str());
+		return false;
+	}
+
+	LogInfo("Exported %zu profiler events to \"%s\".", events_nb, path.c_str());
+	return true;
+}
+
+void Profiler::RenderFlameView(bool* opened)
+{
+	if (!ImGui::Begin("Profiler", opened, ImGuiWindowFlags_None)) {
+		ImGui::End();
+		return;
+	}
+
+	auto& registry = GetRegistry();
+	if (!is_flame_view_paused) {
+		std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+		{
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			buffers = registry.buffers;
+			flame_view_start_ns = registry.last_frame_start_ns;
+			flame_view_end_ns = registry.last_frame_end_ns;
+		}
+
+		flame_view_snapshot.clear();
+		for (auto const& buffer : buffers) {
+			ThreadSnapshot snapshot;
+			ForEachEvent(*buffer, [&snapshot](Event const& event) {
+				if (event.end_ns < flame_view_start_ns || event.start_ns > flame_view_end_ns)
+					return;
+				snapshot.events.push_back(event);
+				snapshot.rows_nb = std::max(snapshot.rows_nb, event.depth + 1u);
+			});
+			if (snapshot.events.empty())
+				continue;
+
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			snapshot.name = buffer->name;
+			flame_view_snapshot.push_back(std::move(snapshot));
+		}
+	}
+
+	auto const frame_duration_ns = std::max(flame_view_end_ns - flame_view_start_ns, static_cast<std::int64_t>(1));
+	ImGui::Text("Frame CPU time: %.3f ms", static_cast<float>(frame_duration_ns) / 1000000.0f);
+	ImGui::SameLine();
+	ImGui::Checkbox("Pause", &is_flame_view_paused);
+	ImGui::SameLine();
+	if (ImGui::Button("Export Chrome trace"))
+		ExportChromeTrace("profile_trace.json");
+
+	auto const row_height = ImGui::GetTextLineHeightWithSpacing();
+	for (auto const& snapshot : flame_view_snapshot) {
+		ImGui::TextUnformatted(snapshot.name.c_str());
+
+		auto const origin = ImGui::GetCursorScreenPos();
+		auto const width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+		ImGui::InvisibleButton(snapshot.name.c_str(), ImVec2(width, row_height * static_cast<float>(snapshot.rows_nb)));
+		auto const is_hovered = ImGui::IsItemHovered();
+
+		auto* const draw_list = ImGui::GetWindowDrawList();
+		for (auto const& event : snapshot.events) {
+			auto const start = static_cast<float>(std::max(event.start_ns, flame_view_start_ns) - flame_view_start_ns) / static_cast<float>(frame_duration_ns);
+			auto const end = static_cast<float>(std::min(event.end_ns, flame_view_end_ns) - flame_view_start_ns) / static_cast<float>(frame_duration_ns);
+			auto const min = ImVec2(origin.x + start * width, origin.y + static_cast<float>(event.depth) * row_height);
+			auto const max = ImVec2(std::max(origin.x + end * width, min.x + 1.0f), min.y + row_height - 1.0f);
+
+			// Colour scopes by name, so that a same scope can be followed
+			// from one frame to the next.
+			auto const hue = static_cast<float>(std::hash<std::string>()(event.name) % 360u) / 360.0f;
+			draw_list->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.75f));
+			draw_list->PushClipRect(min, max, true);
+			draw_list->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_BLACK, event.name);
+			draw_list->PopClipRect();
+
+			if (is_hovered && ImGui::IsMouseHoveringRect(min, max))
+				ImGui::SetTooltip("%s: %.3f ms", event.name, static_cast<float>(event.end_ns - event.start_ns) / 1000000.0f);
+		}
+	}
+
+	ImGui::End();
+}
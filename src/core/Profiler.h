@@ -0,0 +1,74 @@
+/*
+ * Hierarchical CPU scope profiler
+ */
+
+#include "BuildSettings.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#pragma once
+
+namespace Profiler {
+
+/** Time elapsed since the profiler was first used, in nanoseconds */
+std::int64_t Now();
+
+/** Open a scope on the calling thread; |name| must outlive the profiler, like a string literal or an interned name */
+void BeginScope(char const* name);
+/** Close the most recently opened scope of the calling thread */
+void EndScope();
+
+/** Mark the beginning of a new frame; the flame view displays the last complete frame */
+void NewFrame();
+
+struct ScopeDuration {
+	char const*		name;
+	std::uint32_t	depth;
+	float			duration_ms;
+};
+/** Return the total duration of each scope of the calling thread over the last complete frame, in the order they were
+ *  started; this goes through all of the thread's events, so it is meant for benchmarks rather than for every frame */
+std::vector<ScopeDuration> GetLastFrameDurations();
+
+/** Name the calling thread in the flame view and the exported traces */
+void SetThreadName(char const* name);
+
+/** Return a copy of |name| which lives as long as the profiler, for names built at runtime */
+char const* InternName(std::string const& name);
+
+/** Record a scope measured on the GPU; timings should have been converted to the profiler's clock */
+void RecordGpuEvent(char const* name, std::int64_t start_ns, std::int64_t end_ns, std::uint32_t depth);
+
+/** Write all events still held by the profiler, CPU and GPU ones alike, to a JSON file
+ *  which can be opened in chrome://tracing or Perfetto */
+bool ExportChromeTrace(std::string const& path);
+
+/** Display the scopes of the last complete frame, one row per nesting level and per thread */
+void RenderFlameView(bool* opened = nullptr);
+
+class Scope {
+public:
+	explicit Scope(char const* name) { BeginScope(name); }
+	~Scope() { EndScope(); }
+	Scope(Scope const&) = delete;
+	Scope& operator=(Scope const&) = delete;
+};
+
+};
+
+#define PROFILER_CONCATENATE_IMPL(a, b)	a##b
+#define PROFILER_CONCATENATE(a, b)		PROFILER_CONCATENATE_IMPL(a, b)
+
+#if defined ENABLE_PROFILING && ENABLE_PROFILING != 0
+#	define ProfileScope(name)			Profiler::Scope PROFILER_CONCATENATE(profiler_scope_, __LINE__)(name)
+#	define ProfileFunction()			ProfileScope(__FUNCTION__)
+#	define ProfileNewFrame()			Profiler::NewFrame()
+#	define ProfileThreadName(name)		Profiler::SetThreadName(name)
+#else
+#	define ProfileScope(name)
+#	define ProfileFunction()
+#	define ProfileNewFrame()
+#	define ProfileThreadName(name)
+#endif
@@ -0,0 +1,158 @@
+#include "ProgramBinaryCache.hpp"
+
+#include "Log.h"
+#include "various.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace
+{
+	// Bump whenever the layout of the cache files changes.
+	constexpr std::uint32_t file_magic = 0x42505343u; // "CSPB", little-endian
+	constexpr std::uint32_t file_version = 1u;
+
+	struct FileHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint64_t key;
+		std::uint32_t format;
+		std::uint32_t length;
+	};
+
+	void hashString(std::uint64_t& hash, std::string const& string)
+	{
+		// Hash the length too, so that {"ab", "c"} and {"a", "bc"} differ.
+		auto const length = static_cast<std::uint64_t>(string.size());
+		hash = utils::hash_fnv1a(&length, sizeof(length), hash);
+		hash = utils::hash_fnv1a(string.data(), string.size(), hash);
+	}
+
+	std::string getString(GLenum name)
+	{
+		auto const string = reinterpret_cast<char const*>(glGetString(name));
+		return string != nullptr ? std::string(string) : std::string();
+	}
+}
+
+ProgramBinaryCache::ProgramBinaryCache(std::string directory) : directory(std::move(directory))
+{
+	driver_identification = getString(GL_VENDOR) + '\n' + getString(GL_RENDERER) + '\n'
+	                       + getString(GL_VERSION) + '\n' + getString(GL_SHADING_LANGUAGE_VERSION);
+
+	GLint formats_nb = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats_nb);
+	if (formats_nb <= 0) {
+		LogInfo("The driver does not expose any program binary format: programs will always be built from source.");
+		return;
+	}
+	supported_formats.resize(static_cast<std::size_t>(formats_nb));
+	glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, supported_formats.data());
+
+#if defined(_WIN32)
+	_wmkdir(utils::widen(this->directory).c_str());
+#else
+	mkdir(this->directory.c_str(), 0755);
+#endif
+}
+
+bool ProgramBinaryCache::IsSupported() const
+{
+	return !supported_formats.empty();
+}
+
+std::uint64_t ProgramBinaryCache::ComputeKey(std::vector<std::string> const& sources) const
+{
+	auto hash = utils::hash_fnv1a(nullptr, 0u);
+	hashString(hash, driver_identification);
+	for (auto const& source : sources)
+		hashString(hash, source);
+	return hash;
+}
+
+GLuint ProgramBinaryCache::Load(std::uint64_t key) const
+{
+	if (!IsSupported())
+		return 0u;
+
+	auto const filename = GetFilename(key);
+	std::ifstream input(utils::widen(filename), std::ios::binary);
+	if (!input)
+		return 0u;
+
+	FileHeader header{};
+	std::vector<char> binary;
+	auto const is_header_valid = input.read(reinterpret_cast<char*>(&header), sizeof(header))
+	                          && header.magic == file_magic && header.version == file_version && header.key == key;
+	if (is_header_valid) {
+		binary.resize(header.length);
+		input.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+	}
+	auto const is_format_supported = std::find(supported_formats.begin(), supported_formats.end(),
+	                                           static_cast<GLint>(header.format)) != supported_formats.end();
+	if (!is_header_valid || !input || !is_format_supported) {
+		LogTrivia("Discarding stale program binary \"%s\".", filename.c_str());
+		input.close();
+		std::remove(filename.c_str());
+		return 0u;
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, static_cast<GLenum>(header.format), binary.data(), static_cast<GLsizei>(binary.size()));
+	GLint state = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &state);
+	if (state == GL_FALSE) {
+		// Drivers are allowed to reject binaries for any reason, so this
+		// is not an error: the program will simply be rebuilt.
+		LogTrivia("The driver rejected program binary \"%s\".", filename.c_str());
+		glDeleteProgram(program);
+		input.close();
+		std::remove(filename.c_str());
+		return 0u;
+	}
+
+	return program;
+}
+
+void ProgramBinaryCache::Store(std::uint64_t key, GLuint program) const
+{
+	if (!IsSupported() || program == 0u)
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(static_cast<std::size_t>(length));
+	GLenum format = 0u;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	binary.resize(static_cast<std::size_t>(length));
+
+	auto const filename = GetFilename(key);
+	std::ofstream output(utils::widen(filename), std::ios::binary);
+	FileHeader const header{ file_magic, file_version, key, static_cast<std::uint32_t>(format), static_cast<std::uint32_t>(binary.size()) };
+	output.write(reinterpret_cast<char const*>(&header), sizeof(header));
+	output.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+	if (!output) {
+		LogWarning("Failed to write program binary \"%s\".", filename.c_str());
+		output.close();
+		std::remove(filename.c_str());
+	}
+}
+
+std::string ProgramBinaryCache::GetFilename(std::uint64_t key) const
+{
+	char name[17];
+	std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+	return directory + "/" + name + ".bin";
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! \brief Store linked programs on disk, so that later runs can skip
+//!        compiling and linking them.
+//!
+//! Binaries are keyed by a hash of everything which affects them: the
+//! sources fed to the driver, and the vendor, renderer and version strings
+//! of the driver itself, as binaries are only valid for the exact driver
+//! which produced them. A binary which the driver rejects anyway, for
+//! example after an update not reflected in those strings, is silently
+//! discarded and the caller falls back to building from source.
+class ProgramBinaryCache
+{
+public:
+	//! \brief Create a cache storing its binaries in |directory|, which is
+	//!        created if missing; an OpenGL context must be current.
+	explicit ProgramBinaryCache(std::string directory = "shader_cache");
+
+	//! \brief Whether the driver supports retrieving at least one binary
+	//!        format; if not, loading always fails and storing does nothing.
+	bool IsSupported() const;
+
+	//! \brief Hash |sources| along with the driver identification strings.
+	//!
+	//! @param [in] sources All inputs to the program, like the shader
+	//!             types, sources and preprocessor defines, in a stable
+	//!             order
+	std::uint64_t ComputeKey(std::vector<std::string> const& sources) const;
+
+	//! \brief Create a program from the binary stored under |key|.
+	//!
+	//! @return The linked program, or 0 if there was no usable binary
+	GLuint Load(std::uint64_t key) const;
+
+	//! \brief Store the binary of |program| under |key|; |program| must have
+	//!        been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+	void Store(std::uint64_t key, GLuint program) const;
+
+private:
+	std::string GetFilename(std::uint64_t key) const;
+
+	std::string directory;
+	std::string driver_identification;
+	std::vector<GLint> supported_formats;
+};
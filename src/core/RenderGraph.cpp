@@ -0,0 +1,397 @@
+#include "RenderGraph.hpp"
+
+#include "GpuTimer.hpp"
+#include "Log.h"
+#include "opengl.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	constexpr std::size_t no_pass = std::numeric_limits<std::size_t>::max();
+	// The minimum value of GL_MAX_DRAW_BUFFERS.
+	constexpr std::uint32_t max_colour_attachments = 8u;
+
+	void setCapability(GLenum capability, bool is_enabled)
+	{
+		if (is_enabled)
+			glEnable(capability);
+		else
+			glDisable(capability);
+	}
+
+	void applyState(RenderPassState const& state)
+	{
+		setCapability(GL_DEPTH_TEST, state.depth_test);
+		glDepthFunc(state.depth_func);
+		glDepthMask(state.depth_write ? GL_TRUE : GL_FALSE);
+		auto const colour_mask = state.colour_write ? GL_TRUE : GL_FALSE;
+		glColorMask(colour_mask, colour_mask, colour_mask, colour_mask);
+		setCapability(GL_CULL_FACE, state.cull_face);
+		glCullFace(state.cull_face_mode);
+		setCapability(GL_BLEND, state.blend);
+		glBlendEquationSeparate(state.blend_equation_rgb, state.blend_equation_alpha);
+		glBlendFuncSeparate(state.blend_src_rgb, state.blend_dst_rgb, state.blend_src_alpha, state.blend_dst_alpha);
+	}
+
+	std::string listResourceNames(std::vector<RenderGraph::Resource> const& list, std::function<std::string (RenderGraph::Resource)> const& get_name)
+	{
+		std::string names;
+		for (auto const& resource : list)
+			names += (names.empty() ? "" : ", ") + get_name(resource);
+		return names.empty() ? "nothing" : names;
+	}
+}
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph, std::size_t const pass_index) : graph(graph), pass_index(pass_index)
+{
+}
+
+void RenderGraph::PassBuilder::Read(Resource const resource)
+{
+	auto& pass = graph.passes[pass_index];
+	if (!graph.IsDeclared(resource)) {
+		LogError("Pass \"%s\" reads an undeclared resource.", pass.name.c_str());
+		return;
+	}
+	pass.reads.push_back(resource);
+}
+
+RenderGraph::Resource RenderGraph::PassBuilder::Write(Resource const resource)
+{
+	return graph.AddWrite(pass_index, resource);
+}
+
+RenderGraph::Resource RenderGraph::PassBuilder::WriteColour(std::uint32_t const location, Resource const resource)
+{
+	auto& pass = graph.passes[pass_index];
+	if (location >= max_colour_attachments) {
+		LogError("Pass \"%s\" writes to colour attachment %u, but at most %u are supported.", pass.name.c_str(), location, max_colour_attachments);
+		return Resource();
+	}
+
+	auto const written = graph.AddWrite(pass_index, resource);
+	if (!written.IsValid())
+		return written;
+	if (pass.colour_attachments.size() <= location)
+		pass.colour_attachments.resize(location + 1u);
+	pass.colour_attachments[location] = written;
+	return written;
+}
+
+RenderGraph::Resource RenderGraph::PassBuilder::WriteDepth(Resource const resource)
+{
+	auto const written = graph.AddWrite(pass_index, resource);
+	if (written.IsValid())
+		graph.passes[pass_index].depth_attachment = written;
+	return written;
+}
+
+void RenderGraph::PassBuilder::ReadDepth(Resource const resource)
+{
+	Read(resource);
+	if (graph.IsDeclared(resource))
+		graph.passes[pass_index].depth_attachment = resource;
+}
+
+void RenderGraph::PassBuilder::WriteDefaultFramebuffer()
+{
+	graph.passes[pass_index].writes_default_framebuffer = true;
+}
+
+void RenderGraph::PassBuilder::SetState(RenderPassState const& state)
+{
+	graph.passes[pass_index].state = state;
+}
+
+RenderGraph::PassContext::PassContext(RenderGraph& graph, GLuint const framebuffer) : graph(graph), framebuffer(framebuffer)
+{
+}
+
+GLuint RenderGraph::PassContext::GetTexture(Resource const resource) const
+{
+	if (!graph.IsDeclared(resource)) {
+		LogError("Can not get the texture of an undeclared resource.");
+		return 0u;
+	}
+	return graph.resources[resource.index].texture;
+}
+
+glm::uvec2 RenderGraph::PassContext::GetSize(Resource const resource) const
+{
+	return graph.GetSize(resource);
+}
+
+GLuint RenderGraph::PassContext::GetFramebuffer() const
+{
+	return framebuffer;
+}
+
+GLuint RenderGraph::PassContext::GetFramebuffer(std::vector<Resource> const& colour_attachments, Resource const depth_attachment) const
+{
+	std::vector<GLuint> textures;
+	std::string label;
+	for (auto const& attachment : colour_attachments) {
+		textures.push_back(attachment.IsValid() ? GetTexture(attachment) : 0u);
+		if (attachment.IsValid())
+			label += (label.empty() ? "" : ", ") + graph.resources[attachment.index].name;
+	}
+	return graph.pool.GetFramebuffer(textures, depth_attachment.IsValid() ? GetTexture(depth_attachment) : 0u, label);
+}
+
+RenderGraph::RenderGraph(RenderTargetPool& pool) : pool(pool)
+{
+}
+
+void RenderGraph::Clear()
+{
+	resources.clear();
+	passes.clear();
+	is_compiled = false;
+}
+
+RenderGraph::Resource RenderGraph::CreateTarget(std::string const& name, RenderTargetDesc const& desc)
+{
+	resources.push_back({ name, desc, false, 0u, glm::uvec2(0u), { no_pass }, no_pass, 0u, 0u });
+	is_compiled = false;
+
+	Resource resource;
+	resource.index = static_cast<std::uint32_t>(resources.size() - 1u);
+	return resource;
+}
+
+RenderGraph::Resource RenderGraph::Import(std::string const& name, GLuint const texture, glm::uvec2 const& size)
+{
+	resources.push_back({ name, RenderTargetDesc(), true, texture, size, { no_pass }, no_pass, 0u, texture });
+	is_compiled = false;
+
+	Resource resource;
+	resource.index = static_cast<std::uint32_t>(resources.size() - 1u);
+	return resource;
+}
+
+void RenderGraph::AddPass(std::string const& name, SetupFunction const& setup, ExecuteFunction execute)
+{
+	PassNode pass;
+	pass.name = name;
+	pass.execute = std::move(execute);
+	pass.writes_default_framebuffer = false;
+	pass.is_culled = false;
+	passes.push_back(std::move(pass));
+	is_compiled = false;
+
+	PassBuilder builder(*this, passes.size() - 1u);
+	setup(builder);
+}
+
+bool RenderGraph::Compile()
+{
+	is_compiled = false;
+
+	// Walking backwards, a pass is kept if it renders to the default
+	// framebuffer, or if a pass kept reads any version it produced.
+	for (auto& pass : passes)
+		pass.is_culled = !pass.writes_default_framebuffer;
+	for (std::size_t i = passes.size(); i-- > 0u;) {
+		if (passes[i].is_culled)
+			continue;
+		for (auto const& read : passes[i].reads) {
+			auto const producer = resources[read.index].producers[read.version];
+			if (producer != no_pass)
+				passes[producer].is_culled = false;
+		}
+	}
+
+	// All versions of a resource share the same texture, so once a pass
+	// writes over a version, no other pass can use that version anymore.
+	bool is_valid = true;
+	std::vector<std::vector<std::size_t>> overwriters(resources.size());
+	for (std::size_t i = 0u; i < resources.size(); ++i)
+		overwriters[i].assign(resources[i].producers.size(), no_pass);
+	for (std::size_t i = 0u; i < passes.size(); ++i) {
+		auto const& pass = passes[i];
+		if (pass.is_culled)
+			continue;
+
+		if (pass.writes_default_framebuffer && (!pass.colour_attachments.empty() || pass.depth_attachment.IsValid())) {
+			LogError("Pass \"%s\" renders to the default framebuffer, and can therefore not have attachments.", pass.name.c_str());
+			is_valid = false;
+		}
+		for (auto const& read : pass.reads) {
+			auto const overwriter = overwriters[read.index][read.version];
+			if (overwriter == no_pass || overwriter == i)
+				continue;
+			LogError("Pass \"%s\" uses version %u of \"%s\", which pass \"%s\" already wrote over.",
+			         pass.name.c_str(), read.version, resources[read.index].name.c_str(), passes[overwriter].name.c_str());
+			is_valid = false;
+		}
+		for (auto const& written_over : pass.written_over)
+			overwriters[written_over.index][written_over.version] = i;
+	}
+	if (!is_valid)
+		return false;
+
+	for (auto& resource : resources) {
+		resource.first_pass = no_pass;
+		resource.last_pass = 0u;
+	}
+	for (std::size_t i = 0u; i < passes.size(); ++i) {
+		if (passes[i].is_culled)
+			continue;
+		for (auto const* const list : { &passes[i].reads, &passes[i].writes }) {
+			for (auto const& used : *list) {
+				auto& resource = resources[used.index];
+				if (resource.first_pass == no_pass)
+					resource.first_pass = i;
+				resource.last_pass = i;
+			}
+		}
+	}
+
+	statistics.passes_nb = passes.size();
+	statistics.culled_passes_nb = static_cast<std::size_t>(std::count_if(passes.begin(), passes.end(), [](PassNode const& p) { return p.is_culled; }));
+	statistics.transient_targets_nb = static_cast<std::size_t>(std::count_if(resources.begin(), resources.end(), [](ResourceNode const& r) {
+		return !r.is_imported && r.first_pass != no_pass;
+	}));
+
+	is_compiled = true;
+	return true;
+}
+
+void RenderGraph::Execute(GpuTimer* const gpu_timer)
+{
+	if (!is_compiled) {
+		LogError("The render graph has to be compiled successfully before being executed.");
+		return;
+	}
+
+	std::vector<GLuint> textures;
+	for (std::size_t i = 0u; i < passes.size(); ++i) {
+		auto const& pass = passes[i];
+		if (pass.is_culled)
+			continue;
+
+		// Targets released by earlier passes are handed out again by the
+		// pool, which is how they get aliased.
+		for (auto& resource : resources) {
+			if (resource.is_imported || resource.first_pass != i)
+				continue;
+			resource.texture = pool.Acquire(resource.desc, resource.name);
+			resource.last_texture = resource.texture;
+			if (std::find(textures.begin(), textures.end(), resource.texture) == textures.end())
+				textures.push_back(resource.texture);
+		}
+
+		utils::opengl::debug::beginDebugGroup(pass.name);
+		if (gpu_timer != nullptr)
+			gpu_timer->BeginScope(pass.name);
+
+		auto const framebuffer = BindFramebuffer(pass);
+		applyState(pass.state);
+		pass.execute(PassContext(*this, framebuffer));
+
+		if (gpu_timer != nullptr)
+			gpu_timer->EndScope();
+		utils::opengl::debug::endDebugGroup();
+
+		for (auto& resource : resources) {
+			if (resource.is_imported || resource.first_pass == no_pass || resource.last_pass != i)
+				continue;
+			pool.Release(resource.texture);
+			resource.texture = 0u;
+		}
+	}
+
+	applyState(RenderPassState());
+	glBindFramebuffer(GL_FRAMEBUFFER, 0u);
+	statistics.textures_nb = textures.size();
+}
+
+void RenderGraph::LogReport() const
+{
+	LogInfo("Render graph of %zu passes, %zu of them culled:", passes.size(), statistics.culled_passes_nb);
+	auto const get_name = [this](Resource resource) {
+		return resources[resource.index].name + " (v" + std::to_string(resource.version) + ")";
+	};
+	for (auto const& pass : passes) {
+		LogInfo("  %s%s: reads %s; writes %s%s", pass.name.c_str(), pass.is_culled ? " [culled]" : "",
+		        listResourceNames(pass.reads, get_name).c_str(), listResourceNames(pass.writes, get_name).c_str(),
+		        pass.writes_default_framebuffer ? " and the default framebuffer" : "");
+	}
+	LogInfo("Transient targets, in %zu textures:", statistics.textures_nb);
+	for (auto const& resource : resources) {
+		if (resource.is_imported || resource.first_pass == no_pass)
+			continue;
+		LogInfo("  %s: texture %u, from \"%s\" to \"%s\"", resource.name.c_str(), resource.last_texture,
+		        passes[resource.first_pass].name.c_str(), passes[resource.last_pass].name.c_str());
+	}
+}
+
+RenderGraph::Statistics const& RenderGraph::GetStatistics() const
+{
+	return statistics;
+}
+
+bool RenderGraph::IsDeclared(Resource const resource) const
+{
+	return resource.index < resources.size() && resource.version < resources[resource.index].producers.size();
+}
+
+glm::uvec2 RenderGraph::GetSize(Resource const resource) const
+{
+	if (!IsDeclared(resource))
+		return glm::uvec2(0u);
+	auto const& node = resources[resource.index];
+	return node.is_imported ? node.imported_size : pool.GetSize(node.desc);
+}
+
+RenderGraph::Resource RenderGraph::AddWrite(std::size_t const pass_index, Resource const resource)
+{
+	auto& pass = passes[pass_index];
+	if (!IsDeclared(resource)) {
+		LogError("Pass \"%s\" writes to an undeclared resource.", pass.name.c_str());
+		return Resource();
+	}
+
+	// The previous content is kept, so the pass depends on its producer.
+	auto& node = resources[resource.index];
+	pass.reads.push_back(resource);
+	pass.written_over.push_back(resource);
+
+	Resource written;
+	written.index = resource.index;
+	written.version = static_cast<std::uint32_t>(node.producers.size());
+	node.producers.push_back(pass_index);
+	pass.writes.push_back(written);
+	return written;
+}
+
+GLuint RenderGraph::BindFramebuffer(PassNode const& pass)
+{
+	if (pass.writes_default_framebuffer) {
+		auto const size = pool.GetReferenceSize();
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0u);
+		glViewport(0, 0, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y));
+		return 0u;
+	}
+	// Passes without attachments bind their own framebuffers.
+	if (pass.colour_attachments.empty() && !pass.depth_attachment.IsValid())
+		return 0u;
+
+	std::vector<GLuint> colour_attachments;
+	auto size = glm::uvec2(0u);
+	for (auto const& attachment : pass.colour_attachments) {
+		colour_attachments.push_back(attachment.IsValid() ? resources[attachment.index].texture : 0u);
+		if (attachment.IsValid() && size.x == 0u)
+			size = GetSize(attachment);
+	}
+	auto const depth_attachment = pass.depth_attachment.IsValid() ? resources[pass.depth_attachment.index].texture : 0u;
+	if (pass.depth_attachment.IsValid() && size.x == 0u)
+		size = GetSize(pass.depth_attachment);
+
+	auto const framebuffer = pool.GetFramebuffer(colour_attachments, depth_attachment, pass.name);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y));
+	return framebuffer;
+}
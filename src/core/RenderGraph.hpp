@@ -0,0 +1,228 @@
+#pragma once
+
+#include "RenderTargetPool.hpp"
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class GpuTimer;
+
+//! \brief A version of a resource of a RenderGraph.
+struct RenderGraphResource
+{
+	static constexpr std::uint32_t invalid_index = 0xffffffffu;
+
+	std::uint32_t index{ invalid_index };
+	std::uint32_t version{ 0u };
+
+	bool IsValid() const { return index != invalid_index; }
+};
+
+//! \brief Fixed-function state a render graph pass is executed with.
+//!
+//! The default values match the state the graph leaves behind once done.
+struct RenderPassState
+{
+	bool depth_test{ true };
+	GLenum depth_func{ GL_LESS };
+	bool depth_write{ true };
+	bool colour_write{ true };
+	bool cull_face{ true };
+	GLenum cull_face_mode{ GL_BACK };
+	bool blend{ false };
+	GLenum blend_equation_rgb{ GL_FUNC_ADD };
+	GLenum blend_equation_alpha{ GL_FUNC_ADD };
+	GLenum blend_src_rgb{ GL_ONE };
+	GLenum blend_dst_rgb{ GL_ZERO };
+	GLenum blend_src_alpha{ GL_ONE };
+	GLenum blend_dst_alpha{ GL_ZERO };
+};
+
+//! \brief Schedule the passes of a frame from what each of them reads and
+//!        writes.
+//!
+//! Passes are added along with a setup function, called right away, which
+//! declares the resources the pass uses, and an execute function, called
+//! by Execute(). Every write produces a new version of the resource
+//! written, which later passes then read or write in turn; as a pass can
+//! only refer to versions produced by passes added before it, passes run
+//! in the order they were added.
+//!
+//! Compile() culls every pass whose output ends up unused: only passes
+//! writing to the default framebuffer, and the passes they transitively
+//! depend on, are kept. Transient targets, which only live within the
+//! graph, are acquired from a RenderTargetPool right before their first
+//! use and released right after their last one, so that targets whose
+//! lifetimes do not overlap share the same texture.
+//!
+//! When executing a pass, the graph binds a framebuffer with the targets
+//! written or depth-tested as attachments, sets the viewport to their size,
+//! applies the RenderPassState of the pass and, if given a GpuTimer, opens
+//! a scope named after the pass.
+//!
+//! The graph is meant to be cleared and declared anew every frame.
+class RenderGraph
+{
+public:
+	using Resource = RenderGraphResource;
+
+	//! \brief Declare the resources used by a pass.
+	class PassBuilder
+	{
+	public:
+		//! \brief Sample |resource| from a shader, or read it any other
+		//!        way.
+		void Read(Resource resource);
+
+		//! \brief Modify |resource| in a way the graph does not know
+		//!        about, for example through a framebuffer of the pass.
+		//!
+		//! @return The version of the resource produced by the pass
+		Resource Write(Resource resource);
+
+		//! \brief Render to |resource| through fragment shader output
+		//!        |location|; its previous content is kept.
+		//!
+		//! @return The version of the resource produced by the pass
+		Resource WriteColour(std::uint32_t location, Resource resource);
+
+		//! \brief Use |resource| as the depth buffer, with depth writes
+		//!        enabled; its previous content is kept.
+		//!
+		//! @return The version of the resource produced by the pass
+		Resource WriteDepth(Resource resource);
+
+		//! \brief Use |resource| as the depth buffer, for depth testing
+		//!        only; the state of the pass should disable depth writes.
+		void ReadDepth(Resource resource);
+
+		//! \brief Render to the default framebuffer; such passes are never
+		//!        culled, and cannot have any attachment.
+		void WriteDefaultFramebuffer();
+
+		void SetState(RenderPassState const& state);
+
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, std::size_t pass_index);
+
+		RenderGraph& graph;
+		std::size_t pass_index;
+	};
+
+	//! \brief Give access to the OpenGL objects of a pass being executed.
+	class PassContext
+	{
+	public:
+		//! \brief Return the texture backing |resource|, which must have
+		//!        been declared by the pass.
+		GLuint GetTexture(Resource resource) const;
+		glm::uvec2 GetSize(Resource resource) const;
+
+		//! \brief Return the framebuffer bound for the pass: 0 if it
+		//!        renders to the default framebuffer or has no attachment.
+		GLuint GetFramebuffer() const;
+
+		//! \brief Return a framebuffer with the given resources attached,
+		//!        for example to read from them through blits.
+		GLuint GetFramebuffer(std::vector<Resource> const& colour_attachments, Resource depth_attachment = Resource()) const;
+
+	private:
+		friend class RenderGraph;
+		PassContext(RenderGraph& graph, GLuint framebuffer);
+
+		RenderGraph& graph;
+		GLuint framebuffer;
+	};
+
+	struct Statistics
+	{
+		std::size_t passes_nb = 0u;
+		std::size_t culled_passes_nb = 0u;
+		std::size_t transient_targets_nb = 0u;  //!< Used by the passes kept
+		std::size_t textures_nb = 0u;           //!< Distinct textures backing those targets
+	};
+
+	using SetupFunction = std::function<void (PassBuilder& builder)>;
+	using ExecuteFunction = std::function<void (PassContext const& context)>;
+
+	explicit RenderGraph(RenderTargetPool& pool);
+	RenderGraph(RenderGraph const&) = delete;
+	RenderGraph& operator=(RenderGraph const&) = delete;
+
+	//! \brief Forget all passes and resources, to declare a new frame.
+	void Clear();
+
+	//! \brief Declare a target, sized and allocated by the pool when the
+	//!        graph gets executed.
+	Resource CreateTarget(std::string const& name, RenderTargetDesc const& desc);
+
+	//! \brief Declare a texture living outside of the graph, like one
+	//!        whose content is kept across frames.
+	//!
+	//! @param [in] size Used for the viewport when |texture| is attached
+	Resource Import(std::string const& name, GLuint texture, glm::uvec2 const& size);
+
+	void AddPass(std::string const& name, SetupFunction const& setup, ExecuteFunction execute);
+
+	//! \brief Cull unused passes, check for hazards, and compute the
+	//!        lifetime of transient targets.
+	//!
+	//! @return Whether the graph can be executed
+	bool Compile();
+
+	//! \brief Run all passes kept by Compile().
+	void Execute(GpuTimer* gpu_timer = nullptr);
+
+	//! \brief Log every pass, and what they read and write, along with the
+	//!        textures backing transient targets in the latest execution.
+	void LogReport() const;
+
+	//! \brief Return the statistics of the latest execution.
+	Statistics const& GetStatistics() const;
+
+private:
+	struct ResourceNode
+	{
+		std::string name;
+		RenderTargetDesc desc;
+		bool is_imported;
+		GLuint texture;                     //!< Only set while in use, for transient targets
+		glm::uvec2 imported_size;
+		std::vector<std::size_t> producers; //!< Pass producing each version, or no_pass
+		std::size_t first_pass;
+		std::size_t last_pass;
+		GLuint last_texture;                //!< Texture used in the latest execution
+	};
+
+	struct PassNode
+	{
+		std::string name;
+		ExecuteFunction execute;
+		RenderPassState state;
+		std::vector<Resource> reads;        //!< Including the versions written over
+		std::vector<Resource> written_over;
+		std::vector<Resource> writes;
+		std::vector<Resource> colour_attachments;
+		Resource depth_attachment;
+		bool writes_default_framebuffer;
+		bool is_culled;
+	};
+
+	bool IsDeclared(Resource resource) const;
+	glm::uvec2 GetSize(Resource resource) const;
+	Resource AddWrite(std::size_t pass_index, Resource resource);
+	GLuint BindFramebuffer(PassNode const& pass);
+
+	RenderTargetPool& pool;
+	std::vector<ResourceNode> resources;
+	std::vector<PassNode> passes;
+	bool is_compiled{ false };
+	Statistics statistics;
+};
@@ -0,0 +1,191 @@
+#include "RenderTargetPool.hpp"
+
+#include "helpers.hpp"
+#include "Log.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+namespace
+{
+	// Targets survive a few frames unused, so that ones only needed
+	// every other frame do not get recreated all the time.
+	constexpr std::uint64_t unused_frames_before_destruction = 3u;
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	ReleaseAll();
+	Trim();
+}
+
+void RenderTargetPool::SetReferenceSize(glm::uvec2 const& size)
+{
+	// Minimised windows report a size of 0.
+	reference_size = glm::max(size, glm::uvec2(1u));
+}
+
+glm::uvec2 RenderTargetPool::GetReferenceSize() const
+{
+	return reference_size;
+}
+
+glm::uvec2 RenderTargetPool::GetSize(RenderTargetDesc const& desc) const
+{
+	if (desc.fixed_size.x != 0u && desc.fixed_size.y != 0u)
+		return desc.fixed_size;
+
+	auto const scaled_size = glm::round(glm::vec2(reference_size) * desc.scale);
+	return glm::max(glm::uvec2(scaled_size), glm::uvec2(1u));
+}
+
+void RenderTargetPool::NewFrame()
+{
+	++frame;
+	DestroyTargets(unused_frames_before_destruction);
+}
+
+GLuint RenderTargetPool::Acquire(RenderTargetDesc const& desc, std::string const& label)
+{
+	auto& registry = bonobo::getResourceRegistry();
+	auto const size = GetSize(desc);
+
+	auto const target = std::find_if(targets.begin(), targets.end(), [&desc, &size](Target const& t) {
+		return !t.is_acquired && t.size == size && t.desc.internal_format == desc.internal_format;
+	});
+	if (target != targets.end()) {
+		target->is_acquired = true;
+		target->last_used_frame = frame;
+		auto const handle = registry.Find(ResourceType::texture, target->texture);
+		if (registry.GetLabel(handle) != label)
+			registry.SetLabel(handle, label);
+		return target->texture;
+	}
+
+	auto const texture = bonobo::createTexture(size.x, size.y, GL_TEXTURE_2D, desc.internal_format, desc.format, desc.type);
+	if (texture == 0u) {
+		LogError("Failed to create render target \"%s\".", label.c_str());
+		return 0u;
+	}
+	auto const handle = registry.Find(ResourceType::texture, texture);
+	registry.SetLabel(handle, label);
+	registry.SetCategory(handle, ResourceCategory::render_targets);
+
+	targets.push_back({ texture, desc, size, true, frame });
+	++created_targets_nb;
+	return texture;
+}
+
+void RenderTargetPool::Release(GLuint const texture)
+{
+	auto const target = std::find_if(targets.begin(), targets.end(), [texture](Target const& t) { return t.texture == texture; });
+	if (target == targets.end()) {
+		LogError("Texture %u does not belong to the render target pool.", texture);
+		return;
+	}
+	target->is_acquired = false;
+}
+
+void RenderTargetPool::ReleaseAll()
+{
+	for (auto& target : targets)
+		target.is_acquired = false;
+}
+
+GLuint RenderTargetPool::GetFramebuffer(std::vector<GLuint> const& colour_attachments, GLuint const depth_attachment, std::string const& label)
+{
+	auto const cached_framebuffer = std::find_if(framebuffers.begin(), framebuffers.end(), [&colour_attachments, depth_attachment](Framebuffer const& f) {
+		return f.colour_attachments == colour_attachments && f.depth_attachment == depth_attachment;
+	});
+	if (cached_framebuffer != framebuffers.end()) {
+		cached_framebuffer->last_used_frame = frame;
+		return cached_framebuffer->fbo;
+	}
+
+	GLint previous_draw_framebuffer = 0, previous_read_framebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_draw_framebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read_framebuffer);
+
+	GLuint fbo = 0u;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	std::vector<GLenum> draw_buffers(colour_attachments.size(), GL_NONE);
+	for (std::size_t i = 0u; i < colour_attachments.size(); ++i) {
+		if (colour_attachments[i] == 0u)
+			continue;
+		auto const attachment = static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, colour_attachments[i], 0);
+		draw_buffers[i] = attachment;
+	}
+	if (depth_attachment != 0u)
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_attachment, 0);
+
+	if (draw_buffers.empty())
+		glDrawBuffer(GL_NONE);
+	else
+		glDrawBuffers(static_cast<GLsizei>(draw_buffers.size()), draw_buffers.data());
+	glReadBuffer(!colour_attachments.empty() && colour_attachments[0] != 0u ? GL_COLOR_ATTACHMENT0 : GL_NONE);
+
+	auto const status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		LogError("Framebuffer \"%s\" is not complete (status 0x%04x): check the logs for additional information.", label.c_str(), status);
+		++incomplete_framebuffers_nb;
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(previous_draw_framebuffer));
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previous_read_framebuffer));
+
+	bonobo::getResourceRegistry().Register(ResourceType::framebuffer, fbo, label, ResourceCategory::render_targets);
+	framebuffers.push_back({ fbo, colour_attachments, depth_attachment, frame });
+	return fbo;
+}
+
+void RenderTargetPool::Trim()
+{
+	DestroyTargets(0u);
+}
+
+RenderTargetPool::Statistics RenderTargetPool::GetStatistics() const
+{
+	Statistics statistics;
+	statistics.targets_nb = targets.size();
+	statistics.acquired_targets_nb = static_cast<std::size_t>(std::count_if(targets.begin(), targets.end(), [](Target const& t) { return t.is_acquired; }));
+	statistics.framebuffers_nb = framebuffers.size();
+	statistics.created_targets_nb = created_targets_nb;
+	statistics.incomplete_framebuffers_nb = incomplete_framebuffers_nb;
+	return statistics;
+}
+
+void RenderTargetPool::DestroyTargets(std::uint64_t const min_unused_frames_nb)
+{
+	auto& registry = bonobo::getResourceRegistry();
+	auto const is_destroyed = [this, min_unused_frames_nb](Target const& target) {
+		return !target.is_acquired && frame - target.last_used_frame >= min_unused_frames_nb;
+	};
+
+	// Framebuffers go first, as they may refer to the targets destroyed.
+	auto const refers_to_destroyed_target = [this, &is_destroyed](GLuint texture) {
+		auto const target = std::find_if(targets.begin(), targets.end(), [texture](Target const& t) { return t.texture == texture; });
+		return target != targets.end() && is_destroyed(*target);
+	};
+	auto const framebuffers_end = std::remove_if(framebuffers.begin(), framebuffers.end(), [&](Framebuffer& framebuffer) {
+		auto const is_unused = frame - framebuffer.last_used_frame >= min_unused_frames_nb;
+		auto const is_dangling = refers_to_destroyed_target(framebuffer.depth_attachment)
+		                      || std::any_of(framebuffer.colour_attachments.begin(), framebuffer.colour_attachments.end(), refers_to_destroyed_target);
+		if (!is_unused && !is_dangling)
+			return false;
+		registry.Release(ResourceType::framebuffer, framebuffer.fbo);
+		return true;
+	});
+	framebuffers.erase(framebuffers_end, framebuffers.end());
+
+	auto const targets_end = std::remove_if(targets.begin(), targets.end(), [&](Target& target) {
+		if (!is_destroyed(target))
+			return false;
+		registry.Release(ResourceType::texture, target.texture);
+		return true;
+	});
+	targets.erase(targets_end, targets.end());
+}
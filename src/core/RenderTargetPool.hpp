@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! \brief Format and size of a 2D render target.
+struct RenderTargetDesc
+{
+	GLint internal_format{ GL_RGBA8 };
+	GLenum format{ GL_RGBA };                //!< Only used to allocate the storage
+	GLenum type{ GL_UNSIGNED_BYTE };         //!< Only used to allocate the storage
+	float scale{ 1.0f };                     //!< Size relative to the reference size of the pool
+	glm::uvec2 fixed_size{ 0u, 0u };         //!< Size in texels, overriding |scale| if non-zero
+};
+
+//! \brief Hand out render targets and framebuffers, recreating them when
+//!        the reference size changes, and reusing them across passes.
+//!
+//! A target is acquired by describing it, and stays reserved until it is
+//! released; any later acquisition of a matching description can then get
+//! the same texture, so passes whose targets have disjoint lifetimes share
+//! their memory. Framebuffers are cached per set of attachments.
+//!
+//! Nothing is recreated eagerly on resize: the targets of the previous size
+//! simply stop matching any description, and like any target or framebuffer
+//! which has not been used for a few frames, get destroyed by NewFrame().
+//! Targets are tracked by the resource registry as render targets.
+class RenderTargetPool
+{
+public:
+	struct Statistics
+	{
+		std::size_t targets_nb = 0u;
+		std::size_t acquired_targets_nb = 0u;
+		std::size_t framebuffers_nb = 0u;
+		std::size_t created_targets_nb = 0u;          //!< Since the creation of the pool
+		std::size_t incomplete_framebuffers_nb = 0u;  //!< Since the creation of the pool
+	};
+
+	RenderTargetPool() = default;
+	~RenderTargetPool();
+	RenderTargetPool(RenderTargetPool const&) = delete;
+	RenderTargetPool& operator=(RenderTargetPool const&) = delete;
+
+	//! \brief Set the size relative targets are scaled from, usually the
+	//!        size of the default framebuffer.
+	void SetReferenceSize(glm::uvec2 const& size);
+	glm::uvec2 GetReferenceSize() const;
+	//! \brief Return the size, in texels, of targets described by |desc|.
+	glm::uvec2 GetSize(RenderTargetDesc const& desc) const;
+
+	//! \brief Start a new frame, destroying the targets and framebuffers
+	//!        which went unused for a few frames.
+	void NewFrame();
+
+	//! \brief Reserve a target matching |desc|, creating it if none is
+	//!        available.
+	//!
+	//! @param [in] label Debug name given to the target; when reused, the
+	//!             target gets renamed
+	//! @return The OpenGL name of the texture, or 0 on failure
+	GLuint Acquire(RenderTargetDesc const& desc, std::string const& label);
+	//! \brief Make a target acquired earlier available again; it keeps its
+	//!        content, until acquired again.
+	void Release(GLuint texture);
+	//! \brief Release all targets acquired so far.
+	void ReleaseAll();
+
+	//! \brief Return a framebuffer with the given attachments, creating it
+	//!        if needed.
+	//!
+	//! Colour attachment i gets drawn to by fragment shader output i, and
+	//! read from if it is the first one; a 0 entry leaves the attachment
+	//! and its draw buffer empty. Completeness is checked on creation.
+	//!
+	//! @param [in] depth_attachment Attached as GL_DEPTH_ATTACHMENT, or 0
+	GLuint GetFramebuffer(std::vector<GLuint> const& colour_attachments, GLuint depth_attachment, std::string const& label);
+
+	//! \brief Destroy all targets which are not acquired, along with all
+	//!        framebuffers, which get recreated on demand.
+	void Trim();
+
+	Statistics GetStatistics() const;
+
+private:
+	struct Target
+	{
+		GLuint texture;
+		RenderTargetDesc desc;
+		glm::uvec2 size;
+		bool is_acquired;
+		std::uint64_t last_used_frame;
+	};
+
+	struct Framebuffer
+	{
+		GLuint fbo;
+		std::vector<GLuint> colour_attachments;
+		GLuint depth_attachment;
+		std::uint64_t last_used_frame;
+	};
+
+	void DestroyTargets(std::uint64_t min_unused_frames_nb);
+
+	std::vector<Target> targets;
+	std::vector<Framebuffer> framebuffers;
+	glm::uvec2 reference_size{ 1u, 1u };
+	std::uint64_t frame{ 0u };
+	std::size_t created_targets_nb{ 0u };
+	std::size_t incomplete_framebuffers_nb{ 0u };
+};
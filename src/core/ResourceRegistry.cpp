@@ -0,0 +1,674 @@
+#include "ResourceRegistry.hpp"
+
+#include "Log.h"
+#include "opengl.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	constexpr std::uint32_t index_bits = 20u;
+	constexpr std::uint32_t index_mask = (1u << index_bits) - 1u;
+	constexpr std::uint32_t generation_mask = (1u << (32u - index_bits)) - 1u;
+
+	std::array<char const*, static_cast<std::size_t>(ResourceType::count)> const type_names = {
+		"texture",
+		"buffer",
+		"renderbuffer",
+		"framebuffer",
+		"sampler",
+		"vertex array",
+		"program"
+	};
+
+	std::array<char const*, static_cast<std::size_t>(ResourceCategory::count)> const category_names = {
+		"geometry",
+		"textures",
+		"mips",
+		"render targets",
+		"buffers",
+		"other"
+	};
+
+	std::array<GLenum, static_cast<std::size_t>(ResourceType::count)> const label_namespaces = {
+		GL_TEXTURE,
+		GL_BUFFER,
+		GL_RENDERBUFFER,
+		GL_FRAMEBUFFER,
+		GL_SAMPLER,
+		GL_VERTEX_ARRAY,
+		GL_PROGRAM
+	};
+
+	std::uint64_t getObjectKey(ResourceType type, GLuint id)
+	{
+		return (static_cast<std::uint64_t>(type) << 32u) | id;
+	}
+
+	float toMiB(std::size_t bytes)
+	{
+		return static_cast<float>(bytes) / (1024.0f * 1024.0f);
+	}
+
+	GLenum getTextureBinding(GLenum target)
+	{
+		switch (target) {
+			case GL_TEXTURE_1D:                   return GL_TEXTURE_BINDING_1D;
+			case GL_TEXTURE_1D_ARRAY:             return GL_TEXTURE_BINDING_1D_ARRAY;
+			case GL_TEXTURE_2D:                   return GL_TEXTURE_BINDING_2D;
+			case GL_TEXTURE_2D_ARRAY:             return GL_TEXTURE_BINDING_2D_ARRAY;
+			case GL_TEXTURE_2D_MULTISAMPLE:       return GL_TEXTURE_BINDING_2D_MULTISAMPLE;
+			case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: return GL_TEXTURE_BINDING_2D_MULTISAMPLE_ARRAY;
+			case GL_TEXTURE_3D:                   return GL_TEXTURE_BINDING_3D;
+			case GL_TEXTURE_CUBE_MAP:             return GL_TEXTURE_BINDING_CUBE_MAP;
+			case GL_TEXTURE_CUBE_MAP_ARRAY:       return GL_TEXTURE_BINDING_CUBE_MAP_ARRAY;
+			case GL_TEXTURE_RECTANGLE:            return GL_TEXTURE_BINDING_RECTANGLE;
+			default:                              return GL_NONE;
+		}
+	}
+
+	std::size_t measureTexture(GLuint texture, GLenum target, std::size_t& mips_size)
+	{
+		auto const binding = getTextureBinding(target);
+		if (binding == GL_NONE)
+			return 0u; // Buffer textures are accounted for by their buffer.
+
+		GLint previous_texture = 0;
+		glGetIntegerv(binding, &previous_texture);
+		glBindTexture(target, texture);
+
+		// Cube maps are measured through one of their faces.
+		auto const level_target = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+		auto const faces_nb = target == GL_TEXTURE_CUBE_MAP ? 6u : 1u;
+
+		std::size_t size = 0u;
+		std::size_t base_size = 0u;
+		for (GLint level = 0; level < 32; ++level) {
+			GLint width = 0, height = 0, depth = 0;
+			glGetTexLevelParameteriv(level_target, level, GL_TEXTURE_WIDTH, &width);
+			if (width == 0)
+				break; // Levels without storage report a size of 0.
+			glGetTexLevelParameteriv(level_target, level, GL_TEXTURE_HEIGHT, &height);
+			glGetTexLevelParameteriv(level_target, level, GL_TEXTURE_DEPTH, &depth);
+
+			GLint is_compressed = GL_FALSE;
+			glGetTexLevelParameteriv(level_target, level, GL_TEXTURE_COMPRESSED, &is_compressed);
+			if (is_compressed == GL_TRUE) {
+				GLint compressed_size = 0;
+				glGetTexLevelParameteriv(level_target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressed_size);
+				size += static_cast<std::size_t>(compressed_size) * faces_nb;
+				if (level == 0)
+					base_size = size;
+				continue;
+			}
+
+			GLint bits_per_texel = 0;
+			for (auto const component : { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE,
+			                              GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_STENCIL_SIZE, GL_TEXTURE_SHARED_SIZE }) {
+				GLint bits = 0;
+				glGetTexLevelParameteriv(level_target, level, component, &bits);
+				bits_per_texel += bits;
+			}
+			GLint samples_nb = 0;
+			glGetTexLevelParameteriv(level_target, level, GL_TEXTURE_SAMPLES, &samples_nb);
+
+			auto const texels_nb = static_cast<std::size_t>(width) * static_cast<std::size_t>(std::max(height, 1))
+			                     * static_cast<std::size_t>(std::max(depth, 1)) * static_cast<std::size_t>(std::max(samples_nb, 1));
+			size += (texels_nb * static_cast<std::size_t>(bits_per_texel) + 7u) / 8u * faces_nb;
+			if (level == 0)
+				base_size = size;
+		}
+
+		glBindTexture(target, static_cast<GLuint>(previous_texture));
+		mips_size = size - base_size;
+		return size;
+	}
+
+	std::size_t measureBuffer(GLuint buffer)
+	{
+		// The copy targets never affect rendering.
+		GLint previous_buffer = 0;
+		glGetIntegerv(GL_COPY_READ_BUFFER_BINDING, &previous_buffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		GLint64 size = 0;
+		glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+		glBindBuffer(GL_COPY_READ_BUFFER, static_cast<GLuint>(previous_buffer));
+		return static_cast<std::size_t>(size);
+	}
+
+	std::size_t measureRenderbuffer(GLuint renderbuffer)
+	{
+		GLint previous_renderbuffer = 0;
+		glGetIntegerv(GL_RENDERBUFFER_BINDING, &previous_renderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+
+		GLint width = 0, height = 0, samples_nb = 0, bits_per_texel = 0;
+		glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &width);
+		glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &height);
+		glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_SAMPLES, &samples_nb);
+		for (auto const component : { GL_RENDERBUFFER_RED_SIZE, GL_RENDERBUFFER_GREEN_SIZE, GL_RENDERBUFFER_BLUE_SIZE,
+		                              GL_RENDERBUFFER_ALPHA_SIZE, GL_RENDERBUFFER_DEPTH_SIZE, GL_RENDERBUFFER_STENCIL_SIZE }) {
+			GLint bits = 0;
+			glGetRenderbufferParameteriv(GL_RENDERBUFFER, component, &bits);
+			bits_per_texel += bits;
+		}
+
+		glBindRenderbuffer(GL_RENDERBUFFER, static_cast<GLuint>(previous_renderbuffer));
+		auto const texels_nb = static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * static_cast<std::size_t>(std::max(samples_nb, 1));
+		return (texels_nb * static_cast<std::size_t>(bits_per_texel) + 7u) / 8u;
+	}
+
+	std::size_t measureObject(ResourceType type, GLuint id, GLenum texture_target, std::size_t& mips_size)
+	{
+		mips_size = 0u;
+		switch (type) {
+			case ResourceType::texture:      return measureTexture(id, texture_target, mips_size);
+			case ResourceType::buffer:       return measureBuffer(id);
+			case ResourceType::renderbuffer: return measureRenderbuffer(id);
+			default:                         return 0u; // Containers and state objects own no storage of note.
+		}
+	}
+
+	bool doesObjectExist(ResourceType type, GLuint id)
+	{
+		switch (type) {
+			case ResourceType::texture:      return glIsTexture(id) == GL_TRUE;
+			case ResourceType::buffer:       return glIsBuffer(id) == GL_TRUE;
+			case ResourceType::renderbuffer: return glIsRenderbuffer(id) == GL_TRUE;
+			case ResourceType::framebuffer:  return glIsFramebuffer(id) == GL_TRUE;
+			case ResourceType::sampler:      return glIsSampler(id) == GL_TRUE;
+			case ResourceType::vertex_array: return glIsVertexArray(id) == GL_TRUE;
+			case ResourceType::program:      return glIsProgram(id) == GL_TRUE;
+			default:                         return false;
+		}
+	}
+
+	void deleteObject(ResourceType type, GLuint id)
+	{
+		switch (type) {
+			case ResourceType::texture:      glDeleteTextures(1, &id);      break;
+			case ResourceType::buffer:       glDeleteBuffers(1, &id);       break;
+			case ResourceType::renderbuffer: glDeleteRenderbuffers(1, &id); break;
+			case ResourceType::framebuffer:  glDeleteFramebuffers(1, &id);  break;
+			case ResourceType::sampler:      glDeleteSamplers(1, &id);      break;
+			case ResourceType::vertex_array: glDeleteVertexArrays(1, &id);  break;
+			case ResourceType::program:      glDeleteProgram(id);           break;
+			case ResourceType::count:                                       break;
+		}
+	}
+
+	ResourceCategory getDefaultCategory(ResourceType type)
+	{
+		switch (type) {
+			case ResourceType::texture:      return ResourceCategory::textures;
+			case ResourceType::buffer:       return ResourceCategory::buffers;
+			case ResourceType::renderbuffer: return ResourceCategory::render_targets;
+			default:                         return ResourceCategory::other;
+		}
+	}
+
+	bool dropTopMipLevel(GLuint texture)
+	{
+		GLint previous_texture = 0, previous_pack_buffer = 0, previous_unpack_buffer = 0;
+		GLint previous_pack_alignment = 4, previous_unpack_alignment = 4;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+
+		GLint internal_format = 0, width = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+		GLint levels_nb = 0;
+		for (; levels_nb < 32; ++levels_nb) {
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, levels_nb, GL_TEXTURE_WIDTH, &width);
+			if (width == 0)
+				break;
+		}
+		GLint max_level = 1000;
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &max_level);
+		levels_nb = std::min(levels_nb, max_level + 1);
+		if ((internal_format != GL_RGBA8 && internal_format != GL_RGBA) || levels_nb < 2) {
+			glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous_texture));
+			return false;
+		}
+
+		glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previous_pack_buffer);
+		glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &previous_unpack_buffer);
+		glGetIntegerv(GL_PACK_ALIGNMENT, &previous_pack_alignment);
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &previous_unpack_alignment);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0u);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		// Each level takes the place of the previous one, and the last one
+		// is left without any storage.
+		std::vector<std::uint8_t> texels;
+		for (GLint level = 1; level < levels_nb; ++level) {
+			GLint height = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+			texels.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4u);
+			glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+			glTexImage2D(GL_TEXTURE_2D, level - 1, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+		}
+		glTexImage2D(GL_TEXTURE_2D, levels_nb - 1, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels_nb - 2);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, previous_unpack_alignment);
+		glPixelStorei(GL_PACK_ALIGNMENT, previous_pack_alignment);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, static_cast<GLuint>(previous_unpack_buffer));
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, static_cast<GLuint>(previous_pack_buffer));
+		glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous_texture));
+		return true;
+	}
+}
+
+ResourceRegistry::OwnerScope::OwnerScope(ResourceRegistry& registry, std::string const& owner) : registry(registry)
+{
+	registry.PushOwner(owner);
+}
+
+ResourceRegistry::OwnerScope::~OwnerScope()
+{
+	registry.PopOwner();
+}
+
+ResourceHandle ResourceRegistry::Register(ResourceType const type, GLuint const id, std::string const& label,
+                                          ResourceCategory const category, GLenum const texture_target)
+{
+	if (id == 0u)
+		return ResourceHandle();
+
+	auto handle = Reserve(type, label, category, texture_target);
+	Replace(handle, id);
+	return handle;
+}
+
+ResourceHandle ResourceRegistry::Reserve(ResourceType const type, std::string const& label,
+                                         ResourceCategory const category, GLenum const texture_target)
+{
+	std::uint32_t slot_index;
+	if (!free_slots.empty()) {
+		slot_index = free_slots.back();
+		free_slots.pop_back();
+	} else {
+		if (slots.size() > index_mask) {
+			LogError("Too many OpenGL objects are registered: \"%s\" will not be tracked.", label.c_str());
+			return ResourceHandle();
+		}
+		slot_index = static_cast<std::uint32_t>(slots.size());
+		slots.emplace_back();
+	}
+
+	auto& slot = slots[slot_index];
+	// Generation 0 is skipped, so that no valid handle is ever null.
+	slot.generation = (slot.generation % generation_mask) + 1u;
+	slot.type = type;
+	slot.category = category == ResourceCategory::automatic ? getDefaultCategory(type) : category;
+	slot.id = 0u;
+	slot.texture_target = texture_target;
+	slot.label = label;
+	slot.owner = owners.empty() ? std::string() : owners.back();
+	slot.last_used_frame = frame;
+	slot.size = 0u;
+	slot.mips_size = 0u;
+	slot.is_alive = true;
+
+	return ResourceHandle{ (slot.generation << index_bits) | slot_index };
+}
+
+bool ResourceRegistry::Replace(ResourceHandle const handle, GLuint const id)
+{
+	if (GetSlot(handle) == nullptr)
+		return false;
+
+	auto& slot = slots[handle.value & index_mask];
+	if (slot.id == id)
+		return true;
+
+	// OpenGL names get reused once deleted, so an entry for the same name
+	// means the previous object was deleted without the registry knowing.
+	auto const key = getObjectKey(slot.type, id);
+	auto const previous_slot = id != 0u ? slot_by_object.find(key) : slot_by_object.end();
+	if (previous_slot != slot_by_object.end()) {
+		LogWarning("The %s \"%s\" was deleted without going through the resource registry.", type_names[static_cast<std::size_t>(slot.type)], slots[previous_slot->second].label.c_str());
+		ReleaseSlot(previous_slot->second, false); // Do not delete the new object.
+	}
+
+	if (slot.id != 0u) {
+		AccountSlot(slot, false);
+		slot_by_object.erase(getObjectKey(slot.type, slot.id));
+		deleteObject(slot.type, slot.id);
+	}
+
+	slot.id = id;
+	slot.size = 0u;
+	slot.mips_size = 0u;
+	if (id == 0u)
+		return true;
+
+	slot.size = measureObject(slot.type, id, slot.texture_target, slot.mips_size);
+	slot_by_object.emplace(key, handle.value & index_mask);
+	AccountSlot(slot, true);
+
+	if (!slot.label.empty())
+		utils::opengl::debug::nameObject(label_namespaces[static_cast<std::size_t>(slot.type)], id, slot.label);
+
+	return true;
+}
+
+GLuint ResourceRegistry::Get(ResourceHandle const handle) const
+{
+	auto const slot = GetSlot(handle);
+	return slot != nullptr ? slot->id : 0u;
+}
+
+bool ResourceRegistry::IsAlive(ResourceHandle const handle) const
+{
+	return GetSlot(handle) != nullptr;
+}
+
+ResourceHandle ResourceRegistry::Find(ResourceType const type, GLuint const id) const
+{
+	auto const slot_index = slot_by_object.find(getObjectKey(type, id));
+	if (slot_index == slot_by_object.end())
+		return ResourceHandle();
+	return ResourceHandle{ (slots[slot_index->second].generation << index_bits) | slot_index->second };
+}
+
+void ResourceRegistry::UpdateSize(ResourceHandle const handle)
+{
+	if (GetSlot(handle) == nullptr)
+		return;
+
+	MeasureSlot(slots[handle.value & index_mask]);
+}
+
+void ResourceRegistry::SetSize(ResourceHandle const handle, std::size_t const size)
+{
+	auto const slot_pointer = GetSlot(handle);
+	if (slot_pointer == nullptr || slot_pointer->id == 0u)
+		return;
+
+	auto& slot = slots[handle.value & index_mask];
+	AccountSlot(slot, false);
+	slot.size = size;
+	slot.mips_size = 0u;
+	AccountSlot(slot, true);
+}
+
+std::size_t ResourceRegistry::GetSize(ResourceHandle const handle) const
+{
+	auto const slot = GetSlot(handle);
+	return slot != nullptr ? slot->size : 0u;
+}
+
+std::string const& ResourceRegistry::GetLabel(ResourceHandle const handle) const
+{
+	static std::string const no_label;
+	auto const slot = GetSlot(handle);
+	return slot != nullptr ? slot->label : no_label;
+}
+
+void ResourceRegistry::SetLabel(ResourceHandle const handle, std::string const& label)
+{
+	if (GetSlot(handle) == nullptr)
+		return;
+
+	auto& slot = slots[handle.value & index_mask];
+	slot.label = label;
+	if (slot.id != 0u)
+		utils::opengl::debug::nameObject(label_namespaces[static_cast<std::size_t>(slot.type)], slot.id, label);
+}
+
+void ResourceRegistry::SetCategory(ResourceHandle const handle, ResourceCategory const category)
+{
+	if (GetSlot(handle) == nullptr)
+		return;
+
+	auto& slot = slots[handle.value & index_mask];
+	if (slot.id != 0u)
+		AccountSlot(slot, false);
+	slot.category = category == ResourceCategory::automatic ? getDefaultCategory(slot.type) : category;
+	if (slot.id != 0u)
+		AccountSlot(slot, true);
+}
+
+void ResourceRegistry::PushOwner(std::string const& owner)
+{
+	owners.push_back(owner);
+}
+
+void ResourceRegistry::PopOwner()
+{
+	if (owners.empty()) {
+		LogError("PopOwner() was called more often than PushOwner().");
+		return;
+	}
+	owners.pop_back();
+}
+
+void ResourceRegistry::NewFrame()
+{
+	++frame;
+}
+
+std::uint64_t ResourceRegistry::GetRevision() const
+{
+	return revision;
+}
+
+std::uint64_t ResourceRegistry::GetFrame() const
+{
+	return frame;
+}
+
+void ResourceRegistry::MarkUsed(ResourceType const type, GLuint const id)
+{
+	auto const slot_index = slot_by_object.find(getObjectKey(type, id));
+	if (slot_index != slot_by_object.end())
+		slots[slot_index->second].last_used_frame = frame;
+}
+
+bool ResourceRegistry::DropTopMipLevel(ResourceHandle const handle)
+{
+	auto const slot = GetSlot(handle);
+	if (slot == nullptr || slot->id == 0u || slot->type != ResourceType::texture || slot->texture_target != GL_TEXTURE_2D)
+		return false;
+
+	if (!dropTopMipLevel(slot->id))
+		return false;
+
+	MeasureSlot(slots[handle.value & index_mask]);
+	return true;
+}
+
+ResourceRegistry::Usage ResourceRegistry::GetUsage(ResourceType const type) const
+{
+	return usages[static_cast<std::size_t>(type)];
+}
+
+ResourceRegistry::Usage ResourceRegistry::GetUsage(ResourceCategory const category) const
+{
+	if (category >= ResourceCategory::count)
+		return Usage();
+	return category_usages[static_cast<std::size_t>(category)];
+}
+
+ResourceRegistry::Usage ResourceRegistry::GetTotalUsage() const
+{
+	Usage total_usage;
+	for (auto const& usage : usages) {
+		total_usage.objects_nb += usage.objects_nb;
+		total_usage.bytes += usage.bytes;
+	}
+	return total_usage;
+}
+
+std::map<std::string, ResourceRegistry::Usage> ResourceRegistry::GetUsageByOwner() const
+{
+	std::map<std::string, Usage> owner_usages;
+	for (auto const& slot : slots) {
+		if (!slot.is_alive || slot.id == 0u)
+			continue;
+		auto& usage = owner_usages[slot.owner];
+		++usage.objects_nb;
+		usage.bytes += slot.size;
+	}
+	return owner_usages;
+}
+
+std::vector<ResourceRegistry::ObjectInfo> ResourceRegistry::GetObjects() const
+{
+	std::vector<ObjectInfo> objects;
+	for (std::uint32_t i = 0u; i < slots.size(); ++i) {
+		auto const& slot = slots[i];
+		if (slot.is_alive && slot.id != 0u)
+			objects.push_back({ ResourceHandle{ (slot.generation << index_bits) | i }, slot.type, slot.category,
+			                    slot.label, slot.owner, slot.size, slot.mips_size, slot.last_used_frame });
+	}
+	return objects;
+}
+
+char const* ResourceRegistry::GetTypeName(ResourceType const type)
+{
+	return type < ResourceType::count ? type_names[static_cast<std::size_t>(type)] : "unknown";
+}
+
+char const* ResourceRegistry::GetCategoryName(ResourceCategory const category)
+{
+	return category < ResourceCategory::count ? category_names[static_cast<std::size_t>(category)] : "automatic";
+}
+
+void ResourceRegistry::Release(ResourceHandle& handle)
+{
+	if (GetSlot(handle) != nullptr)
+		ReleaseSlot(handle.value & index_mask);
+	handle = ResourceHandle();
+}
+
+void ResourceRegistry::Release(ResourceType const type, GLuint& id)
+{
+	if (id == 0u)
+		return;
+
+	auto const slot_index = slot_by_object.find(getObjectKey(type, id));
+	if (slot_index != slot_by_object.end())
+		ReleaseSlot(slot_index->second);
+	else
+		deleteObject(type, id);
+	id = 0u;
+}
+
+std::size_t ResourceRegistry::ReleaseAll()
+{
+	std::size_t leaked_objects_nb = 0u;
+	for (std::uint32_t i = 0u; i < slots.size(); ++i) {
+		if (!slots[i].is_alive)
+			continue;
+
+		// Objects deleted directly through OpenGL are not leaks, and their
+		// name must not be deleted again; neither are reserved handles which
+		// never got an object.
+		if (slots[i].id == 0u || !doesObjectExist(slots[i].type, slots[i].id)) {
+			ReleaseSlot(i, false);
+			continue;
+		}
+
+		LogTrivia("Leaked %s \"%s\" (%.2f MiB).", type_names[static_cast<std::size_t>(slots[i].type)], slots[i].label.c_str(), toMiB(slots[i].size));
+		ReleaseSlot(i);
+		++leaked_objects_nb;
+	}
+	if (leaked_objects_nb > 0u)
+		LogWarning("%zu OpenGL objects were never released; see previous messages for the list.", leaked_objects_nb);
+	return leaked_objects_nb;
+}
+
+void ResourceRegistry::LogReport(std::size_t const largest_objects_nb) const
+{
+	auto const total_usage = GetTotalUsage();
+	LogInfo("%zu OpenGL objects are alive, using %.2f MiB:", total_usage.objects_nb, toMiB(total_usage.bytes));
+	for (std::size_t i = 0u; i < usages.size(); ++i) {
+		if (usages[i].objects_nb > 0u)
+			LogInfo("  %zu %s object(s), using %.2f MiB", usages[i].objects_nb, type_names[i], toMiB(usages[i].bytes));
+	}
+	LogInfo("By category:");
+	for (std::size_t i = 0u; i < category_usages.size(); ++i) {
+		if (category_usages[i].bytes > 0u)
+			LogInfo("  %s: %.2f MiB", category_names[i], toMiB(category_usages[i].bytes));
+	}
+
+	std::vector<Slot const*> largest_objects;
+	for (auto const& slot : slots) {
+		if (slot.is_alive && slot.size > 0u)
+			largest_objects.push_back(&slot);
+	}
+	auto const reported_objects_nb = std::min(largest_objects_nb, largest_objects.size());
+	std::partial_sort(largest_objects.begin(), largest_objects.begin() + reported_objects_nb, largest_objects.end(),
+	                  [](Slot const* lhs, Slot const* rhs){ return lhs->size > rhs->size; });
+	if (reported_objects_nb > 0u)
+		LogInfo("Largest objects:");
+	for (std::size_t i = 0u; i < reported_objects_nb; ++i)
+		LogInfo("  %s \"%s\": %.2f MiB", type_names[static_cast<std::size_t>(largest_objects[i]->type)], largest_objects[i]->label.c_str(), toMiB(largest_objects[i]->size));
+}
+
+ResourceRegistry::Slot const* ResourceRegistry::GetSlot(ResourceHandle const handle) const
+{
+	auto const slot_index = handle.value & index_mask;
+	if (handle.IsNull() || slot_index >= slots.size())
+		return nullptr;
+
+	auto const& slot = slots[slot_index];
+	if (!slot.is_alive || slot.generation != (handle.value >> index_bits))
+		return nullptr;
+	return &slot;
+}
+
+void ResourceRegistry::ReleaseSlot(std::uint32_t const slot_index, bool const delete_object)
+{
+	auto& slot = slots[slot_index];
+	if (slot.id != 0u) {
+		if (delete_object)
+			deleteObject(slot.type, slot.id);
+		AccountSlot(slot, false);
+		slot_by_object.erase(getObjectKey(slot.type, slot.id));
+	}
+	slot.id = 0u;
+	slot.size = 0u;
+	slot.mips_size = 0u;
+	slot.label.clear();
+	slot.owner.clear();
+	slot.is_alive = false;
+	free_slots.push_back(slot_index);
+}
+
+void ResourceRegistry::AccountSlot(Slot const& slot, bool const is_added)
+{
+	// Every change made to the objects goes through here.
+	++revision;
+
+	auto const update = [is_added](Usage& usage, std::size_t bytes){
+		if (is_added) {
+			++usage.objects_nb;
+			usage.bytes += bytes;
+		} else {
+			--usage.objects_nb;
+			usage.bytes -= bytes;
+		}
+	};
+
+	update(usages[static_cast<std::size_t>(slot.type)], slot.size);
+	update(category_usages[static_cast<std::size_t>(slot.category)], slot.size - slot.mips_size);
+	// The mips category counts the objects having some.
+	if (slot.mips_size > 0u)
+		update(category_usages[static_cast<std::size_t>(ResourceCategory::mips)], slot.mips_size);
+}
+
+void ResourceRegistry::MeasureSlot(Slot& slot)
+{
+	if (slot.id == 0u)
+		return;
+
+	AccountSlot(slot, false);
+	slot.size = measureObject(slot.type, slot.id, slot.texture_target, slot.mips_size);
+	AccountSlot(slot, true);
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class ResourceType : std::uint32_t {
+	texture = 0u,
+	buffer,
+	renderbuffer,
+	framebuffer,
+	sampler,
+	vertex_array,
+	program,
+	count
+};
+
+//! \brief What the memory of an object is used for, for accounting.
+enum class ResourceCategory : std::uint32_t {
+	geometry = 0u,
+	textures,
+	mips,            //!< Levels past the first of any texture; objects never belong to it
+	render_targets,
+	buffers,         //!< Buffers other than vertex and index data, like uniform buffers
+	other,
+	count,
+	automatic = count //!< Pick the category from the type of the object
+};
+
+//! \brief Reference to an OpenGL object tracked by a ResourceRegistry.
+//!
+//! The lower 20 bits select a slot of the registry, and the upper 12 bits
+//! hold the generation of that slot, which is bumped every time the slot
+//! gets reused: a handle to a released object therefore never resolves to
+//! whichever object took its place. A value of 0 is the null handle.
+struct ResourceHandle
+{
+	std::uint32_t value{ 0u };
+
+	bool IsNull() const noexcept { return value == 0u; }
+	bool operator==(ResourceHandle const& other) const noexcept { return value == other.value; }
+	bool operator!=(ResourceHandle const& other) const noexcept { return value != other.value; }
+};
+
+//! \brief Keep track of OpenGL objects, their debug names and how much
+//!        video memory they use.
+//!
+//! Objects are registered once created, and released through the registry
+//! rather than by calling glDelete*() directly; anything still registered
+//! when ReleaseAll() gets called is reported as leaked. Sizes are measured
+//! by querying the driver at registration, and again on UpdateSize() for
+//! objects whose storage gets reallocated: they are estimates, which do
+//! not account for padding, compression ratios or driver allocations.
+//!
+//! Code only holding the OpenGL name of an object, like the one returned
+//! by the bonobo helpers, can find its handle through Find().
+//!
+//! Objects are also attributed to a category and to an owner, the name of
+//! the innermost OwnerScope alive when they were registered, so that usage
+//! can be broken down by what the memory is for and by who allocated it.
+//! All of this is application-side accounting, which works the same on
+//! every driver, rather than relying on vendor memory-info extensions.
+class ResourceRegistry
+{
+public:
+	struct Usage
+	{
+		std::size_t objects_nb = 0u;
+		std::size_t bytes = 0u;
+	};
+
+	//! \brief Snapshot of a tracked object, as returned by GetObjects().
+	struct ObjectInfo
+	{
+		ResourceHandle handle;
+		ResourceType type;
+		ResourceCategory category;
+		std::string label;
+		std::string owner;
+		std::size_t size;            //!< Including the mips
+		std::size_t mips_size;
+		std::uint64_t last_used_frame;
+	};
+
+	//! \brief Attribute all objects registered during its lifetime to
+	//!        |owner|, unless a nested scope overrides it.
+	class OwnerScope
+	{
+	public:
+		OwnerScope(ResourceRegistry& registry, std::string const& owner);
+		~OwnerScope();
+		OwnerScope(OwnerScope const&) = delete;
+		OwnerScope& operator=(OwnerScope const&) = delete;
+
+	private:
+		ResourceRegistry& registry;
+	};
+
+	ResourceRegistry() = default;
+	ResourceRegistry(ResourceRegistry const&) = delete;
+	ResourceRegistry& operator=(ResourceRegistry const&) = delete;
+
+	//! \brief Start tracking the object |id| of the given |type|, and give
+	//!        it the debug name |label|.
+	//!
+	//! @param [in] category What the object is used for; by default,
+	//!             renderbuffers are render targets and textures textures
+	//! @param [in] texture_target Target the texture was created with, so
+	//!             that its size can be queried; ignored for other types
+	//! @return A handle to the object, or the null handle if |id| is 0
+	ResourceHandle Register(ResourceType type, GLuint id, std::string const& label,
+	                        ResourceCategory category = ResourceCategory::automatic,
+	                        GLenum texture_target = GL_TEXTURE_2D);
+
+	//! \brief Get a handle for an object created later on, and given to
+	//!        the registry through Replace().
+	//!
+	//! Until then, the handle is alive but refers to no object: Get()
+	//! returns 0, and it counts towards no usage.
+	ResourceHandle Reserve(ResourceType type, std::string const& label,
+	                       ResourceCategory category = ResourceCategory::automatic,
+	                       GLenum texture_target = GL_TEXTURE_2D);
+
+	//! \brief Make |handle| refer to the object |id|, deleting the one it
+	//!        referred to if any; the label, category and owner are kept.
+	//!
+	//! Whoever holds the handle gets the new object from then on, which is
+	//! what owners rebuilding an object, like a shader program, want.
+	//!
+	//! @return Whether |handle| is alive
+	bool Replace(ResourceHandle handle, GLuint id);
+
+	//! \brief Return the OpenGL name of the object referred to by |handle|,
+	//!        or 0 if that object was released.
+	GLuint Get(ResourceHandle handle) const;
+	bool IsAlive(ResourceHandle handle) const;
+
+	//! \brief Return the handle of the object |id| of the given |type|, or
+	//!        the null handle if it is not tracked.
+	ResourceHandle Find(ResourceType type, GLuint id) const;
+
+	//! \brief Measure again the memory used by an object, after its
+	//!        storage was reallocated.
+	void UpdateSize(ResourceHandle handle);
+	//! \brief Record the memory used by an object whose size is already
+	//!        known, without querying the driver.
+	void SetSize(ResourceHandle handle, std::size_t size);
+	std::size_t GetSize(ResourceHandle handle) const;
+	std::string const& GetLabel(ResourceHandle handle) const;
+	//! \brief Change the debug name of an object.
+	void SetLabel(ResourceHandle handle, std::string const& label);
+	//! \brief Change the category of an object, for example to mark a
+	//!        texture created through the helpers as a render target.
+	void SetCategory(ResourceHandle handle, ResourceCategory category);
+
+	//! \brief Attribute the objects registered from now on to |owner|,
+	//!        until the matching PopOwner(); prefer using an OwnerScope.
+	void PushOwner(std::string const& owner);
+	void PopOwner();
+
+	//! \brief Return a number changed every time an object is added or
+	//!        removed, or changes size or category, so that results
+	//!        computed from the objects can be cached until then.
+	std::uint64_t GetRevision() const;
+
+	//! \brief Start a new frame, for the least recently used tracking.
+	void NewFrame();
+	std::uint64_t GetFrame() const;
+	//! \brief Record that the object |id| is used during the current
+	//!        frame; untracked objects are ignored.
+	void MarkUsed(ResourceType type, GLuint id);
+
+	//! \brief Halve the resolution of a mipmapped 2D texture, by dropping
+	//!        its first level, to reduce its memory usage.
+	//!
+	//! The texture is read back and specified again level by level, which
+	//! stalls the pipeline: only call it occasionally. Only uncompressed
+	//! RGBA8 textures with at least two levels are supported.
+	//!
+	//! @return Whether a level was dropped
+	bool DropTopMipLevel(ResourceHandle handle);
+
+	Usage GetUsage(ResourceType type) const;
+	//! \brief Return the memory used by objects of the given |category|;
+	//!        the mips of textures only count towards ResourceCategory::mips.
+	Usage GetUsage(ResourceCategory category) const;
+	Usage GetTotalUsage() const;
+	//! \brief Return the usage of each owner, with "" for objects
+	//!        registered outside of any OwnerScope.
+	std::map<std::string, Usage> GetUsageByOwner() const;
+	std::vector<ObjectInfo> GetObjects() const;
+
+	static char const* GetTypeName(ResourceType type);
+	static char const* GetCategoryName(ResourceCategory category);
+
+	//! \brief Delete the object referred to by |handle|, and reset the
+	//!        handle; releasing a null or stale handle does nothing.
+	void Release(ResourceHandle& handle);
+	//! \brief Delete the object |id| of the given |type|, whether it is
+	//!        tracked or not, and reset |id| to 0.
+	void Release(ResourceType type, GLuint& id);
+
+	//! \brief Delete all objects still tracked, reporting each of them as
+	//!        leaked unless it was already deleted directly.
+	//!
+	//! @return How many objects were leaked
+	std::size_t ReleaseAll();
+
+	//! \brief Log how many objects of each type are alive and how much
+	//!        memory they use, along with the largest objects.
+	void LogReport(std::size_t largest_objects_nb = 10u) const;
+
+private:
+	struct Slot
+	{
+		ResourceType type{ ResourceType::texture };
+		ResourceCategory category{ ResourceCategory::other };
+		GLuint id{ 0u };
+		GLenum texture_target{ GL_NONE };
+		std::size_t size{ 0u };
+		std::size_t mips_size{ 0u };
+		std::string label;
+		std::string owner;
+		std::uint64_t last_used_frame{ 0u };
+		std::uint32_t generation{ 0u };
+		bool is_alive{ false };
+	};
+
+	Slot const* GetSlot(ResourceHandle handle) const;
+	void ReleaseSlot(std::uint32_t slot_index, bool delete_object = true);
+	//! \brief Add the memory of |slot| to the usages, or remove it.
+	void AccountSlot(Slot const& slot, bool is_added);
+	//! \brief Measure the memory used by the object of |slot| again.
+	void MeasureSlot(Slot& slot);
+
+	std::vector<Slot> slots;
+	std::vector<std::uint32_t> free_slots;
+	std::unordered_map<std::uint64_t, std::uint32_t> slot_by_object; //!< Slot of each tracked (type, OpenGL name) pair
+	std::array<Usage, static_cast<std::size_t>(ResourceType::count)> usages;
+	std::array<Usage, static_cast<std::size_t>(ResourceCategory::count)> category_usages;
+	std::vector<std::string> owners;
+	std::uint64_t frame{ 0u };
+	std::uint64_t revision{ 0u };
+};
@@ -0,0 +1,186 @@
+#include "ShaderPreprocessor.hpp"
+
+#include "Log.h"
+#include "various.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+namespace
+{
+	// Return the directive name if |line| is a preprocessor directive, and
+	// where its arguments start.
+	std::string getDirective(std::string const& line, std::size_t& arguments_start)
+	{
+		auto position = line.find_first_not_of(" \t");
+		if (position == std::string::npos || line[position] != '#')
+			return std::string();
+
+		position = line.find_first_not_of(" \t", position + 1u);
+		if (position == std::string::npos)
+			return std::string();
+
+		auto const name_end = line.find_first_of(" \t\r", position);
+		arguments_start = name_end == std::string::npos ? line.size() : name_end;
+		return line.substr(position, arguments_start - position);
+	}
+
+	std::string getDirectory(std::string const& filename)
+	{
+		auto const separator = filename.find_last_of("/\\");
+		return separator == std::string::npos ? std::string(".") : filename.substr(0u, separator);
+	}
+
+	std::string makeLineDirective(std::size_t line, std::size_t file_index)
+	{
+		return "#line " + std::to_string(line) + " " + std::to_string(file_index) + "\n";
+	}
+}
+
+ShaderPreprocessor::Result ShaderPreprocessor::Process(std::string const& filename, std::vector<std::string> const& defines)
+{
+	Result result;
+	result.files.push_back(filename);
+	if (!Expand(filename, 0u, defines, result))
+		result.source.clear();
+	return result;
+}
+
+std::string ShaderPreprocessor::RemapLog(std::string const& log, std::vector<std::string> const& files)
+{
+	// Drivers report locations as "0(12)" (NVIDIA), "0:12(5)" (Mesa) or
+	// "ERROR: 0:12:" (AMD, Intel), so look for a number followed by either
+	// a colon or a parenthesis, at the start of each line or after the
+	// severity.
+	std::istringstream input(log);
+	std::string remapped_log;
+	std::string line;
+	while (std::getline(input, line)) {
+		auto number_start = line.find_first_not_of(" \t");
+		for (auto const prefix : { "ERROR: ", "WARNING: " }) {
+			if (number_start != std::string::npos && line.compare(number_start, std::char_traits<char>::length(prefix), prefix) == 0)
+				number_start += std::char_traits<char>::length(prefix);
+		}
+
+		auto number_end = number_start;
+		while (number_end < line.size() && std::isdigit(static_cast<unsigned char>(line[number_end])))
+			++number_end;
+
+		if (number_end > number_start && number_end < line.size() && (line[number_end] == ':' || line[number_end] == '(')) {
+			auto const file_index = std::stoul(line.substr(number_start, number_end - number_start));
+			if (file_index < files.size())
+				line.replace(number_start, number_end - number_start, files[file_index]);
+		}
+
+		remapped_log += line + "\n";
+	}
+	return remapped_log;
+}
+
+ShaderPreprocessor::ParsedFile const* ShaderPreprocessor::Parse(std::string const& filename)
+{
+	auto const content = utils::slurp_file(filename);
+	if (content.empty())
+		return nullptr;
+
+	auto const content_hash = utils::hash_fnv1a(content.data(), content.size());
+	auto& parsed_file = parsed_files[filename];
+	if (!parsed_file.segments.empty() && parsed_file.content_hash == content_hash)
+		return &parsed_file;
+
+	parsed_file.content_hash = content_hash;
+	parsed_file.segments.clear();
+
+	std::istringstream input(content);
+	std::string line;
+	for (std::size_t line_number = 1u; std::getline(input, line); ++line_number) {
+		std::size_t arguments_start = 0u;
+		auto const directive = getDirective(line, arguments_start);
+
+		if (directive == "version") {
+			parsed_file.segments.push_back({ Segment::Type::version, line + "\n", line_number });
+			continue;
+		}
+
+		if (directive == "include") {
+			auto const path_start = line.find_first_of("\"<", arguments_start);
+			auto const path_end = path_start == std::string::npos ? std::string::npos
+			                                                      : line.find(line[path_start] == '"' ? '"' : '>', path_start + 1u);
+			if (path_end == std::string::npos) {
+				LogError("Malformed #include on line %zu of \"%s\".", line_number, filename.c_str());
+				parsed_files.erase(filename);
+				return nullptr;
+			}
+			auto const path = line.substr(path_start + 1u, path_end - path_start - 1u);
+			parsed_file.segments.push_back({ Segment::Type::include, getDirectory(filename) + "/" + path, line_number });
+			continue;
+		}
+
+		if (parsed_file.segments.empty() || parsed_file.segments.back().type != Segment::Type::text)
+			parsed_file.segments.push_back({ Segment::Type::text, std::string(), line_number });
+		parsed_file.segments.back().content += line + "\n";
+	}
+
+	return &parsed_file;
+}
+
+bool ShaderPreprocessor::Expand(std::string const& filename, std::size_t file_index, std::vector<std::string> const& defines, Result& result)
+{
+	auto const parsed_file = Parse(filename);
+	if (parsed_file == nullptr)
+		return false;
+
+	std::string injected_defines;
+	for (auto const& define : defines)
+		injected_defines += "#define " + define + "\n";
+
+	bool was_version_found = false;
+	for (auto const& segment : parsed_file->segments) {
+		switch (segment.type) {
+			case Segment::Type::text:
+				result.source += segment.content;
+				break;
+
+			case Segment::Type::version:
+				// Only the shader itself gets to pick the version.
+				if (file_index != 0u) {
+					result.source += "\n";
+					break;
+				}
+				result.source += segment.content;
+				if (!injected_defines.empty()) {
+					result.source += injected_defines;
+					result.source += makeLineDirective(segment.line + 1u, file_index);
+				}
+				was_version_found = true;
+				break;
+
+			case Segment::Type::include:
+			{
+				auto const& included_filename = segment.content;
+				if (std::find(result.files.begin(), result.files.end(), included_filename) != result.files.end()) {
+					// Already included; keep the line count unchanged.
+					result.source += "\n";
+					break;
+				}
+
+				auto const included_file_index = result.files.size();
+				result.files.push_back(included_filename);
+				result.source += makeLineDirective(1u, included_file_index);
+				if (!Expand(included_filename, included_file_index, defines, result)) {
+					LogError("Failed to include \"%s\" from line %zu of \"%s\".", included_filename.c_str(), segment.line, filename.c_str());
+					return false;
+				}
+				result.source += makeLineDirective(segment.line + 1u, file_index);
+				break;
+			}
+		}
+	}
+
+	// Without any #version directive, definitions can go first.
+	if (file_index == 0u && !was_version_found && !injected_defines.empty())
+		result.source = injected_defines + makeLineDirective(1u, file_index) + result.source;
+
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Expand the #include directives of GLSL shaders, and inject
+//!        preprocessor definitions.
+//!
+//! Included paths are relative to the including file, and written as
+//! either `#include "file.glsl"` or `#include <file.glsl>`. A file is only
+//! ever included once per shader, as if it started with `#pragma once`.
+//!
+//! As GLSL #line directives only accept a number to identify the source,
+//! each file gets one, starting from 0 for the shader itself, in the order
+//! listed by Result::files; RemapLog() puts the file names back into the
+//! compilation logs.
+//!
+//! Files are read again on every call, so that changes get picked up, but
+//! only parsed again if their content changed.
+class ShaderPreprocessor
+{
+public:
+	struct Result
+	{
+		std::string source;               //!< Empty if preprocessing failed
+		std::vector<std::string> files;   //!< All files read, shader first; the index is the #line source number
+	};
+
+	//! \brief Preprocess the shader |filename|.
+	//!
+	//! @param [in] filename Path of the shader
+	//! @param [in] defines Definitions inserted right after the #version
+	//!             directive, each as "NAME" or "NAME VALUE"
+	//! @return The preprocessed source along with all files it depends on;
+	//!         the files are listed even when preprocessing fails, so that
+	//!         fixing any of them can be noticed
+	Result Process(std::string const& filename, std::vector<std::string> const& defines = std::vector<std::string>());
+
+	//! \brief Replace the source numbers in a compilation |log| by the
+	//!        names of the corresponding |files|.
+	static std::string RemapLog(std::string const& log, std::vector<std::string> const& files);
+
+private:
+	struct Segment
+	{
+		enum class Type { text, version, include };
+
+		Type type;
+		std::string content;    //!< Text, #version directive, or resolved path of the included file
+		std::size_t line;       //!< Line the segment starts on, from 1
+	};
+
+	struct ParsedFile
+	{
+		std::uint64_t content_hash;
+		std::vector<Segment> segments;
+	};
+
+	ParsedFile const* Parse(std::string const& filename);
+	bool Expand(std::string const& filename, std::size_t file_index, std::vector<std::string> const& defines, Result& result);
+
+	std::unordered_map<std::string, ParsedFile> parsed_files;
+};
@@ -2,69 +2,222 @@
 
 #include "config.hpp"
 
+#include "helpers.hpp"
 #include "Log.h"
 #include "opengl.hpp"
 #include "various.hpp"
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <chrono>
+#include <set>
 #include <type_traits>
 
+namespace
+{
+	// GL_KHR_parallel_shader_compile and GL_ARB_parallel_shader_compile
+	// share their enums, and the bundled loader exposes neither.
+	constexpr GLenum completion_status = 0x91B1;
+	constexpr GLuint any_compiler_threads_count = 0xFFFFFFFFu;
+	typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+	float getElapsedMs(std::chrono::high_resolution_clock::time_point const& start_time)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start_time).count();
+	}
+}
+
+ShaderProgramManager::ShaderProgramManager()
+{
+	std::pair<char const*, char const*> const extensions[] = {
+		{ "GL_KHR_parallel_shader_compile", "glMaxShaderCompilerThreadsKHR" },
+		{ "GL_ARB_parallel_shader_compile", "glMaxShaderCompilerThreadsARB" }
+	};
+	for (auto const& extension : extensions) {
+		if (glfwExtensionSupported(extension.first) != GLFW_TRUE)
+			continue;
+
+		// Let the driver pick how many threads to compile on.
+		auto const max_shader_compiler_threads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSPROC>(glfwGetProcAddress(extension.second));
+		if (max_shader_compiler_threads != nullptr)
+			max_shader_compiler_threads(any_compiler_threads_count);
+		is_parallel_compile_supported = true;
+		break;
+	}
+}
+
 ShaderProgramManager::~ShaderProgramManager()
 {
-	for (auto const& i : program_entries) {
-		if (i.first != 0u) {
-			glDeleteProgram(i.first);
-			i.first = 0u;
-		}
+	for (auto const& pending_program : pending_programs) {
+		for (auto const shader : pending_program.shaders)
+			glDeleteShader(shader);
+		glDeleteProgram(pending_program.program);
 	}
+
+	// Variables aliased by the GLuint& overloads usually die before the
+	// manager, so they are left alone.
+	for (auto& entry : program_entries)
+		bonobo::getResourceRegistry().Release(entry.program);
+}
+
+ResourceHandle ShaderProgramManager::CreateAndRegisterProgram(char const* const program_name, ProgramData const& program_data)
+{
+	auto const entry = CreateAndRegisterProgramEntry(program_name, program_data, false);
+	return entry != nullptr ? entry->program : ResourceHandle();
 }
 
 void ShaderProgramManager::CreateAndRegisterProgram(char const* const program_name, ProgramData const& program_data, GLuint& program)
 {
-	if (!GLAD_GL_ARB_compute_shader) {
-		for (auto const& i : program_data) {
-			if (i.first == ShaderType::compute) {
-				LogError("Compute shaders aren't exposed on your computer (needed for shader '%s'.", i.second.c_str());
-				return;
-			}
-		}
-	}
+	AliasProgram(CreateAndRegisterProgramEntry(program_name, program_data, false), program);
+}
 
-	program_entries.emplace_back(program, program_data);
-	program_names.emplace_back(program_name);
+ResourceHandle ShaderProgramManager::CreateAndRegisterProgramDeferred(char const* const program_name, ProgramData const& program_data)
+{
+	auto const entry = CreateAndRegisterProgramEntry(program_name, program_data, true);
+	return entry != nullptr ? entry->program : ResourceHandle();
+}
 
-	ProcessProgram(program_entries.size() - 1);
+void ShaderProgramManager::CreateAndRegisterProgramDeferred(char const* const program_name, ProgramData const& program_data, GLuint& program)
+{
+	AliasProgram(CreateAndRegisterProgramEntry(program_name, program_data, true), program);
+}
+
+ResourceHandle ShaderProgramManager::CreateAndRegisterComputeProgram(char const* const program_name, std::string const& filename)
+{
+	return CreateAndRegisterProgram(program_name, ProgramData{ { ShaderType::compute, filename } });
 }
 
 void ShaderProgramManager::CreateAndRegisterComputeProgram(char const* const program_name, std::string const& filename, GLuint& program)
 {
-	if (!GLAD_GL_ARB_compute_shader) {
-		LogError("Compute shaders aren't exposed on your computer (needed for shader '%s'.", filename.c_str());
-		return;
+	CreateAndRegisterProgram(program_name, ProgramData{ { ShaderType::compute, filename } }, program);
+}
+
+GLuint ShaderProgramManager::GetProgram(ResourceHandle const program) const
+{
+	return bonobo::getResourceRegistry().Get(program);
+}
+
+ShaderProgramManager::ProgramVariantsId ShaderProgramManager::CreateAndRegisterProgramVariants(char const* const program_name, ProgramData const& program_data, std::vector<std::string> const& keywords)
+{
+	constexpr auto max_keywords_nb = sizeof(VariantMask) * 8u;
+	if (keywords.size() > max_keywords_nb)
+		LogError("Program '%s' declares %zu keywords, but only the first %zu can be used.", program_name, keywords.size(), max_keywords_nb);
+
+	ProgramVariants variants;
+	variants.name = program_name;
+	variants.program_data = program_data;
+	variants.keywords.assign(keywords.begin(), keywords.begin() + std::min(keywords.size(), max_keywords_nb));
+	program_variants.push_back(std::move(variants));
+
+	return program_variants.size() - 1;
+}
+
+ShaderProgramManager::VariantMask ShaderProgramManager::GetVariantMask(ProgramVariantsId const variants, std::vector<std::string> const& enabled_keywords) const
+{
+	auto const& keywords = program_variants[variants].keywords;
+
+	VariantMask mask = 0u;
+	for (std::size_t i = 0u; i < keywords.size(); ++i) {
+		if (std::find(enabled_keywords.begin(), enabled_keywords.end(), keywords[i]) != enabled_keywords.end())
+			mask |= VariantMask(1u) << i;
 	}
+	return mask;
+}
 
-	program_entries.emplace_back(program, ProgramData{ { ShaderType::compute, filename } });
-	program_names.emplace_back(program_name);
+GLuint ShaderProgramManager::GetProgramVariant(ProgramVariantsId const variants, VariantMask const mask)
+{
+	auto const& variant_set = program_variants[variants];
+	auto const program_index = variant_set.program_indices.find(mask);
+	if (program_index != variant_set.program_indices.end()) {
+		// Previously warmed up; make sure it is done building.
+		ResolveProgramNow(program_index->second);
+		return program_entries[program_index->second].current_program;
+	}
 
-	ProcessProgram(program_entries.size() - 1);
+	auto const new_program_index = RegisterProgramVariant(variants, mask);
+	SubmitProgram(new_program_index);
+	ResolveProgramNow(new_program_index);
+	return program_entries[new_program_index].current_program;
 }
 
-bool ShaderProgramManager::ReloadAllPrograms()
+void ShaderProgramManager::WarmProgramVariants(ProgramVariantsId const variants, std::vector<VariantMask> const& masks)
+{
+	auto const& variant_set = program_variants[variants];
+	for (auto const mask : masks) {
+		if (variant_set.program_indices.find(mask) == variant_set.program_indices.end())
+			SubmitProgram(RegisterProgramVariant(variants, mask));
+	}
+}
+
+bool ShaderProgramManager::ResolvePendingPrograms(bool const wait)
 {
+	// Without any completion query, checking whether a program is ready
+	// would block just as much as waiting for it.
+	if (pending_programs.empty() || (!wait && !is_parallel_compile_supported))
+		return true;
+
 	bool encountered_failures = false;
-	for (std::size_t i = 0; i < program_entries.size(); ++i) {
-		auto& program = program_entries[i].first;
-		if (program != 0u)
-			glDeleteProgram(program);
-		program = 0u;
-		ProcessProgram(i);
-		encountered_failures |= program == 0u;
+	std::vector<PendingProgram> still_pending_programs;
+	for (auto const& pending_program : pending_programs) {
+		if (!wait) {
+			GLint is_completed = GL_FALSE;
+			glGetProgramiv(pending_program.program, completion_status, &is_completed);
+			if (is_completed == GL_FALSE) {
+				still_pending_programs.push_back(pending_program);
+				continue;
+			}
+		}
+		encountered_failures |= !ResolveProgram(pending_program);
 	}
+	pending_programs = std::move(still_pending_programs);
+
+	return !encountered_failures;
+}
+
+bool ShaderProgramManager::HasPendingPrograms() const
+{
+	return !pending_programs.empty();
+}
+
+bool ShaderProgramManager::ReloadAllPrograms()
+{
+	// Submit everything before checking anything, so that the reload takes
+	// about as long as building the slowest program.
+	bool encountered_failures = false;
+	for (std::size_t i = 0; i < program_entries.size(); ++i)
+		encountered_failures |= !SubmitProgram(i);
 
+	encountered_failures |= !ResolvePendingPrograms();
+
+	// The caller already knows programs got replaced.
+	were_programs_replaced = false;
 	return !encountered_failures;
 }
 
+bool ShaderProgramManager::ReloadChangedPrograms()
+{
+	std::set<std::size_t> changed_programs;
+	for (auto const& filename : file_watcher.PollChanges()) {
+		auto const dependents = file_dependents.find(filename);
+		if (dependents == file_dependents.end())
+			continue;
+		LogInfo("Shader '%s' changed: rebuilding %zu program(s).", filename.c_str(), dependents->second.size());
+		changed_programs.insert(dependents->second.begin(), dependents->second.end());
+	}
+
+	for (auto const program_index : changed_programs)
+		SubmitProgram(program_index);
+
+	// Without parallel compilation, the programs are built right away
+	// anyway, so there is no point in waiting for another frame.
+	ResolvePendingPrograms(!is_parallel_compile_supported);
+
+	auto const were_replaced = were_programs_replaced;
+	were_programs_replaced = false;
+	return were_replaced;
+}
+
 ShaderProgramManager::SelectedProgram ShaderProgramManager::SelectProgram(std::string const& label, std::int32_t& program_index)
 {
 	SelectedProgram selection_result;
@@ -74,41 +227,332 @@ ShaderProgramManager::SelectedProgram ShaderProgramManager::SelectProgram(std::s
 	}
 
 	selection_result.was_selection_changed = ImGui::Combo(label.c_str(), &program_index, program_names.data(), static_cast<int>(program_names.size()));
-	selection_result.program = &program_entries.at(program_index).first;
+
+	// The selected program is about to be used; others can keep building
+	// in the background.
+	ResolveProgramNow(static_cast<std::size_t>(program_index));
+	selection_result.program = &program_entries.at(program_index).current_program;
+	selection_result.handle = program_entries.at(program_index).program;
 	selection_result.name = program_names.at(program_index);
 	return selection_result;
 }
 
-void ShaderProgramManager::ProcessProgram(std::size_t const program_index)
+void ShaderProgramManager::SetUniformBlockBinding(std::string const& block_name, GLuint const binding)
+{
+	uniform_block_bindings[block_name] = binding;
+	for (auto const& reflection : program_reflections) {
+		auto const block_index = reflection.second.uniform_blocks.find(block_name);
+		if (block_index != reflection.second.uniform_blocks.end())
+			glUniformBlockBinding(reflection.first, block_index->second, binding);
+	}
+}
+
+GLint ShaderProgramManager::GetUniformLocation(GLuint const program, std::string const& name) const
 {
-	auto& program_entry = program_entries[program_index];
-	auto& program = program_entry.first;
-	auto const& program_data = program_entry.second;
+	auto const reflection = program_reflections.find(program);
+	if (reflection == program_reflections.end())
+		return -1;
+	auto const location = reflection->second.uniforms.find(name);
+	return location != reflection->second.uniforms.end() ? location->second : -1;
+}
 
-	std::vector<GLuint> shaders;
-	shaders.reserve(program_data.size());
+GLuint ShaderProgramManager::GetUniformBlockIndex(GLuint const program, std::string const& name) const
+{
+	auto const reflection = program_reflections.find(program);
+	if (reflection == program_reflections.end())
+		return GL_INVALID_INDEX;
+	auto const block_index = reflection->second.uniform_blocks.find(name);
+	return block_index != reflection->second.uniform_blocks.end() ? block_index->second : GL_INVALID_INDEX;
+}
 
+GLint ShaderProgramManager::GetAttributeLocation(GLuint const program, std::string const& name) const
+{
+	auto const reflection = program_reflections.find(program);
+	if (reflection == program_reflections.end())
+		return -1;
+	auto const location = reflection->second.attributes.find(name);
+	return location != reflection->second.attributes.end() ? location->second : -1;
+}
+
+ShaderProgramManager::LoadingStatistics const& ShaderProgramManager::GetLoadingStatistics() const
+{
+	return loading_statistics;
+}
+
+void ShaderProgramManager::LogLoadingStatistics() const
+{
+	LogInfo("Built %zu programs from source in %.1f ms, and loaded %zu from the binary cache in %.1f ms.",
+	        loading_statistics.built_programs_nb, loading_statistics.built_programs_ms,
+	        loading_statistics.cached_programs_nb, loading_statistics.cached_programs_ms);
+}
+
+bool ShaderProgramManager::SubmitProgram(std::size_t const program_index)
+{
+	auto const start_time = std::chrono::high_resolution_clock::now();
+
+	// Any build still in progress for this program uses outdated sources.
+	DiscardPendingProgram(program_index);
+
+	auto const& program_data = program_entries[program_index].program_data;
+
+	// The cache key covers everything handed over to the driver, includes
+	// and definitions included, so that edited shaders never pick up a
+	// stale binary.
+	std::vector<ShaderPreprocessor::Result> preprocessed_shaders;
+	std::vector<std::string> cache_key_inputs;
+	preprocessed_shaders.reserve(program_data.size());
+	cache_key_inputs.reserve(2u * program_data.size());
 	for (auto const& i : program_data) {
 		std::string const full_filename = config::shaders_path(i.second);
-		auto const shader_source = utils::slurp_file(full_filename);
-		if (shader_source.empty()) {
-			LogError("Retrieval of shader '%s' failed; see previous message for details.", full_filename.c_str());
-			return;
+		auto preprocessed_shader = preprocessor.Process(full_filename, program_defines[program_index]);
+
+		// Watch all files even if they cannot be read yet, so that the
+		// program gets built once they are fixed.
+		for (auto const& filename : preprocessed_shader.files) {
+			auto& dependents = file_dependents[filename];
+			if (std::find(dependents.begin(), dependents.end(), program_index) == dependents.end())
+				dependents.push_back(program_index);
+			file_watcher.Watch(filename);
 		}
 
-		GLuint shader = utils::opengl::shader::generate_shader(static_cast<std::underlying_type<ShaderType>::type>(i.first), shader_source);
-		if (shader == 0u) {
-			for (auto& shader : shaders)
-				glDeleteShader(shader);
-			LogError("Compilation of shader '%s' failed; see previous message for details.", full_filename.c_str());
-			return;
+		if (preprocessed_shader.source.empty()) {
+			LogError("Retrieval of shader '%s' failed; see previous message for details.", full_filename.c_str());
+			return false;
 		}
-		shaders.push_back(shader);
+		cache_key_inputs.emplace_back(std::to_string(static_cast<std::underlying_type<ShaderType>::type>(i.first)));
+		cache_key_inputs.emplace_back(preprocessed_shader.source);
+		preprocessed_shaders.emplace_back(std::move(preprocessed_shader));
+	}
+
+	auto const cache_key = binary_cache.ComputeKey(cache_key_inputs);
+	auto const cached_program = binary_cache.Load(cache_key);
+	if (cached_program != 0u) {
+		ReplaceProgram(program_index, cached_program);
+		auto const elapsed_ms = getElapsedMs(start_time);
+		++loading_statistics.cached_programs_nb;
+		loading_statistics.cached_programs_ms += elapsed_ms;
+		LogTrivia("Loaded program '%s' from the binary cache in %.2f ms.", program_names[program_index], elapsed_ms);
+		return true;
 	}
 
-	program = utils::opengl::shader::generate_program(shaders);
-	utils::opengl::debug::nameObject(GL_PROGRAM, program, program_names[program_index]);
+	// Querying any status or log here would make the driver finish the
+	// work right away; this is left to ResolveProgram().
+	PendingProgram pending_program{ program_index, glCreateProgram(), {}, {}, cache_key };
+	pending_program.shaders.reserve(program_data.size());
+	pending_program.shader_files.reserve(program_data.size());
+	std::size_t shader_index = 0u;
+	for (auto const& i : program_data) {
+		auto& preprocessed_shader = preprocessed_shaders[shader_index++];
+		GLuint const shader = glCreateShader(static_cast<std::underlying_type<ShaderType>::type>(i.first));
+		GLchar const* source = preprocessed_shader.source.c_str();
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+		glAttachShader(pending_program.program, shader);
+		pending_program.shaders.push_back(shader);
+		pending_program.shader_files.emplace_back(std::move(preprocessed_shader.files));
+	}
+
+	// Must be set before linking, for glGetProgramBinary() to work.
+	if (binary_cache.IsSupported())
+		glProgramParameteri(pending_program.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(pending_program.program);
+	pending_programs.push_back(pending_program);
+
+	loading_statistics.built_programs_ms += getElapsedMs(start_time);
+	return true;
+}
+
+bool ShaderProgramManager::ResolveProgram(PendingProgram const& pending_program)
+{
+	auto const start_time = std::chrono::high_resolution_clock::now();
+	auto const program_name = program_names[pending_program.program_index];
+
+	bool were_shaders_compiled = true;
+	for (std::size_t i = 0u; i < pending_program.shaders.size(); ++i) {
+		auto const& files = pending_program.shader_files[i];
+		auto const remap_log = [&files](std::string const& log) { return ShaderPreprocessor::RemapLog(log, files); };
+		were_shaders_compiled &= utils::opengl::shader::check_shader_compilation(pending_program.shaders[i], remap_log);
+	}
+	auto const was_program_linked = were_shaders_compiled && utils::opengl::shader::check_program_linking(pending_program.program);
 
-	for (auto& shader : shaders)
+	for (auto const shader : pending_program.shaders)
 		glDeleteShader(shader);
+
+	if (!was_program_linked) {
+		glDeleteProgram(pending_program.program);
+		if (program_entries[pending_program.program_index].current_program != 0u)
+			LogError("Building program '%s' failed, so its previous version is kept; see previous messages for details.", program_name);
+		else
+			LogError("Building program '%s' failed; see previous messages for details.", program_name);
+		return false;
+	}
+
+	binary_cache.Store(pending_program.cache_key, pending_program.program);
+	ReplaceProgram(pending_program.program_index, pending_program.program);
+
+	++loading_statistics.built_programs_nb;
+	loading_statistics.built_programs_ms += getElapsedMs(start_time);
+	LogTrivia("Built program '%s' from source.", program_name);
+	return true;
+}
+
+void ShaderProgramManager::ReplaceProgram(std::size_t const program_index, GLuint const program)
+{
+	auto& entry = program_entries[program_index];
+	if (entry.current_program != 0u) {
+		program_reflections.erase(entry.current_program);
+		were_programs_replaced = true;
+	}
+	// The previous version gets deleted, and the handle now refers to the
+	// new one.
+	bonobo::getResourceRegistry().Replace(entry.program, program);
+	entry.current_program = program;
+	if (entry.program_alias != nullptr)
+		*entry.program_alias = program;
+	ReflectProgram(program);
+}
+
+void ShaderProgramManager::ReflectProgram(GLuint const program)
+{
+	auto& reflection = program_reflections[program];
+	reflection = ProgramReflection();
+
+	GLint max_name_length = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+	std::vector<GLchar> name(static_cast<std::size_t>(std::max(max_name_length, 1)));
+
+	GLint uniforms_nb = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniforms_nb);
+	for (GLint i = 0; i < uniforms_nb; ++i) {
+		GLsizei name_length = 0;
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &name_length, &size, &type, name.data());
+		std::string const uniform_name(name.data(), static_cast<std::size_t>(name_length));
+
+		// Members of uniform blocks have no location of their own.
+		auto const location = glGetUniformLocation(program, uniform_name.c_str());
+		if (location < 0)
+			continue;
+		reflection.uniforms.emplace(uniform_name, location);
+
+		// Arrays are reported through their first element.
+		auto const array_suffix_start = uniform_name.size() >= 3u ? uniform_name.size() - 3u : 0u;
+		if (uniform_name.compare(array_suffix_start, std::string::npos, "[0]") == 0)
+			reflection.uniforms.emplace(uniform_name.substr(0u, array_suffix_start), location);
+	}
+
+	GLint blocks_nb = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blocks_nb);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_name_length);
+	name.resize(std::max(name.size(), static_cast<std::size_t>(std::max(max_name_length, 1))));
+	for (GLint i = 0; i < blocks_nb; ++i) {
+		GLsizei name_length = 0;
+		glGetActiveUniformBlockName(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &name_length, name.data());
+		std::string const block_name(name.data(), static_cast<std::size_t>(name_length));
+		reflection.uniform_blocks.emplace(block_name, static_cast<GLuint>(i));
+
+		auto const binding = uniform_block_bindings.find(block_name);
+		if (binding != uniform_block_bindings.end())
+			glUniformBlockBinding(program, static_cast<GLuint>(i), binding->second);
+	}
+
+	GLint attributes_nb = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attributes_nb);
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_name_length);
+	name.resize(std::max(name.size(), static_cast<std::size_t>(std::max(max_name_length, 1))));
+	for (GLint i = 0; i < attributes_nb; ++i) {
+		GLsizei name_length = 0;
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		glGetActiveAttrib(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &name_length, &size, &type, name.data());
+		std::string const attribute_name(name.data(), static_cast<std::size_t>(name_length));
+		reflection.attributes.emplace(attribute_name, glGetAttribLocation(program, attribute_name.c_str()));
+	}
+}
+
+void ShaderProgramManager::DiscardPendingProgram(std::size_t const program_index)
+{
+	auto const pending_program = std::find_if(pending_programs.begin(), pending_programs.end(),
+	                                          [program_index](PendingProgram const& p) { return p.program_index == program_index; });
+	if (pending_program == pending_programs.end())
+		return;
+
+	for (auto const shader : pending_program->shaders)
+		glDeleteShader(shader);
+	glDeleteProgram(pending_program->program);
+	pending_programs.erase(pending_program);
+}
+
+std::size_t ShaderProgramManager::RegisterProgram(char const* const program_name, ProgramData const& program_data, std::vector<std::string> const& defines)
+{
+	auto& registry = bonobo::getResourceRegistry();
+	ResourceRegistry::OwnerScope const owner_scope(registry, "Shader program manager");
+
+	ProgramEntry entry;
+	entry.program = registry.Reserve(ResourceType::program, program_name);
+	entry.program_data = program_data;
+	program_entries.push_back(std::move(entry));
+	program_names.emplace_back(program_name);
+	program_defines.emplace_back(defines);
+	return program_entries.size() - 1;
+}
+
+ShaderProgramManager::ProgramEntry* ShaderProgramManager::CreateAndRegisterProgramEntry(char const* const program_name, ProgramData const& program_data, bool const is_deferred)
+{
+	if (!GLAD_GL_ARB_compute_shader) {
+		for (auto const& i : program_data) {
+			if (i.first == ShaderType::compute) {
+				LogError("Compute shaders aren't exposed on your computer (needed for shader '%s'.", i.second.c_str());
+				return nullptr;
+			}
+		}
+	}
+
+	auto const program_index = RegisterProgram(program_name, program_data, {});
+	SubmitProgram(program_index);
+	if (!is_deferred)
+		ResolveProgramNow(program_index);
+	return &program_entries[program_index];
+}
+
+void ShaderProgramManager::AliasProgram(ProgramEntry* const entry, GLuint& program)
+{
+	if (entry == nullptr)
+		return;
+
+	program = entry->current_program;
+	entry->program_alias = &program;
+}
+
+std::size_t ShaderProgramManager::RegisterProgramVariant(ProgramVariantsId const variants, VariantMask const mask)
+{
+	auto& variant_set = program_variants[variants];
+
+	std::vector<std::string> defines;
+	std::string name = variant_set.name + " (";
+	for (std::size_t i = 0u; i < variant_set.keywords.size(); ++i) {
+		if ((mask & (VariantMask(1u) << i)) == 0u)
+			continue;
+		name += (defines.empty() ? "" : ", ") + variant_set.keywords[i];
+		defines.push_back(variant_set.keywords[i]);
+	}
+	name += defines.empty() ? "no keywords)" : ")";
+	variant_names.push_back(std::move(name));
+
+	auto const program_index = RegisterProgram(variant_names.back().c_str(), variant_set.program_data, defines);
+	variant_set.program_indices.emplace(mask, program_index);
+	return program_index;
+}
+
+void ShaderProgramManager::ResolveProgramNow(std::size_t const program_index)
+{
+	auto const pending_program = std::find_if(pending_programs.begin(), pending_programs.end(),
+	                                          [program_index](PendingProgram const& p) { return p.program_index == program_index; });
+	if (pending_program == pending_programs.end())
+		return; // Already resolved, or loaded from the binary cache.
+
+	auto const program = *pending_program;
+	pending_programs.erase(pending_program);
+	ResolveProgram(program);
 }
@@ -1,10 +1,17 @@
 #pragma once
 
+#include "FileWatcher.hpp"
+#include "ProgramBinaryCache.hpp"
+#include "ResourceRegistry.hpp"
+#include "ShaderPreprocessor.hpp"
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <deque>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -23,20 +30,168 @@ class ShaderProgramManager
 {
 public:
 	using ProgramData = std::map<ShaderType, std::string>;
+	using ProgramVariantsId = std::size_t;
+	using VariantMask = std::uint32_t; //!< Bit i enables the ith keyword of a program with variants.
 	struct SelectedProgram {
 		bool was_selection_changed = false;
-		GLuint const* program = nullptr;
+		GLuint const* program = nullptr; //!< Kept up to date with the latest version of the program
+		ResourceHandle handle;
 		char const* name = nullptr;
 	};
+	//! \brief How long it took to get programs ready, split between those
+	//!        built from source and those loaded from the binary cache.
+	struct LoadingStatistics {
+		std::size_t built_programs_nb = 0u;
+		std::size_t cached_programs_nb = 0u;
+		float built_programs_ms = 0.0f;
+		float cached_programs_ms = 0.0f;
+	};
+	ShaderProgramManager();
 	~ShaderProgramManager();
+	//! \brief Build a program and register it for reloading.
+	//!
+	//! The program is owned by the manager: the handle returned keeps
+	//! referring to the latest version of the program as it gets rebuilt,
+	//! and resolves to 0 through GetProgram() as long as no version could
+	//! be built.
+	ResourceHandle CreateAndRegisterProgram(char const* const program_name, ProgramData const& program_data);
+	//! \brief Same as above, but also keep |program| set to the latest
+	//!        version of the program, or to 0 while there is none.
 	void CreateAndRegisterProgram(char const* const program_name, ProgramData const& program_data, GLuint& program);
+	//! \brief Submit a program to the driver and register it for
+	//!        reloading, without waiting for it to be built.
+	//!
+	//! The program resolves to 0 until it gets resolved, either by
+	//! ResolvePendingPrograms() or when first selected through
+	//! SelectProgram(); submitting all programs before resolving any lets
+	//! the driver build them concurrently.
+	ResourceHandle CreateAndRegisterProgramDeferred(char const* const program_name, ProgramData const& program_data);
+	void CreateAndRegisterProgramDeferred(char const* const program_name, ProgramData const& program_data, GLuint& program);
+	ResourceHandle CreateAndRegisterComputeProgram(char const* const program_name, std::string const& filename);
 	void CreateAndRegisterComputeProgram(char const* const program_name, std::string const& filename, GLuint& program);
+	//! \brief Return the latest version of |program|, or 0 if none could be
+	//!        built yet.
+	GLuint GetProgram(ResourceHandle program) const;
+	//! \brief Declare a program specialised on |keywords|, up to 32 of them.
+	//!
+	//! Each variant is built with the keywords it enables #define'd, the
+	//! first time it is requested through GetProgramVariant() or
+	//! WarmProgramVariants(), and is then reloaded like any other program.
+	ProgramVariantsId CreateAndRegisterProgramVariants(char const* const program_name, ProgramData const& program_data, std::vector<std::string> const& keywords);
+	//! \brief Return the mask enabling the |enabled_keywords| which were
+	//!        declared by |variants|; other keywords are ignored.
+	VariantMask GetVariantMask(ProgramVariantsId variants, std::vector<std::string> const& enabled_keywords) const;
+	//! \brief Return the variant of |variants| enabling the keywords set in
+	//!        |mask|, building it if needed.
+	//!
+	//! @return The program, or 0 if it failed to build; a failed variant is
+	//!         only attempted again once its files change
+	GLuint GetProgramVariant(ProgramVariantsId variants, VariantMask mask);
+	//! \brief Submit the given variants of |variants| which were not
+	//!        requested yet, without waiting for them to be built.
+	void WarmProgramVariants(ProgramVariantsId variants, std::vector<VariantMask> const& masks);
+	//! \brief Check the outcome of submitted programs, and hand out the
+	//!        successful ones.
+	//!
+	//! @param [in] wait Whether to wait for all programs to be built; if
+	//!             false, only programs the driver reports as completed are
+	//!             resolved, which requires GL_KHR_parallel_shader_compile
+	//!             or GL_ARB_parallel_shader_compile
+	//! @return Whether all resolved programs were built successfully
+	bool ResolvePendingPrograms(bool wait = true);
+	bool HasPendingPrograms() const;
+	//! \brief Rebuild all programs; a program which fails to build keeps
+	//!        its previous version.
 	bool ReloadAllPrograms();
+	//! \brief Rebuild the programs using shader files modified since the
+	//!        previous call, without blocking if the driver supports
+	//!        parallel compilation; a program which fails to build keeps
+	//!        its previous version.
+	//!
+	//! @return Whether any program got replaced, since the last call to
+	//!         this function, by a new version; uniform locations and
+	//!         block bindings need to be set up again for those.
+	bool ReloadChangedPrograms();
+	//! \brief Let the user pick one of the registered programs from a combo
+	//!        box; only the selected program is waited for if still being
+	//!        built.
 	SelectedProgram SelectProgram(std::string const& label, std::int32_t& program_index);
+	//! \brief Bind the uniform block |block_name| to |binding| in all
+	//!        programs declaring it, current and future ones alike, and
+	//!        whenever they get rebuilt.
+	void SetUniformBlockBinding(std::string const& block_name, GLuint binding);
+	//! \brief Return the location of the active uniform |name| of
+	//!        |program|, or -1 if it has none.
+	//!
+	//! Active uniforms, blocks and attributes are listed once after each
+	//! build of a managed program, so unlike glGetUniformLocation() and
+	//! friends, these lookups never stall on the driver, and the current
+	//! value of a program can be passed in right after a reload. Arrays
+	//! can be looked up with or without their "[0]" suffix.
+	GLint GetUniformLocation(GLuint program, std::string const& name) const;
+	//! \brief Return the index of the active uniform block |name| of
+	//!        |program|, or GL_INVALID_INDEX if it has none.
+	GLuint GetUniformBlockIndex(GLuint program, std::string const& name) const;
+	//! \brief Return the location of the active attribute |name| of
+	//!        |program|, or -1 if it has none.
+	GLint GetAttributeLocation(GLuint program, std::string const& name) const;
+	LoadingStatistics const& GetLoadingStatistics() const;
+	void LogLoadingStatistics() const;
 
 private:
-	void ProcessProgram(std::size_t program_index);
-	using ProgramEntry = std::pair<GLuint&, ProgramData>;
-	std::vector<ProgramEntry> program_entries;
+	struct PendingProgram {
+		std::size_t program_index;
+		GLuint program;
+		std::vector<GLuint> shaders;
+		std::vector<std::vector<std::string>> shader_files; //!< Files each shader was preprocessed from, to make sense of the logs
+		std::uint64_t cache_key;
+	};
+
+	struct ProgramReflection {
+		std::unordered_map<std::string, GLint> uniforms;
+		std::unordered_map<std::string, GLuint> uniform_blocks;
+		std::unordered_map<std::string, GLint> attributes;
+	};
+
+	struct ProgramVariants {
+		std::string name;
+		ProgramData program_data;
+		std::vector<std::string> keywords;
+		std::map<VariantMask, std::size_t> program_indices;  //!< Index in |program_entries| of each requested variant
+	};
+
+	struct ProgramEntry {
+		ResourceHandle program;             //!< Reserved at registration, and given each new version of the program
+		GLuint current_program = 0u;        //!< Same program, for those keeping a pointer to it
+		GLuint* program_alias = nullptr;    //!< Variable of the caller kept up to date, for the overloads taking one
+		ProgramData program_data;
+	};
+
+	std::size_t RegisterProgram(char const* const program_name, ProgramData const& program_data, std::vector<std::string> const& defines);
+	//! @return The new entry, or nullptr if the program cannot be built here
+	ProgramEntry* CreateAndRegisterProgramEntry(char const* const program_name, ProgramData const& program_data, bool is_deferred);
+	//! \brief Keep |program| set to the latest version of |entry|.
+	static void AliasProgram(ProgramEntry* entry, GLuint& program);
+	std::size_t RegisterProgramVariant(ProgramVariantsId variants, VariantMask mask);
+	bool SubmitProgram(std::size_t program_index);
+	void ResolveProgramNow(std::size_t program_index);
+	bool ResolveProgram(PendingProgram const& pending_program);
+	void ReplaceProgram(std::size_t program_index, GLuint program);
+	void ReflectProgram(GLuint program);
+	void DiscardPendingProgram(std::size_t program_index);
+	std::deque<ProgramEntry> program_entries; //!< A deque, so that pointers to |current_program| stay valid
 	std::vector<char const*> program_names;
+	std::vector<std::vector<std::string>> program_defines;
+	std::deque<ProgramVariants> program_variants;
+	std::deque<std::string> variant_names; //!< Storage for the names of variants, as |program_names| does not own them
+	std::vector<PendingProgram> pending_programs;
+	ShaderPreprocessor preprocessor;
+	FileWatcher file_watcher;
+	std::map<std::string, std::vector<std::size_t>> file_dependents; //!< Indices of the programs using each file
+	ProgramBinaryCache binary_cache;
+	std::unordered_map<GLuint, ProgramReflection> program_reflections;
+	std::map<std::string, GLuint> uniform_block_bindings;
+	LoadingStatistics loading_statistics;
+	bool is_parallel_compile_supported = false;
+	bool were_programs_replaced = false;
 };
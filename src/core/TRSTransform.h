@@ -1,9 +1,15 @@
 #pragma once
 
+#include "BuildSettings.h"
+
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/io.hpp>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 
 /**
@@ -29,6 +35,16 @@
  * of node B to construct new model->world matrices, in the same manner as in
  * the example above.
  *
+ * The matrix returned by GetMatrix() and its inverse are cached, and only
+ * rebuilt when one of T, R or S changed since the last time they were asked
+ * for. As the caches are filled lazily from const member functions, a same
+ * transform should not be queried from several threads at once unless its
+ * matrices are known to be up-to-date; ComposeMatrices() has no such
+ * restriction.
+ *
+ * The rotation is stored as a 3x3 matrix, or as a quaternion if
+ * TRS_TRANSFORM_USE_QUATERNION is enabled in BuildSettings.h.
+ *
  */
 template<typename T, glm::precision P>
 class TRSTransform {
@@ -75,6 +91,8 @@ public:
 	void SetRotateX(T angle);
 	void SetRotateY(T angle);
 	void SetRotateZ(T angle);
+	void SetRotation(glm::tmat3x3<T, P> const& rotation);
+	void SetRotation(glm::tquat<T, P> const& rotation);
 
 
 	void LookTowards(glm::tvec3<T, P> front_vec, glm::tvec3<T, P> up_vec);
@@ -87,10 +105,11 @@ public:
 	// Useful getters
 	///////////////////////////////////////////////////////////////////////////
 
-	glm::tmat4x4<T, P> GetMatrix() const;
-	glm::tmat4x4<T, P> GetMatrixInverse() const;
+	glm::tmat4x4<T, P> const& GetMatrix() const;
+	glm::tmat4x4<T, P> const& GetMatrixInverse() const;
 
 	glm::tmat3x3<T, P> GetRotation() const;
+	glm::tquat<T, P> GetRotationQuaternion() const;
 	glm::tvec3<T, P> GetTranslation() const;
 	glm::tvec3<T, P> GetScale() const;
 
@@ -111,24 +130,78 @@ public:
 	glm::tvec3<T, P> GetFront() const;
 	glm::tvec3<T, P> GetBack() const;
 
+	// Changed every time the transform is modified, so that matrices
+	// derived from it can be cached elsewhere too. Versions are drawn from
+	// a counter shared by all transforms, so two different states never
+	// share a version, even after one transform was assigned to another.
+	std::uint64_t GetVersion() const;
+
+
+	///////////////////////////////////////////////////////////////////////////
+	// Batch operations
+	///////////////////////////////////////////////////////////////////////////
+
+	// Compute `matrices[i] = parent * transforms[i].GetMatrix()` for all
+	// `count` transforms, reusing the cached matrices when up-to-date but
+	// without filling the caches of the others.
+	static void ComposeMatrices(TRSTransform<T, P> const* transforms, std::size_t count,
+	                            glm::tmat4x4<T, P> const& parent, glm::tmat4x4<T, P>* matrices);
+
+
+	///////////////////////////////////////////////////////////////////////////
+	// Statistics, shared by all transforms of the same type
+	///////////////////////////////////////////////////////////////////////////
+
+	// How many times a matrix or inverse matrix was asked for, and how many
+	// times it actually had to be built, since the last reset; both stay at
+	// zero unless ENABLE_PROFILING is set in BuildSettings.h.
+	static std::uint64_t GetMatrixRequestsCount();
+	static std::uint64_t GetMatrixBuildsCount();
+	static void ResetMatrixCounters();
+
+private:
+	void MarkDirty();
+	static void CountMatrixRequests(std::uint64_t count);
+	static void CountMatrixBuild();
+	glm::tmat4x4<T, P> BuildMatrix() const;
+	glm::tmat4x4<T, P> BuildMatrixInverse() const;
+
 protected:
+#if TRS_TRANSFORM_USE_QUATERNION
+	glm::tquat<T, P>	mQ;
+#else
 	glm::tmat3x3<T, P>	mR;
+#endif
 	glm::tvec3<T, P>	mT;
 	glm::tvec3<T, P>	mS;
 
+private:
+	mutable glm::tmat4x4<T, P>	mMatrix;
+	mutable glm::tmat4x4<T, P>	mMatrixInverse;
+	mutable bool				mIsMatrixDirty;
+	mutable bool				mIsMatrixInverseDirty;
+	std::uint64_t				mVersion;
+
+#if ENABLE_PROFILING
+	static std::atomic<std::uint64_t>	sMatrixRequestsCount;
+	static std::atomic<std::uint64_t>	sMatrixBuildsCount;
+#endif
+
 public:
 	friend std::ostream &operator<<(std::ostream &os, TRSTransform<T, P> &v)
 	{
 		os << v.mT << std::endl;
-		os << v.mR << std::endl;
+		os << v.GetRotation() << std::endl;
 		os << v.mS << std::endl;
 		return os;
 	}
 	friend std::istream &operator>>(std::istream &is, TRSTransform<T, P> &v)
 	{
+		glm::tmat3x3<T, P> rotation;
 		is >> v.mT;
-		is >> v.mR;
+		is >> rotation;
 		is >> v.mS;
+		v.SetRotation(rotation);
 		return is;
 	}
 };
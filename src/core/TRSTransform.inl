@@ -5,8 +5,30 @@
 
 /*----------------------------------------------------------------------------*/
 
+namespace TRSTransformDetail
+{
+	// Start at 1, so that 0 can be used to mean "no version yet".
+	inline std::uint64_t NextVersion()
+	{
+		static std::atomic<std::uint64_t> next_version{1u};
+		return next_version.fetch_add(1u, std::memory_order_relaxed);
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+
+#if ENABLE_PROFILING
+template<typename T, glm::precision P>
+std::atomic<std::uint64_t> TRSTransform<T, P>::sMatrixRequestsCount{0u};
+
+template<typename T, glm::precision P>
+std::atomic<std::uint64_t> TRSTransform<T, P>::sMatrixBuildsCount{0u};
+#endif
+
+/*----------------------------------------------------------------------------*/
+
 template<typename T, glm::precision P>
-TRSTransform<T, P>::TRSTransform()
+TRSTransform<T, P>::TRSTransform() : mVersion(TRSTransformDetail::NextVersion())
 {
 	ResetTransform();
 }
@@ -25,7 +47,12 @@ void TRSTransform<T, P>::ResetTransform()
 {
 	mT = glm::tvec3<T, P>(static_cast<T>(0));
 	mS = glm::tvec3<T, P>(static_cast<T>(1));
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = glm::tquat<T, P>(static_cast<T>(1), static_cast<T>(0), static_cast<T>(0), static_cast<T>(0));
+#else
 	mR = glm::tmat3x3<T, P>(static_cast<T>(1));
+#endif
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -34,6 +61,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::Translate(glm::tvec3<T, P> v)
 {
 	mT += v;
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -42,6 +70,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::Scale(glm::tvec3<T, P> v)
 {
 	mS *= v;
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -50,6 +79,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::Scale(T uniform)
 {
 	mS *= uniform;
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -57,7 +87,12 @@ void TRSTransform<T, P>::Scale(T uniform)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::Rotate(T angle, glm::tvec3<T, P> v)
 {
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = glm::normalize(mQ * glm::angleAxis(angle, glm::normalize(v)));
+#else
 	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(mR), angle, v));
+#endif
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -65,12 +100,17 @@ void TRSTransform<T, P>::Rotate(T angle, glm::tvec3<T, P> v)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::RotateX(T angle)
 {
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = glm::normalize(glm::angleAxis(angle, glm::tvec3<T, P>(1, 0, 0)) * mQ);
+#else
 	T C = std::cos(angle);
 	T S = std::sin(angle);
 	mR = glm::tmat3x3<T, P>(
 		mR[0][0], C * mR[0][1] - mR[0][2] * S, C * mR[0][2] + mR[0][1] * S,
 		mR[1][0], C * mR[1][1] - mR[1][2] * S, C * mR[1][2] + mR[1][1] * S,
 		mR[2][0], C * mR[2][1] - mR[2][2] * S, C * mR[2][2] + mR[2][1] * S);
+#endif
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -78,12 +118,17 @@ void TRSTransform<T, P>::RotateX(T angle)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::RotateY(T angle)
 {
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = glm::normalize(glm::angleAxis(angle, glm::tvec3<T, P>(0, 1, 0)) * mQ);
+#else
 	T C = std::cos(angle);
 	T S = std::sin(angle);
 	mR = glm::tmat3x3<T, P>(
 		C * mR[0][0] + mR[0][2] * S, mR[0][1], C * mR[0][2] - mR[0][0] * S,
 		C * mR[1][0] + mR[1][2] * S, mR[1][1], C * mR[1][2] - mR[1][0] * S,
 		C * mR[2][0] + mR[2][2] * S, mR[2][1], C * mR[2][2] - mR[2][0] * S);
+#endif
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -91,12 +136,17 @@ void TRSTransform<T, P>::RotateY(T angle)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::RotateZ(T angle)
 {
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = glm::normalize(glm::angleAxis(angle, glm::tvec3<T, P>(0, 0, 1)) * mQ);
+#else
 	T C = std::cos(angle);
 	T S = std::sin(angle);
 	mR = glm::tmat3x3<T, P>(
 		C * mR[0][0] - mR[0][1] * S, C * mR[0][1] + mR[0][0] * S, mR[0][2],
 		C * mR[1][0] - mR[1][1] * S, C * mR[1][1] + mR[1][0] * S, mR[1][2],
 		C * mR[2][0] - mR[2][1] * S, C * mR[2][1] + mR[2][0] * S, mR[2][2]);
+#endif
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -104,7 +154,12 @@ void TRSTransform<T, P>::RotateZ(T angle)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::PreRotate(T angle, glm::tvec3<T, P> v)
 {
-	mR = glm::tmat3x3<T, P>::RotationMatrix(angle, v) * mR;
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = glm::normalize(glm::angleAxis(angle, glm::normalize(v)) * mQ);
+#else
+	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(T(1)), angle, v)) * mR;
+#endif
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -112,12 +167,17 @@ void TRSTransform<T, P>::PreRotate(T angle, glm::tvec3<T, P> v)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::PreRotateX(T angle)
 {
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = glm::normalize(mQ * glm::angleAxis(angle, glm::tvec3<T, P>(1, 0, 0)));
+#else
 	T C = cos(angle);
 	T S = sin(angle);
 	mR = glm::tmat3x3<T, P>(
 		mR[0][0], mR[0][1], mR[0][2],
 		C * mR[1][0] + mR[2][0] * S, C * mR[1][1] + mR[2][1] * S, C * mR[1][2] + mR[2][2] * S,
 		C * mR[2][0] - mR[1][0] * S, C * mR[2][1] - mR[1][1] * S, C * mR[2][2] - mR[1][2] * S);
+#endif
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -125,12 +185,17 @@ void TRSTransform<T, P>::PreRotateX(T angle)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::PreRotateY(T angle)
 {
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = glm::normalize(mQ * glm::angleAxis(angle, glm::tvec3<T, P>(0, 1, 0)));
+#else
 	T C = cos(angle);
 	T S = sin(angle);
 	mR = glm::tmat3x3<T, P>(
 		C * mR[0][0] - mR[2][0] * S, C * mR[0][1] - mR[2][1] * S, C * mR[0][2] - mR[2][2] * S,
 		mR[1][0], mR[1][1], mR[1][2],
 		C * mR[2][0] + mR[0][0] * S, C * mR[2][1] + mR[0][1] * S, C * mR[2][2] + mR[0][2] * S);
+#endif
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -138,12 +203,17 @@ void TRSTransform<T, P>::PreRotateY(T angle)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::PreRotateZ(T angle)
 {
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = glm::normalize(mQ * glm::angleAxis(angle, glm::tvec3<T, P>(0, 0, 1)));
+#else
 	T C = cos(angle);
 	T S = sin(angle);
 	mR = glm::tmat3x3<T, P>(
 		C * mR[0][0] + mR[1][0] * S, C * mR[0][1] + mR[1][1] * S, C * mR[0][2] + mR[1][2] * S,
 		C * mR[1][0] - mR[0][0] * S, C * mR[1][1] - mR[0][1] * S, C * mR[1][2] - mR[0][2] * S,
 		mR[2][0], mR[2][1], mR[2][2]);
+#endif
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -152,6 +222,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetTranslate(glm::tvec3<T, P> v)
 {
 	mT = v;
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -160,6 +231,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetScale(glm::tvec3<T, P> v)
 {
 	mS = v;
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -168,6 +240,7 @@ template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetScale(T uniform)
 {
 	mS = glm::tvec3<T, P>(uniform);
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -175,7 +248,7 @@ void TRSTransform<T, P>::SetScale(T uniform)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetRotate(T angle, glm::tvec3<T, P> v)
 {
-	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(T(1)), angle, v));
+	SetRotation(glm::angleAxis(angle, glm::normalize(v)));
 }
 
 /*----------------------------------------------------------------------------*/
@@ -183,7 +256,7 @@ void TRSTransform<T, P>::SetRotate(T angle, glm::tvec3<T, P> v)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetRotateX(T angle)
 {
-	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(T(1)), angle, glm::tvec3<T, P>(1, 0, 0)));
+	SetRotation(glm::angleAxis(angle, glm::tvec3<T, P>(1, 0, 0)));
 }
 
 /*----------------------------------------------------------------------------*/
@@ -191,7 +264,7 @@ void TRSTransform<T, P>::SetRotateX(T angle)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetRotateY(T angle)
 {
-	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(T(1)), angle, glm::tvec3<T, P>(0, 1, 0)));
+	SetRotation(glm::angleAxis(angle, glm::tvec3<T, P>(0, 1, 0)));
 }
 
 /*----------------------------------------------------------------------------*/
@@ -199,7 +272,33 @@ void TRSTransform<T, P>::SetRotateY(T angle)
 template<typename T, glm::precision P>
 void TRSTransform<T, P>::SetRotateZ(T angle)
 {
-	mR = glm::tmat3x3<T, P>(glm::rotate(glm::tmat4x4<T, P>(T(1)), angle, glm::tvec3<T, P>(0, 0, 1)));
+	SetRotation(glm::angleAxis(angle, glm::tvec3<T, P>(0, 0, 1)));
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename T, glm::precision P>
+void TRSTransform<T, P>::SetRotation(glm::tmat3x3<T, P> const& rotation)
+{
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = glm::normalize(glm::quat_cast(rotation));
+#else
+	mR = rotation;
+#endif
+	MarkDirty();
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename T, glm::precision P>
+void TRSTransform<T, P>::SetRotation(glm::tquat<T, P> const& rotation)
+{
+#if TRS_TRANSFORM_USE_QUATERNION
+	mQ = rotation;
+#else
+	mR = glm::mat3_cast(rotation);
+#endif
+	MarkDirty();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -221,9 +320,7 @@ void TRSTransform<T, P>::LookTowards(glm::tvec3<T, P> front_vec, glm::tvec3<T, P
 	right = normalize(right);
 	up = normalize(up);
 
-	mR[0] = right;
-	mR[1] = up;
-	mR[2] = -front_vec;
+	SetRotation(glm::tmat3x3<T, P>(right, up, -front_vec));
 }
 
 /*----------------------------------------------------------------------------*/
@@ -267,10 +364,11 @@ glm::tmat4x4<T, P> TRSTransform<T, P>::GetTranslationMatrix() const
 template<typename T, glm::precision P>
 glm::tmat4x4<T, P> TRSTransform<T, P>::GetRotationMatrix() const
 {
+	auto const R = GetRotation();
 	return glm::tmat4x4<T, P>(
-			mR[0][0], mR[0][1], mR[0][2], 0,
-			mR[1][0], mR[1][1], mR[1][2], 0,
-			mR[2][0], mR[2][1], mR[2][2], 0,
+			R[0][0], R[0][1], R[0][2], 0,
+			R[1][0], R[1][1], R[1][2], 0,
+			R[2][0], R[2][1], R[2][2], 0,
 			0  , 0  , 0  , 1);
 }
 
@@ -303,10 +401,11 @@ glm::tmat4x4<T, P> TRSTransform<T, P>::GetTranslationMatrixInverse() const
 template<typename T, glm::precision P>
 glm::tmat4x4<T, P> TRSTransform<T, P>::GetRotationMatrixInverse() const
 {
+	auto const R = GetRotation();
 	return glm::tmat4x4<T, P>(
-			mR[0][0], mR[1][0], mR[2][0], 0,
-			mR[0][1], mR[1][1], mR[2][1], 0,
-			mR[0][2], mR[1][2], mR[2][2], 0,
+			R[0][0], R[1][0], R[2][0], 0,
+			R[0][1], R[1][1], R[2][1], 0,
+			R[0][2], R[1][2], R[2][2], 0,
 			0, 0, 0, 1);
 }
 
@@ -327,41 +426,72 @@ glm::tmat4x4<T, P> TRSTransform<T, P>::GetScaleMatrixInverse() const
 template<typename T, glm::precision P>
 glm::tmat4x4<T, P> TRSTransform<T, P>::GetTranslationRotationMatrix() const
 {
+	auto const R = GetRotation();
 	return glm::tmat4x4<T, P>(
-			mR[0][0], mR[0][1], mR[0][2], 0,
-			mR[1][0], mR[1][1], mR[1][2], 0,
-			mR[2][0], mR[2][1], mR[2][2], 0,
+			R[0][0], R[0][1], R[0][2], 0,
+			R[1][0], R[1][1], R[1][2], 0,
+			R[2][0], R[2][1], R[2][2], 0,
 			mT.x, mT.y, mT.z, 1);
 }
 
 /*----------------------------------------------------------------------------*/
 
 template<typename T, glm::precision P>
-glm::tmat4x4<T, P> TRSTransform<T, P>::GetMatrix() const
+glm::tmat4x4<T, P> const& TRSTransform<T, P>::GetMatrix() const
+{
+	CountMatrixRequests(1u);
+	if (mIsMatrixDirty) {
+		mMatrix = BuildMatrix();
+		mIsMatrixDirty = false;
+	}
+	return mMatrix;
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename T, glm::precision P>
+glm::tmat4x4<T, P> const& TRSTransform<T, P>::GetMatrixInverse() const
+{
+	CountMatrixRequests(1u);
+	if (mIsMatrixInverseDirty) {
+		mMatrixInverse = BuildMatrixInverse();
+		mIsMatrixInverseDirty = false;
+	}
+	return mMatrixInverse;
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename T, glm::precision P>
+glm::tmat4x4<T, P> TRSTransform<T, P>::BuildMatrix() const
 {
+	CountMatrixBuild();
+	auto const R = GetRotation();
 	return glm::tmat4x4<T, P>(
-			mR[0][0]*mS.x, mR[0][1]*mS.x, mR[0][2]*mS.x, 0,
-			mR[1][0]*mS.y, mR[1][1]*mS.y, mR[1][2]*mS.y, 0,
-			mR[2][0]*mS.z, mR[2][1]*mS.z, mR[2][2]*mS.z, 0,
+			R[0][0]*mS.x, R[0][1]*mS.x, R[0][2]*mS.x, 0,
+			R[1][0]*mS.y, R[1][1]*mS.y, R[1][2]*mS.y, 0,
+			R[2][0]*mS.z, R[2][1]*mS.z, R[2][2]*mS.z, 0,
 			mT.x, mT.y, mT.z, 1);
 }
 
 /*----------------------------------------------------------------------------*/
 
 template<typename T, glm::precision P>
-glm::tmat4x4<T, P> TRSTransform<T, P>::GetMatrixInverse() const
+glm::tmat4x4<T, P> TRSTransform<T, P>::BuildMatrixInverse() const
 {
+	CountMatrixBuild();
+	auto const R = GetRotation();
 	glm::tvec3<T, P> X = glm::tvec3<T, P>(T(1) / mS.x, T(1) / mS.y, T(1) / mS.z);
 
-	T a = mR[0][0] * X.x;
-	T b = mR[1][0] * X.y;
-	T c = mR[2][0] * X.z;
-	T d = mR[0][1] * X.x;
-	T e = mR[1][1] * X.y;
-	T f = mR[2][1] * X.z;
-	T g = mR[0][2] * X.x;
-	T h = mR[1][2] * X.y;
-	T i = mR[2][2] * X.z;
+	T a = R[0][0] * X.x;
+	T b = R[1][0] * X.y;
+	T c = R[2][0] * X.z;
+	T d = R[0][1] * X.x;
+	T e = R[1][1] * X.y;
+	T f = R[2][1] * X.z;
+	T g = R[0][2] * X.x;
+	T h = R[1][2] * X.y;
+	T i = R[2][2] * X.z;
 
 	return glm::tmat4x4<T, P>(
 			a, b, c, 0,
@@ -375,7 +505,23 @@ glm::tmat4x4<T, P> TRSTransform<T, P>::GetMatrixInverse() const
 template<typename T, glm::precision P>
 glm::tmat3x3<T, P> TRSTransform<T, P>::GetRotation() const
 {
+#if TRS_TRANSFORM_USE_QUATERNION
+	return glm::mat3_cast(mQ);
+#else
 	return mR;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename T, glm::precision P>
+glm::tquat<T, P> TRSTransform<T, P>::GetRotationQuaternion() const
+{
+#if TRS_TRANSFORM_USE_QUATERNION
+	return mQ;
+#else
+	return glm::quat_cast(mR);
+#endif
 }
 
 /*----------------------------------------------------------------------------*/
@@ -399,7 +545,8 @@ glm::tvec3<T, P> TRSTransform<T, P>::GetScale() const
 template<typename T, glm::precision P>
 glm::tvec3<T, P> TRSTransform<T, P>::GetUp() const
 {
-	return glm::tvec3<T, P>(mR[1][0]*mS.y, mR[1][1]*mS.y, mR[1][2]*mS.y);
+	auto const R = GetRotation();
+	return glm::tvec3<T, P>(R[1][0]*mS.y, R[1][1]*mS.y, R[1][2]*mS.y);
 }
 
 template<typename T, glm::precision P>
@@ -417,7 +564,8 @@ glm::tvec3<T, P> TRSTransform<T, P>::GetLeft() const
 template<typename T, glm::precision P>
 glm::tvec3<T, P> TRSTransform<T, P>::GetRight() const
 {
-	return glm::tvec3<T, P>(mR[0][0]*mS.x, mR[0][1]*mS.x, mR[0][2]*mS.x);
+	auto const R = GetRotation();
+	return glm::tvec3<T, P>(R[0][0]*mS.x, R[0][1]*mS.x, R[0][2]*mS.x);
 }
 
 template<typename T, glm::precision P>
@@ -429,7 +577,88 @@ glm::tvec3<T, P> TRSTransform<T, P>::GetFront() const
 template<typename T, glm::precision P>
 glm::tvec3<T, P> TRSTransform<T, P>::GetBack() const
 {
-	return glm::tvec3<T, P>(mR[2][0]*mS.z, mR[2][1]*mS.z, mR[2][2]*mS.z);
+	auto const R = GetRotation();
+	return glm::tvec3<T, P>(R[2][0]*mS.z, R[2][1]*mS.z, R[2][2]*mS.z);
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename T, glm::precision P>
+std::uint64_t TRSTransform<T, P>::GetVersion() const
+{
+	return mVersion;
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename T, glm::precision P>
+void TRSTransform<T, P>::ComposeMatrices(TRSTransform<T, P> const* transforms, std::size_t count,
+                                         glm::tmat4x4<T, P> const& parent, glm::tmat4x4<T, P>* matrices)
+{
+	CountMatrixRequests(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		auto const& transform = transforms[i];
+		matrices[i] = parent * (transform.mIsMatrixDirty ? transform.BuildMatrix() : transform.mMatrix);
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename T, glm::precision P>
+std::uint64_t TRSTransform<T, P>::GetMatrixRequestsCount()
+{
+#if ENABLE_PROFILING
+	return sMatrixRequestsCount.load(std::memory_order_relaxed);
+#else
+	return 0u;
+#endif
+}
+
+template<typename T, glm::precision P>
+std::uint64_t TRSTransform<T, P>::GetMatrixBuildsCount()
+{
+#if ENABLE_PROFILING
+	return sMatrixBuildsCount.load(std::memory_order_relaxed);
+#else
+	return 0u;
+#endif
+}
+
+template<typename T, glm::precision P>
+void TRSTransform<T, P>::ResetMatrixCounters()
+{
+#if ENABLE_PROFILING
+	sMatrixRequestsCount.store(0u, std::memory_order_relaxed);
+	sMatrixBuildsCount.store(0u, std::memory_order_relaxed);
+#endif
+}
+
+// The counters are only statistics: relaxed ordering is enough, and avoids
+// full barriers on every matrix access.
+template<typename T, glm::precision P>
+void TRSTransform<T, P>::CountMatrixRequests(std::uint64_t count)
+{
+#if ENABLE_PROFILING
+	sMatrixRequestsCount.fetch_add(count, std::memory_order_relaxed);
+#endif
+}
+
+template<typename T, glm::precision P>
+void TRSTransform<T, P>::CountMatrixBuild()
+{
+#if ENABLE_PROFILING
+	sMatrixBuildsCount.fetch_add(1u, std::memory_order_relaxed);
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename T, glm::precision P>
+void TRSTransform<T, P>::MarkDirty()
+{
+	mIsMatrixDirty = true;
+	mIsMatrixInverseDirty = true;
+	mVersion = TRSTransformDetail::NextVersion();
 }
 
 /*----------------------------------------------------------------------------*/
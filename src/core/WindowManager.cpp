@@ -88,7 +88,7 @@ WindowManager::~WindowManager()
 	WindowManager::mMutex.unlock();
 }
 
-GLFWwindow* WindowManager::CreateGLFWWindow(std::string const& title, WindowDatum const& data, unsigned int msaa, bool fullscreen, bool resizable, SwapStrategy swap)
+GLFWwindow* WindowManager::CreateGLFWWindow(std::string const& title, WindowDatum const& data, unsigned int msaa, bool fullscreen, bool resizable, SwapStrategy swap, bool visible)
 {
 #ifdef __APPLE__
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -101,21 +101,30 @@ GLFWwindow* WindowManager::CreateGLFWWindow(std::string const& title, WindowDatu
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, default_opengl_minor_version);
 
 	glfwWindowHint(GLFW_RESIZABLE, resizable ? GLFW_TRUE : GLFW_FALSE);
+	glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 	glfwWindowHint(GLFW_SAMPLES, static_cast<int>(msaa));
 
+	// Virtual displays, like the ones used for running without a screen,
+	// may not report any monitor.
 	GLFWmonitor* const monitor = glfwGetPrimaryMonitor();
-	GLFWvidmode const* const video_mode = glfwGetVideoMode(monitor);
+	GLFWvidmode const* const video_mode = monitor != nullptr ? glfwGetVideoMode(monitor) : nullptr;
 	int width  = fullscreen ? data.fullscreen_width  : data.windowed_width;
 	int height = fullscreen ? data.fullscreen_height : data.windowed_height;
+	if (video_mode == nullptr && (fullscreen || width == 0 || height == 0)) {
+		LogError("No monitor was found to get the window resolution from.");
+		return nullptr;
+	}
 	if (width == 0)
 		width = video_mode->width;
 	if (height == 0)
 		height = video_mode->height;
 
-	glfwWindowHint(GLFW_RED_BITS, video_mode->redBits);
-	glfwWindowHint(GLFW_GREEN_BITS, video_mode->greenBits);
-	glfwWindowHint(GLFW_BLUE_BITS, video_mode->blueBits);
-	glfwWindowHint(GLFW_REFRESH_RATE, video_mode->refreshRate);
+	if (video_mode != nullptr) {
+		glfwWindowHint(GLFW_RED_BITS, video_mode->redBits);
+		glfwWindowHint(GLFW_GREEN_BITS, video_mode->greenBits);
+		glfwWindowHint(GLFW_BLUE_BITS, video_mode->blueBits);
+		glfwWindowHint(GLFW_REFRESH_RATE, video_mode->refreshRate);
+	}
 
 	GLFWwindow* window = glfwCreateWindow(width, height, title.c_str(), fullscreen ? monitor : nullptr, nullptr);
 
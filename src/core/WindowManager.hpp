@@ -37,7 +37,14 @@ public:
 	WindowManager();
 	~WindowManager();
 
-	GLFWwindow* CreateGLFWWindow(std::string const& title, WindowDatum const& data, unsigned int msaa = 1u, bool fullscreen = false, bool resizable = false, SwapStrategy swap = SwapStrategy::enable_vsync);
+	//! \brief Create a window along with its OpenGL context, and make that
+	//!        context current.
+	//!
+	//! An invisible window still gets a working context, and its default
+	//! framebuffer can be rendered to; combined with a software renderer
+	//! like Mesa's llvmpipe, this allows running without a display, for
+	//! example for benchmarks.
+	GLFWwindow* CreateGLFWWindow(std::string const& title, WindowDatum const& data, unsigned int msaa = 1u, bool fullscreen = false, bool resizable = false, SwapStrategy swap = SwapStrategy::enable_vsync, bool visible = true);
 	void DestroyWindow(GLFWwindow* const window);
 	void NewImGuiFrame();
 	void RenderImGuiFrame(bool show_gui);
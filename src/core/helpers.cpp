@@ -3,6 +3,7 @@
 
 #include "core/Log.h"
 #include "core/opengl.hpp"
+#include "core/Profiler.h"
 #include "core/various.hpp"
 
 #include <assimp/Importer.hpp>
@@ -16,6 +17,7 @@
 #include <cassert>
 #include <cstdint>
 #include <memory>
+#include <set>
 
 namespace
 {
@@ -43,6 +45,7 @@ namespace local
 {
 	static GLuint fullscreen_shader;
 	static GLuint display_vao;
+	static ResourceRegistry resource_registry;
 	static std::array<char const*, 3> const cull_mode_labels{
 		"Disabled",
 		"Back faces",
@@ -58,11 +61,14 @@ namespace local
 void
 bonobo::init()
 {
+	ResourceRegistry::OwnerScope const owner_scope(local::resource_registry, "bonobo");
+
 	setupBasisData();
 	createDebugTexture();
 
 	glGenVertexArrays(1, &local::display_vao);
 	assert(local::display_vao != 0u);
+	local::resource_registry.Register(ResourceType::vertex_array, local::display_vao, "Display VAO", ResourceCategory::geometry);
 	local::fullscreen_shader = bonobo::createProgram("common/fullscreen.vert", "common/fullscreen.frag");
 	if (local::fullscreen_shader == 0u)
 		LogError("Failed to load \"fullscreen.vert\" and \"fullscreen.frag\"");
@@ -71,21 +77,30 @@ bonobo::init()
 void
 bonobo::deinit()
 {
-	glDeleteTextures(1, &debug_texture_id);
-	debug_texture_id = 0u;
+	auto& registry = local::resource_registry;
+	registry.Release(ResourceType::texture, debug_texture_id);
+
+	registry.Release(ResourceType::program, basis.shader);
+	registry.Release(ResourceType::buffer, basis.ibo);
+	registry.Release(ResourceType::buffer, basis.vbo);
+	registry.Release(ResourceType::vertex_array, basis.vao);
 
-	glDeleteProgram(basis.shader);
-	glDeleteBuffers(1, &basis.ibo);
-	glDeleteBuffers(1, &basis.vbo);
-	glDeleteVertexArrays(1, &basis.vao);
+	registry.Release(ResourceType::program, local::fullscreen_shader);
+	registry.Release(ResourceType::vertex_array, local::display_vao);
 
-	glDeleteProgram(local::fullscreen_shader);
-	glDeleteVertexArrays(1, &local::display_vao);
+	registry.ReleaseAll();
+}
+
+ResourceRegistry&
+bonobo::getResourceRegistry()
+{
+	return local::resource_registry;
 }
 
 static std::vector<std::uint8_t>
 getTextureData(std::string const& filename, std::uint32_t& width, std::uint32_t& height, bool flip)
 {
+	ProfileScope("Decode image");
 	auto const channels_nb = 4u;
 	stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
 	unsigned char* image_data = stbi_load(filename.c_str(), reinterpret_cast<int*>(&width), reinterpret_cast<int*>(&height), nullptr, channels_nb);
@@ -108,7 +123,9 @@ getTextureData(std::string const& filename, std::uint32_t& width, std::uint32_t&
 std::vector<bonobo::mesh_data>
 bonobo::loadObjects(std::string const& filename)
 {
+	ProfileFunction();
 	auto const scene_start_time = std::chrono::high_resolution_clock::now();
+	ResourceRegistry::OwnerScope const owner_scope(local::resource_registry, filename);
 
 	std::vector<bonobo::mesh_data> objects;
 
@@ -146,6 +163,7 @@ bonobo::loadObjects(std::string const& filename)
 		if (!are_materials_used[i])
 			continue;
 
+		ProfileScope("Load material");
 		auto const material_start_time = std::chrono::high_resolution_clock::now();
 		texture_bindings& bindings = materials_bindings[i];
 		material_data& constants = material_constants[i];
@@ -153,6 +171,7 @@ bonobo::loadObjects(std::string const& filename)
 
 		auto const process_texture = [&bindings,&material,i,&parent_folder,&texture_count](aiTextureType type, std::string const& type_as_str, std::string const& name){
 			if (material->GetTextureCount(type)) {
+				ProfileScope("Load texture");
 				auto const texture_start_time = std::chrono::high_resolution_clock::now();
 
 				if (material->GetTextureCount(type) > 1)
@@ -167,7 +186,8 @@ bonobo::loadObjects(std::string const& filename)
 				bindings.emplace(name, id);
 				++texture_count;
 
-				utils::opengl::debug::nameObject(GL_TEXTURE, id, std::string(material->GetName().C_Str()) + " " + type_as_str);
+				auto& registry = local::resource_registry;
+				registry.SetLabel(registry.Find(ResourceType::texture, id), std::string(material->GetName().C_Str()) + " " + type_as_str);
 
 				auto const texture_end_time = std::chrono::high_resolution_clock::now();
 				LogTrivia("│ %s Texture \"%s\" loaded in %.3f ms",
@@ -205,6 +225,7 @@ bonobo::loadObjects(std::string const& filename)
 	auto const meshes_start_time = std::chrono::high_resolution_clock::now();
 	objects.reserve(assimp_scene->mNumMeshes);
 	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
+		ProfileScope("Load mesh");
 		auto const mesh_start_time = std::chrono::high_resolution_clock::now();
 
 		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
@@ -310,9 +331,9 @@ bonobo::loadObjects(std::string const& filename)
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<unsigned int>(object.indices_nb) * sizeof(GL_UNSIGNED_INT), reinterpret_cast<GLvoid const*>(object_indices.get()), GL_STATIC_DRAW);
 		object_indices.reset(nullptr);
 
-		utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, object.vao, object.name + " VAO");
-		utils::opengl::debug::nameObject(GL_BUFFER, object.bo, object.name + " VBO");
-		utils::opengl::debug::nameObject(GL_BUFFER, object.ibo, object.name + " IBO");
+		local::resource_registry.Register(ResourceType::vertex_array, object.vao, object.name + " VAO", ResourceCategory::geometry);
+		local::resource_registry.Register(ResourceType::buffer, object.bo, object.name + " VBO", ResourceCategory::geometry);
+		local::resource_registry.Register(ResourceType::buffer, object.ibo, object.name + " IBO", ResourceCategory::geometry);
 
 		glBindVertexArray(0u);
 		glBindBuffer(GL_ARRAY_BUFFER, 0u);
@@ -355,6 +376,26 @@ bonobo::loadObjects(std::string const& filename)
 	return objects;
 }
 
+void
+bonobo::releaseObjects(std::vector<mesh_data>& objects)
+{
+	auto& registry = local::resource_registry;
+
+	// Meshes sharing a material share its textures as well.
+	std::set<GLuint> textures;
+	for (auto& object : objects) {
+		registry.Release(ResourceType::buffer, object.ibo);
+		registry.Release(ResourceType::buffer, object.bo);
+		registry.Release(ResourceType::vertex_array, object.vao);
+		for (auto const& binding : object.bindings)
+			textures.insert(binding.second);
+	}
+	for (auto texture : textures)
+		registry.Release(ResourceType::texture, texture);
+
+	objects.clear();
+}
+
 GLuint
 bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint internal_format, GLenum format, GLenum type, GLvoid const* data)
 {
@@ -378,6 +419,7 @@ bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint inte
 	}
 	glBindTexture(target, 0u);
 
+	local::resource_registry.Register(ResourceType::texture, texture, "", ResourceCategory::automatic, target);
 	return texture;
 }
 
@@ -397,6 +439,10 @@ bonobo::loadTexture2D(std::string const& filename, bool generate_mipmap)
 		glGenerateMipmap(GL_TEXTURE_2D);
 	glBindTexture(GL_TEXTURE_2D, 0u);
 
+	auto const handle = local::resource_registry.Find(ResourceType::texture, texture);
+	local::resource_registry.SetLabel(handle, filename);
+	local::resource_registry.UpdateSize(handle); // Account for the mipmaps.
+
 	return texture;
 }
 
@@ -471,6 +517,8 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 
 	glBindTexture(GL_TEXTURE_CUBE_MAP, 0u);
 
+	local::resource_registry.Register(ResourceType::texture, texture, posx, ResourceCategory::automatic, GL_TEXTURE_CUBE_MAP);
+
 	return texture;
 }
 
@@ -490,6 +538,7 @@ bonobo::createProgram(std::string const& vert_shader_source_path, std::string co
 	GLuint program = utils::opengl::shader::generate_program({ vertex_shader, fragment_shader });
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
+	local::resource_registry.Register(ResourceType::program, program, vert_shader_source_path + " + " + frag_shader_source_path);
 	return program;
 }
 
@@ -542,6 +591,7 @@ bonobo::createFBO(std::vector<GLuint> const& color_attachments, GLuint depth_att
 		attach(GL_DEPTH_ATTACHMENT, depth_attachment);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+	local::resource_registry.Register(ResourceType::framebuffer, fbo, "");
 	return fbo;
 }
 
@@ -552,6 +602,7 @@ bonobo::createSampler(std::function<void (GLuint)> const& setup)
 	glGenSamplers(1, &sampler);
 	assert(sampler != 0u);
 	setup(sampler);
+	local::resource_registry.Register(ResourceType::sampler, sampler, "");
 	return sampler;
 }
 
@@ -737,9 +788,9 @@ namespace
 		assert(shader_location >= 0);
 		basis.shader_locations.length_scale = shader_location;
 
-		utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, basis.vao, "Basis VAO");
-		utils::opengl::debug::nameObject(GL_BUFFER, basis.vbo, "Basis VBO");
-		utils::opengl::debug::nameObject(GL_BUFFER, basis.ibo, "Basis IBO");
+		local::resource_registry.Register(ResourceType::vertex_array, basis.vao, "Basis VAO", ResourceCategory::geometry);
+		local::resource_registry.Register(ResourceType::buffer, basis.vbo, "Basis VBO", ResourceCategory::geometry);
+		local::resource_registry.Register(ResourceType::buffer, basis.ibo, "Basis IBO", ResourceCategory::geometry);
 	}
 
 	void createDebugTexture()
@@ -755,6 +806,6 @@ namespace
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, debug_texture_width, debug_texture_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, debug_texture_content.data());
 		glBindTexture(GL_TEXTURE_2D, 0u);
 
-		utils::opengl::debug::nameObject(GL_TEXTURE, debug_texture_id, "Debug texture");
+		local::resource_registry.Register(ResourceType::texture, debug_texture_id, "Debug texture");
 	}
 }
@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 
 #include "core/FPSCamera.h" // As it includes OpenGL headers, import it after glad
+#include "core/ResourceRegistry.hpp"
 
 #include <functional>
 #include <string>
@@ -66,9 +67,14 @@ namespace bonobo
 	//! \brief Allocate some objects needed by some helper functions.
 	void init();
 
-	//! \brief Deallocate objects allocated by the `init()` function.
+	//! \brief Deallocate objects allocated by the `init()` function, and
+	//!        report any other object left in the resource registry.
 	void deinit();
 
+	//! \brief Retrieve the registry tracking the OpenGL objects created by
+	//!        the helpers, and any other object registered with it.
+	ResourceRegistry& getResourceRegistry();
+
 	//! \brief Load objects found in an object/scene file, using assimp.
 	//!
 	//! @param [in] filename of the object/scene file to load.
@@ -76,6 +82,12 @@ namespace bonobo
 	//!         object found in the input file
 	std::vector<mesh_data> loadObjects(std::string const& filename);
 
+	//! \brief Release the OpenGL objects of meshes returned by
+	//!        `loadObjects()`, including their textures.
+	//!
+	//! @param [inout] objects the meshes to release; they are emptied
+	void releaseObjects(std::vector<mesh_data>& objects);
+
 	//! \brief Creates an OpenGL texture without any content nor parameters.
 	//!
 	//! @param [in] width width of the texture to create
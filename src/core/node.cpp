@@ -7,10 +7,15 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cctype>
+
 void
 Node::render(glm::mat4 const& view_projection, glm::mat4 const& parent_transform) const
 {
-	if (_program != nullptr)
+	if (_program_manager != nullptr)
+		render(view_projection, parent_transform * _transform.GetMatrix(), _program_manager->GetProgramVariant(_program_variants, _variant_mask), _set_uniforms);
+	else if (_program != nullptr)
 		render(view_projection, parent_transform * _transform.GetMatrix(), *_program, _set_uniforms);
 }
 
@@ -103,9 +108,37 @@ Node::set_program(GLuint const* const program, std::function<void (GLuint)> cons
 	}
 
 	_program = program;
+	_program_manager = nullptr;
 	_set_uniforms = set_uniforms;
 }
 
+void
+Node::set_program(ShaderProgramManager& program_manager, ShaderProgramManager::ProgramVariantsId variants, std::function<void (GLuint)> const& set_uniforms)
+{
+	_program = nullptr;
+	_program_manager = &program_manager;
+	_program_variants = variants;
+	_set_uniforms = set_uniforms;
+	update_variant_mask();
+}
+
+void
+Node::update_variant_mask()
+{
+	if (_program_manager == nullptr)
+		return;
+
+	std::vector<std::string> keywords;
+	keywords.reserve(_textures.size());
+	for (auto const& texture : _textures) {
+		auto keyword = "HAS_" + std::get<0>(texture);
+		std::transform(keyword.begin(), keyword.end(), keyword.begin(),
+		               [](unsigned char c){ return static_cast<char>(std::toupper(c)); });
+		keywords.push_back(std::move(keyword));
+	}
+	_variant_mask = _program_manager->GetVariantMask(_program_variants, keywords);
+}
+
 void
 Node::set_name(std::string const& name)
 {
@@ -145,6 +178,7 @@ Node::add_texture(std::string const& name, GLuint tex_id, GLenum type)
 	}
 
 	_textures.emplace_back(name, tex_id, type);
+	update_variant_mask();
 }
 
 void
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "helpers.hpp"
+#include "ShaderProgramManager.hpp"
 #include "TRSTransform.h"
 
 #include <glad/glad.h>
@@ -85,6 +86,23 @@ public:
 	void set_program(GLuint const* const program,
 	                 std::function<void (GLuint)> const& set_uniforms = [](GLuint /*programID*/){});
 
+	//! \brief Set a program with variants for this node.
+	//!
+	//! The variant used enables, for each texture of this node, the
+	//! keyword made of "HAS_" followed by the name of the texture in upper
+	//! case, like `HAS_DIFFUSE_TEXTURE` for `diffuse_texture`, instead of
+	//! relying on the `has_diffuse_texture` uniform.
+	//!
+	//! @param [in] program_manager manager in which |variants| were
+	//!             declared; it should outlive this node.
+	//! @param [in] variants program variants to pick from
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms
+	void set_program(ShaderProgramManager& program_manager,
+	                 ShaderProgramManager::ProgramVariantsId variants,
+	                 std::function<void (GLuint)> const& set_uniforms = [](GLuint /*programID*/){});
+
 	//! \brief Set the name of this node.
 	//!
 	//! This name will be used when pushing debug groups to scope OpenGL
@@ -131,6 +149,8 @@ public:
 	TRSTransformf& get_transform();
 
 private:
+	void update_variant_mask();
+
 	// Geometry data
 	GLuint _vao{ 0u };
 	GLsizei _vertices_nb{ 0u };
@@ -140,6 +160,9 @@ private:
 
 	// Program data
 	GLuint const* _program{ nullptr };
+	ShaderProgramManager* _program_manager{ nullptr };
+	ShaderProgramManager::ProgramVariantsId _program_variants{ 0u };
+	ShaderProgramManager::VariantMask _variant_mask{ 0u };
 	std::function<void (GLuint)> _set_uniforms;
 
 	// Material data
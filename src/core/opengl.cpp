@@ -173,6 +173,12 @@ source_and_build_shader(GLuint id, std::string const& source)
 	glShaderSource(id, 1, &char_source, NULL);
 
 	glCompileShader(id);
+	return check_shader_compilation(id);
+}
+
+bool
+check_shader_compilation(GLuint id, std::function<std::string (std::string const& log)> const& format_log)
+{
 	GLint state = GLint(0);
 	glGetShaderiv(id, GL_COMPILE_STATUS, &state);
 	auto const wasCompilationSuccessful = state != GL_FALSE;
@@ -186,7 +192,7 @@ source_and_build_shader(GLuint id, std::string const& source)
 
 		std::ostringstream oss;
 		oss << "Shader compiling log:" << std::endl
-		    << log.get() << std::endl;
+		    << (format_log ? format_log(log.get()) : std::string(log.get())) << std::endl;
 		auto const s_msg = oss.str();
 		auto const c_msg = s_msg.c_str();
 
@@ -219,6 +225,12 @@ bool
 link_program(GLuint id)
 {
 	glLinkProgram(id);
+	return check_program_linking(id);
+}
+
+bool
+check_program_linking(GLuint id)
+{
 	GLint state = GLint(0);
 	glGetProgramiv(id, GL_LINK_STATUS, &state);
 	auto const wasLinkingSuccessful = state != GL_FALSE;
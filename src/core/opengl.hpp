@@ -3,6 +3,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -67,8 +68,17 @@ namespace shader
 {
 
 bool source_and_build_shader(GLuint id, std::string const& source);
+//! \brief Wait for the compilation of |id| to finish, and log its outcome.
+//!
+//! @param [in] id Shader to check
+//! @param [in] format_log Optional function applied to the compilation log
+//!             before it is printed, for example to put back the file
+//!             names of preprocessed shaders
+bool check_shader_compilation(GLuint id, std::function<std::string (std::string const& log)> const& format_log = nullptr);
 GLuint generate_shader(GLenum type, std::string const& source);
 bool link_program(GLuint id);
+//! \brief Wait for the linking of |id| to finish, and log its outcome.
+bool check_program_linking(GLuint id);
 void reload_program(GLuint id, std::vector<GLuint> const& ids, std::vector<std::string> const& sources);
 GLuint generate_program(std::vector<GLuint> const& shaders_id);
 
@@ -1,11 +1,19 @@
 #include "various.hpp"
 
 #include "core/Log.h"
+#include "core/Profiler.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #if defined(_WIN32)
 #include <Windows.h>
 #endif
@@ -88,3 +96,200 @@ utils::slurp_file(std::string const& path)
 
   return std::string(content.get());
 }
+
+std::uint64_t
+utils::hash_fnv1a(void const* data, std::size_t size, std::uint64_t hash)
+{
+  auto const bytes = static_cast<unsigned char const*>(data);
+  for (std::size_t i = 0u; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+std::string
+utils::escape_json(std::string const& text)
+{
+  std::string escaped;
+  escaped.reserve(text.size());
+  for (auto const c : text) {
+    switch (c) {
+      case '"':  escaped += "\\\""; break;
+      case '\\': escaped += "\\\\"; break;
+      case '\n': escaped += "\\n"; break;
+      case '\r': escaped += "\\r"; break;
+      case '\t': escaped += "\\t"; break;
+      default:
+        // Other control characters are not allowed in JSON strings either.
+        if (static_cast<unsigned char>(c) < 0x20u) {
+          char code[7];
+          std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+          escaped += code;
+        } else {
+          escaped += c;
+        }
+        break;
+    }
+  }
+  return escaped;
+}
+
+namespace
+{
+  using ChunkFunction = std::function<void (std::size_t begin, std::size_t end)>;
+
+  // Threads processing the chunks of utils::parallel_for(); they are
+  // created on first use and then kept waiting for the next call, rather
+  // than spawned anew for each of them.
+  class WorkerPool
+  {
+  public:
+    explicit WorkerPool(std::size_t workers_nb);
+    ~WorkerPool();
+    WorkerPool(WorkerPool const&) = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+
+    // Process all chunks of [0, count), using the calling thread as well as
+    // the workers, and return once they are all done.
+    void Run(std::size_t count, std::size_t chunk_size, ChunkFunction const& body);
+
+  private:
+    struct Job
+    {
+      ChunkFunction const* body{ nullptr };
+      std::size_t count{ 0u };
+      std::size_t chunk_size{ 1u };
+    };
+
+    void WorkerLoop();
+    void ProcessChunks(Job const& job);
+
+    std::vector<std::thread> workers;
+    std::mutex run_mutex;             // Only one job runs at a time
+    std::mutex mutex;                 // Guards everything below, except next_begin
+    std::condition_variable job_available;
+    std::condition_variable job_done;
+    Job job;
+    std::uint64_t job_id{ 0u };
+    std::size_t remaining_chunks_nb{ 0u };
+    std::size_t active_workers_nb{ 0u };
+    bool is_stopping{ false };
+    std::atomic<std::size_t> next_begin{ 0u };
+  };
+
+  // Set for the threads of the pool, so that nested calls to
+  // utils::parallel_for() run serially instead of waiting on themselves.
+  thread_local bool is_pool_worker = false;
+
+  WorkerPool::WorkerPool(std::size_t workers_nb)
+  {
+    workers.reserve(workers_nb);
+    for (std::size_t i = 0u; i < workers_nb; ++i)
+      workers.emplace_back(&WorkerPool::WorkerLoop, this);
+  }
+
+  WorkerPool::~WorkerPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      is_stopping = true;
+    }
+    job_available.notify_all();
+    for (auto& worker : workers)
+      worker.join();
+  }
+
+  void WorkerPool::Run(std::size_t count, std::size_t chunk_size, ChunkFunction const& body)
+  {
+    std::lock_guard<std::mutex> run_lock(run_mutex);
+
+    Job current_job;
+    {
+      // Workers late to pick the previous job might still be looking at
+      // next_begin: wait for them before resetting it.
+      std::unique_lock<std::mutex> lock(mutex);
+      job_done.wait(lock, [this]{ return active_workers_nb == 0u; });
+      job.body = &body;
+      job.count = count;
+      job.chunk_size = chunk_size;
+      current_job = job;
+      remaining_chunks_nb = (count + chunk_size - 1u) / chunk_size;
+      next_begin.store(0u, std::memory_order_relaxed);
+      ++job_id;
+    }
+    job_available.notify_all();
+
+    ProcessChunks(current_job);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    job_done.wait(lock, [this]{ return remaining_chunks_nb == 0u; });
+  }
+
+  void WorkerPool::WorkerLoop()
+  {
+    ProfileThreadName("parallel_for worker");
+    is_pool_worker = true;
+
+    std::uint64_t last_job_id = 0u;
+    for (;;) {
+      Job current_job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        job_available.wait(lock, [this, last_job_id]{ return is_stopping || job_id != last_job_id; });
+        if (is_stopping)
+          return;
+        last_job_id = job_id;
+        current_job = job;
+        ++active_workers_nb;
+      }
+
+      ProcessChunks(current_job);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--active_workers_nb == 0u)
+        job_done.notify_all();
+    }
+  }
+
+  void WorkerPool::ProcessChunks(Job const& current_job)
+  {
+    std::size_t processed_chunks_nb = 0u;
+    for (;;) {
+      auto const begin = next_begin.fetch_add(current_job.chunk_size, std::memory_order_relaxed);
+      if (begin >= current_job.count)
+        break;
+
+      ProfileScope("parallel_for chunk");
+      (*current_job.body)(begin, std::min(begin + current_job.chunk_size, current_job.count));
+      ++processed_chunks_nb;
+    }
+    if (processed_chunks_nb == 0u)
+      return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    remaining_chunks_nb -= processed_chunks_nb;
+    if (remaining_chunks_nb == 0u)
+      job_done.notify_all();
+  }
+}
+
+void
+utils::parallel_for(std::size_t count,
+                    std::function<void (std::size_t begin, std::size_t end)> const& body,
+                    std::size_t min_chunk_size)
+{
+  if (count == 0u)
+    return;
+
+  auto const hardware_threads_nb = std::max(1u, std::thread::hardware_concurrency());
+  auto const max_chunks_nb = (count + std::max<std::size_t>(min_chunk_size, 1u) - 1u) / std::max<std::size_t>(min_chunk_size, 1u);
+  auto const chunks_nb = std::min<std::size_t>(hardware_threads_nb, max_chunks_nb);
+  if (chunks_nb <= 1u || is_pool_worker) {
+    body(0u, count);
+    return;
+  }
+
+  static WorkerPool pool(hardware_threads_nb - 1u);
+  pool.Run(count, (count + chunks_nb - 1u) / chunks_nb, body);
+}
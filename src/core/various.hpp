@@ -1,6 +1,9 @@
 #pragma once
 
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 
 
@@ -17,4 +20,33 @@ inline std::string const& widen(std::string const& utf8) { return utf8; }
 
 std::string slurp_file(std::string const& path);
 
+//! \brief Compute a 64-bit FNV-1a hash of |size| bytes.
+//!
+//! Unlike std::hash, the result is stable across runs and platforms, so it
+//! can be used to name files; pass the result of a previous call as |hash|
+//! to hash several buffers in sequence.
+std::uint64_t hash_fnv1a(void const* data, std::size_t size,
+                         std::uint64_t hash = 0xcbf29ce484222325ull);
+
+//! \brief Escape |text| so that it can be written between the quotes of a
+//!        JSON string.
+std::string escape_json(std::string const& text);
+
+//! \brief Split the range [0, count) into contiguous chunks, and process
+//!        them concurrently using the available hardware threads.
+//!
+//! The chunks are handed to a pool of worker threads, created on the first
+//! call and reused by the following ones; the calling thread processes
+//! chunks as well, and the function only returns once all chunks have been
+//! processed. Calls made from within |body| run serially.
+//!
+//! @param [in] count number of elements to process
+//! @param [in] body function called with the [begin, end) range of each
+//!             chunk; it will be called from several threads at once
+//! @param [in] min_chunk_size minimum number of elements per chunk, to
+//!             avoid waking up workers for tiny amounts of work
+void parallel_for(std::size_t count,
+                  std::function<void (std::size_t begin, std::size_t end)> const& body,
+                  std::size_t min_chunk_size = 1024u);
+
 } // end of namespace